@@ -1,6 +1,13 @@
 //*********************************************************
 //
 // classe para fazer o carregamento de arquivos no formato BMP
+// Formatos suportados: 1, 4 e 8 bits com paleta, RLE4, RLE8, 24 bits, 32 bits (BI_RGB e BITFIELDS),
+// com linhas de baixo para cima ou de cima para baixo (altura negativa).
+// (tambem carrega arquivos QOI para o mesmo formato em memoria, ver Qoi.h)
+// O construtor le apenas o cabecalho (dimensoes e formato). Os pixels sao decodificados
+// em decode(), chamado explicitamente ou no primeiro acesso a getImage/getStats.
+// Com o cache habilitado (setCacheEnabled), a imagem decodificada e gravada em um arquivo ao lado
+// do original e, nos carregamentos seguintes, mapeada em memoria (ver BmpCache.h).
 // Autor: Cesar Tadeu Pozzer
 //        pozzer@inf.ufsm.br
 //
@@ -14,12 +21,35 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
 
 
 #define HEADER_SIZE      14 //sizeof(HEADER) vai dar 16 devido ao alinhamento de bytes
 #define INFOHEADER_SIZE  40 //sizeof(INFOHEADER) da 40 e esta correto.
 #define uchar unsigned char
 
+#define HISTOGRAM_SIZE   256
+#define CHANNEL_R        0
+#define CHANNEL_G        1
+#define CHANNEL_B        2
+#define CHANNEL_L        3  //luminancia
+
+#define MAX_MIP_LEVELS   24
+
+//tipos de compressao (INFOHEADER.compression)
+#define BMP_RGB          0
+#define BMP_RLE8         1
+#define BMP_RLE4         2
+#define BMP_BITFIELDS    3
+
+//codigos de erro (getError)
+#define BMP_OK                 0
+#define BMP_ERROR_OPEN         1  //arquivo inexistente ou sem permissao de leitura
+#define BMP_ERROR_HEADER       2  //assinatura, cabecalho ou dimensoes invalidas
+#define BMP_ERROR_UNSUPPORTED  3  //combinacao de bits por pixel e compressao nao suportada
+#define BMP_ERROR_DATA         4  //bloco de pixels invalido ou muito menor que as dimensoes declaradas
+#define BMP_ERROR_MEMORY       5  //sem memoria para os pixels
+
 typedef struct {
    unsigned short int type;                 /* Magic identifier            */
    unsigned int size;                       /* File size in bytes          */
@@ -41,27 +71,112 @@ typedef struct {
 } INFOHEADER;
 
 
+//estatisticas calculadas durante o carregamento, na mesma passada que converte e normaliza os pixels.
+typedef struct {
+   int histogram[4][HISTOGRAM_SIZE];  /* R, G, B e luminancia (indices CHANNEL_*) */
+   unsigned char min[3], max[3];      /* Por canal R, G, B           */
+   float mean[3];                     /* Por canal R, G, B           */
+} IMAGESTATS;
+
+
+//nivel de mipmap: dimensoes, bytes por linha (alinhado em 4) e posicao dos pixels (RGB, de baixo para cima)
+typedef struct {
+   int width, height, stride;
+   long long offset;
+} MIPLEVEL;
+
+
+class MappedFile;
+class ThreadPool;
+struct BmpRowFormat;
+
 class Bmp {
 private:
    int width, height, imagesize, bytesPerLine, bits;
    unsigned char *data;
-   float *normalizedData;
   int rowPadding;
 
+   MappedFile *cacheFile;          //se nao for NULL, data e os mipmaps apontam para o cache mapeado (somente leitura)
+   unsigned char *mipData;         //niveis 1 em diante, quando gerados em memoria
+   const unsigned char *mipBase;   //base dos offsets de mips[1..]
+   MIPLEVEL mips[MAX_MIP_LEVELS];
+   int mipCount;                   //0 enquanto os mipmaps nao foram gerados
+
    HEADER     header;
    INFOHEADER info;
+   IMAGESTATS stats;
+
+   char *fileName;
+   bool qoi;
+   bool decoded;
+   bool topDown;  //linhas gravadas de cima para baixo no arquivo
+   int  error;    //BMP_OK, ou o erro ao abrir, ler o cabecalho ou decodificar (a decodificacao nao e tentada novamente)
+   unsigned int contentGeneration;  //ver getContentGeneration
 
-   void load(const char *fileName);
-   void preProcessData();
+   static std::atomic<unsigned int> nextContentGeneration;
+   static bool verbose;
+   static bool cacheEnabled;
+   static int  decodeThreads;
+
+   void probe();
+   int  readBmpHeader(FILE *fp);
+   int  loadBmp(FILE *fp);
+   int  loadQoi(FILE *fp);
+   void setError(int code);
+   void setupLayout();
+   bool allocateBuffers();
+   void releaseBuffers();
+   bool loadCache();
+   void buildMips();
+   void decodeRows(FILE *fp, const BmpRowFormat *format);
+   int  decodeRle(FILE *fp, const BmpRowFormat *format);
+   void convertRows(const unsigned char *pixels, long long stride, const BmpRowFormat *format, bool flip);
+   void processRows(int firstRow, int lastRow, long long sum[3], bool bgr, IMAGESTATS *target);
+   void beginStats();
+   void endStats(long long sum[3]);
+   static ThreadPool* getDecodePool();
+
+   Bmp(const Bmp&);            //nao copiavel: os buffers de pixels pertencem a este objeto
+   Bmp& operator=(const Bmp&);
 
 public:
    Bmp(const char *fileName);
+   ~Bmp();
+   //decodifica os pixels, se ainda nao foram decodificados. Retorna false em caso de erro.
+   bool decode();
+   bool isDecoded(void);
+   //true se o cabecalho foi lido com sucesso e a decodificacao nao falhou
+   bool isValid(void);
+   //BMP_OK ou o codigo do erro (BMP_ERROR_*)
+   int  getError(void);
+   static const char* getErrorMessage(int error);
    uchar* getImage();
    int    getWidth(void);
    int    getHeight(void);
    void   convertBGRtoRGB(void);
-   float* getProcessedData(void);
    int getRowPadding(void);
+   const IMAGESTATS* getStats(void);
+   const char* getFileName(void);
+   bool isCached(void);
+   //identifica o conteudo atual: muda quando os pixels sao decodificados ou trocados por swapContents, e nunca se repete
+   //entre Bmps. Usada para detectar recargas, ja que os pixels novos podem ocupar o endereco dos pixels liberados.
+   unsigned int getContentGeneration(void);
+
+   //nivel de mipmap (0 = imagem completa), gerado na primeira chamada se nao veio do cache. Retorna NULL se o nivel nao existir.
+   const uchar* getMipLevel(int level, int *mipWidth, int *mipHeight, int *stride);
+   int getMipCount(void);
+
+   //valor normalizado (0 a 1) de cada valor de canal (0 a 255), usado na renderizacao
+   static const float* getNormalizationTable(void);
+   //troca dimensoes, pixels e estatisticas com outro Bmp (o nome do arquivo e mantido). Usado para recarregar a imagem sem trocar o ponteiro.
+   void swapContents(Bmp *other);
+   //desabilita as mensagens de progresso (uso sem interacao)
+   static void setVerbose(bool enable);
+   //habilita o cache em disco (desabilitado por padrao)
+   static void setCacheEnabled(bool enable);
+   //threads usadas na decodificacao de imagens grandes: 0 = numero de nucleos (padrao), 1 = sem paralelismo.
+   //Deve ser chamada antes do primeiro carregamento.
+   static void setDecodeThreads(int threads);
 };
 
 #endif
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// cache em disco das imagens decodificadas
+// Para cada arquivo de imagem e gravado um arquivo ao lado (nome do arquivo + ".pxc") com os
+// pixels ja no layout de exibicao (RGB, linhas de baixo para cima alinhadas em 4 bytes, igual
+// ao Bmp em memoria), os histogramas/estatisticas e os niveis de mipmap.
+// No carregamento seguinte o arquivo e mapeado em memoria (somente leitura), sem processamento
+// por pixel. O cache e valido apenas se o tamanho, a data de modificacao (com fracao de segundo)
+// e o hash (amostrado) do arquivo de origem forem os mesmos da gravacao.
+//
+//**********************************************************
+
+#ifndef ___BMPCACHE__H___
+#define ___BMPCACHE__H___
+
+#include <string>
+#include "Bmp.h"
+
+#define BMPCACHE_EXTENSION  ".pxc"
+#define BMPCACHE_VERSION    2     //2: data de modificacao com fracao de segundo
+#define BMPCACHE_PAGE_SIZE  4096  //inicio dos pixels alinhado em pagina, para o mapeamento
+#define BMPCACHE_ALIGNMENT  64    //inicio de cada nivel de mipmap
+
+typedef struct {
+   char magic[4];                        /* "PXC1"                                   */
+   unsigned int version;
+   unsigned int headerSize;              /* sizeof(CACHEHEADER), detecta outro layout */
+   unsigned int channels;                /* 3 (RGB)                                  */
+   long long sourceSize;                 /* Tamanho do arquivo de origem             */
+   long long sourceModified;             /* Modificacao da origem (ns; Win: 100 ns)  */
+   unsigned long long sourceHash;        /* Hash amostrado do arquivo de origem      */
+   long long fileSize;                   /* Tamanho total do cache                   */
+   int width, height;
+   int mipCount;                         /* Inclui o nivel 0 (imagem completa)       */
+   MIPLEVEL mips[MAX_MIP_LEVELS];        /* Offsets a partir do inicio do arquivo    */
+   IMAGESTATS stats;
+} CACHEHEADER;
+
+
+//arquivo mapeado em memoria somente para leitura (mmap no POSIX, CreateFileMapping no Windows)
+class MappedFile {
+private:
+   unsigned char *data;
+   long long size;
+#ifdef _WIN32
+   void *file, *mapping;
+#endif
+
+   MappedFile(const MappedFile&);
+   MappedFile& operator=(const MappedFile&);
+
+public:
+   MappedFile();
+   ~MappedFile();
+   bool open(const char *fileName);
+   void close();
+   const unsigned char* getData();
+   long long getSize();
+};
+
+
+class BmpCache {
+public:
+   static std::string cacheName(const char *source);
+
+   //tamanho, data de modificacao (com fracao de segundo) e hash de amostras do arquivo (inicio, fim e blocos espalhados), sem ler o arquivo inteiro
+   static bool readSourceSignature(const char *source, long long *size, long long *modified, unsigned long long *hash);
+
+   //mapeia o cache de source e verifica se corresponde ao arquivo atual. Retorna NULL se nao existir ou estiver desatualizado.
+   static MappedFile* open(const char *source, const CACHEHEADER **header);
+
+   //grava o cache. mips[1..mipCount-1] tem offsets relativos a mipData; o nivel 0 e pixels.
+   static bool write(const char *source, const unsigned char *pixels, int width, int height, int stride,
+                     const IMAGESTATS *stats, const unsigned char *mipData, const MIPLEVEL *mips, int mipCount);
+
+   //calcula as dimensoes e offsets dos niveis 1 em diante (cada um com metade das dimensoes do anterior, ate 1x1).
+   //mips[0] deve estar preenchido. Retorna o numero de niveis (incluindo o 0); *bytes recebe o tamanho total dos niveis 1 em diante.
+   static int layoutMips(MIPLEVEL *mips, long long *bytes);
+
+   //gera um nivel a partir do anterior, com media de blocos 2x2
+   static void downsample(const unsigned char *src, const MIPLEVEL *srcLevel, unsigned char *dst, const MIPLEVEL *dstLevel);
+};
+
+#endif
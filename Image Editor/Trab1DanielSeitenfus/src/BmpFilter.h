@@ -0,0 +1,73 @@
+//*********************************************************
+//
+// classe para aplicar filtros de convolucao separaveis (desfoque e nitidez) aos pixels do Bmp
+// O nucleo 2D e o produto de um nucleo 1D por ele mesmo: as linhas sao filtradas na primeira
+// passada e as colunas na segunda. A primeira passada processa faixas de FILTER_STRIP_ROWS linhas
+// e grava o resultado transposto, entao a segunda passada tambem percorre linhas contiguas
+// na memoria e transpoe de volta ao gravar a saida.
+// As contas sao feitas em ponto fixo de 16 bits (pixels em Q8, pesos em Q16), 8 valores por
+// instrucao com SSE2, ou na versao escalar equivalente, com o mesmo resultado bit a bit.
+// As bordas sao tratadas repetindo o primeiro e o ultimo pixel de cada linha em um buffer com
+// folga, entao o laco de convolucao nao tem testes por pixel.
+// As faixas das duas passadas sao distribuidas entre as threads de um ThreadPool.
+//
+//**********************************************************
+
+#ifndef ___BMPFILTER__H___
+#define ___BMPFILTER__H___
+
+#define FILTER_MAX_RADIUS   32
+#define FILTER_MAX_AMOUNT   64  //quantidade maxima da mascara de nitidez (o produto pela diferenca cabe em 16 bits com sinal)
+#define FILTER_STRIP_ROWS   32  //linhas por faixa; a faixa filtrada e transposta em blocos de FILTER_TILE pixels
+#define FILTER_TILE         32
+
+//nucleo 1D com 2*radius+1 pesos em Q16 (soma 65536)
+typedef struct {
+   int radius;
+   unsigned short weights[2*FILTER_MAX_RADIUS + 1];
+} FILTERKERNEL;
+
+class ThreadPool;
+
+class BmpFilter {
+private:
+   FILTERKERNEL kernel;
+   int amount;    //mascara de nitidez: peso da diferenca entre a imagem e o desfoque, em Q8. 0 apenas desfoca
+   unsigned short *transposed;   //imagem entre as duas passadas, mantida para as proximas chamadas
+   long long transposedSize;
+
+   void setGaussian(int radius);
+
+public:
+   BmpFilter();
+   ~BmpFilter();
+
+   //a copia leva apenas o filtro configurado; o buffer transposto pertence a cada objeto
+   BmpFilter(const BmpFilter &other);
+   BmpFilter& operator=(const BmpFilter &other);
+
+   //desfoque com todos os pesos iguais (media da vizinhanca)
+   void setBoxBlur(int radius);
+
+   //desfoque gaussiano, com desvio padrao (radius+1)/3
+   void setGaussianBlur(int radius);
+
+   //mascara de nitidez: saida = imagem + amount*(imagem - desfoque gaussiano de raio radius)
+   void setUnsharpMask(int radius, float amount);
+
+   //nitidez: mascara de nitidez de raio 1
+   void setSharpen(float amount);
+
+   int getRadius();
+
+   //aplica o filtro a uma imagem de 3 canais de 8 bits (RGB ou BGR, os canais sao tratados igualmente).
+   //src e dst tem linhas de stride bytes e podem ser o mesmo buffer. pool pode ser NULL (uma thread).
+   //Nao pode ser chamada ao mesmo tempo por duas threads no mesmo objeto.
+   //Retorna false se faltar memoria para o buffer transposto.
+   bool apply(const unsigned char *src, int srcStride, unsigned char *dst, int dstStride, int width, int height, ThreadPool *pool);
+
+   //nome da implementacao do laco de convolucao ("SSE2" ou "escalar")
+   static const char* getImplementation();
+};
+
+#endif
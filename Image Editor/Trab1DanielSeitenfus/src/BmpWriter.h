@@ -0,0 +1,43 @@
+//*********************************************************
+//
+// classe para gravar arquivos BMP de 24 bits linha a linha
+// As linhas sao gravadas de baixo para cima (ordem do arquivo), com o preenchimento
+// de 4 bytes, atraves de um unico buffer de linha reutilizado. A imagem inteira
+// nunca precisa estar na memoria.
+//
+//**********************************************************
+
+#ifndef ___BMPWRITER__H___
+#define ___BMPWRITER__H___
+
+#include <stdio.h>
+
+class BmpWriter {
+private:
+   FILE *fp;
+   int width, height, bytesPerLine;
+   int rowsWritten;
+   unsigned char *rowBuffer;
+
+   bool writeHeader();
+
+public:
+   BmpWriter();
+   ~BmpWriter();
+
+   //cria o arquivo e grava o cabecalho. Retorna false em caso de erro.
+   bool open(const char *fileName, int width, int height);
+
+   //buffer da proxima linha: width pixels em BGR. O preenchimento ja vem zerado.
+   unsigned char* getRowBuffer();
+
+   //grava o buffer de linha. Retorna false em caso de erro.
+   bool writeRow();
+
+   //fecha o arquivo. Retorna false se nem todas as linhas foram gravadas ou houve erro de escrita.
+   bool close();
+
+   int getRowsWritten();
+};
+
+#endif
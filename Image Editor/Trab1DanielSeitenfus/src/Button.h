@@ -1,36 +1,41 @@
 /**
  * @file Button.h
- * @brief Definio da classe Button para representar um boto.
+ * @brief Definição da classe Button para representar um botão.
  *
- * Este arquivo contm a definio da classe Button, que representa um boto na tela, podendo conter um rtulo de texto e/ou um cone.
+ * Este arquivo contém a definição da classe Button, que representa um botão na tela, podendo conter um rótulo de texto e/ou um ícone.
+ * O ícone é uma região de um IconAtlas; os ícones dos botões de um ButtonManager são desenhados pelo gerenciador, em um único lote.
  */
 
 
 #ifndef __BOTAO_H__
 #define __BOTAO_H__
 
+#include <functional>
 #include "gl_canvas2d.h"
 #include "Color.h"
 #include "Math.h"
 #include "Text.h"
+#include "Widget.h"
+#include "IconAtlas.h"
 
-typedef void (*Func)();
+typedef std::function<void()> Func;
 
 /**
- * Classe para representar um boto na tela.
+ * Classe para representar um botão na tela. O rótulo é um widget filho, oculto quando o botão tem ícone.
  */
-class Button {
+class Button : public Widget {
   Color buttonColor;
   Text* text;
   Func action;
-  Image *icon;
+  IconAtlas *atlas;
+  int iconIndex;       /**< Ícone no atlas, ou -1. */
+  float iconX, iconY;  /**< Canto inferior esquerdo do ícone, centralizado no botão. */
   bool selectable;
   bool selected;
   const Color frameColor = Color::BLACK;
   const int frameWidth = 3;
 
 public:
-  float x1, y1, x2, y2;
 
   /**
      * @brief Construtor da classe Button.
@@ -38,74 +43,102 @@ public:
      * @param _y1 Coordenada y1.
      * @param _x2 Coordenada x2.
      * @param _y2 Coordenada y2.
-     * @param _label Rtulo de texto do boto.
-     * @param _buttonColor Cor do boto.
-     * @param _textColor Cor do texto do boto.
-     * @param _selectable Indicador de selecionabilidade do boto.
-     * @param _action Funo de ao do boto.
+     * @param _label Rótulo de texto do botão.
+     * @param _buttonColor Cor do botão.
+     * @param _textColor Cor do texto do botão.
+     * @param _selectable Indicador de selecionabilidade do botão.
+     * @param _action Função de ação do botão.
      */
   Button(float _x1, float _y1, float _x2, float _y2, const char *_label, Color _buttonColor, Color _textColor, bool _selectable, Func _action)
-      : x1(_x1), y1(_y1), x2(_x2), y2(_y2), buttonColor(_buttonColor), selectable(_selectable), action(_action) {
+      : Widget(_x1, _y1, _x2, _y2), buttonColor(_buttonColor), selectable(_selectable), action(_action) {
      text = new Text(x1+5, y1+((y2-y1)/2), _label, _textColor);
+     addChild(text);
+     atlas = nullptr;
+     iconIndex = -1;
      selected = false;
   }
 
   /**
-     *  Construtor da classe Button com cone.
+     *  Construtor da classe Button com ícone.
      * @param _x1 Coordenada x1.
      * @param _y1 Coordenada y1.
      * @param _x2 Coordenada x2.
      * @param _y2 Coordenada y2.
-     * @param _label Rtulo de texto do boto.
-     * @param _buttonColor Cor do boto.
-     * @param _textColor Cor do texto do boto.
-     * @param _selectable Indicador de selecionabilidade do boto.
-     * @param fileName Nome do arquivo do cone.
-     * @param _action Funo de ao do boto.
+     * @param _label Rótulo de texto do botão.
+     * @param _buttonColor Cor do botão.
+     * @param _textColor Cor do texto do botão.
+     * @param _selectable Indicador de selecionabilidade do botão.
+     * @param _atlas Atlas que contém o ícone.
+     * @param iconName Nome do ícone no atlas. Se não for encontrado, o botão exibe o rótulo.
+     * @param _action Função de ação do botão.
      */
-  Button(float _x1, float _y1, float _x2, float _y2, const char *_label, Color _buttonColor, Color _textColor, bool _selectable, const char *fileName, Func _action)
-      : x1(_x1), y1(_y1), x2(_x2), y2(_y2), buttonColor(_buttonColor), selectable(_selectable), action(_action) {
+  Button(float _x1, float _y1, float _x2, float _y2, const char *_label, Color _buttonColor, Color _textColor, bool _selectable, IconAtlas *_atlas, const char *iconName, Func _action)
+      : Widget(_x1, _y1, _x2, _y2), buttonColor(_buttonColor), selectable(_selectable), action(_action) {
      text = new Text(x1+5, y1+((y2-y1)/2), _label, _textColor);
+     addChild(text);
+     atlas = nullptr;
+     iconIndex = -1;
      selected = false;
-     setIconCentralized(new Bmp(fileName));
+     setIconCentralized(_atlas, _atlas->find(iconName));
   }
 
   /**
-     * Define o cone centralizado no boto.
-     * @param bmp Ponteiro para o objeto Bmp contendo os dados do cone.
+     * Define o ícone centralizado no botão.
+     * @param _atlas Atlas que contém o ícone.
+     * @param index Índice do ícone no atlas.
      */
-  void setIconCentralized(Bmp *bmp) {
-      int imageX2 = x1 + bmp->getWidth();
-      int imageY2 = y1 + bmp->getHeight();
+  void setIconCentralized(IconAtlas *_atlas, int index) {
+      const ATLASICON *icon = _atlas->getIcon(index);
+      if(icon == nullptr) return;
+
+      atlas = _atlas;
+      iconIndex = index;
+      iconX = x1 + (getWidth() - icon->width)/2;
+      iconY = y1 + (getHeight() - icon->height)/2;
+      text->setVisible(false);
+  }
 
-      int imageWidth = imageX2 - x1;
-      int imageHeight = imageY2 - y1;
+  /**
+  * Indica se o botão exibe um ícone.
+  */
+  bool hasIcon() {
+      return atlas != nullptr;
+  }
 
-      int iconX = x1 + (getWidth() - imageWidth)/2;
-      int iconY = y1 + (getHeight() - imageHeight)/2;
+  IconAtlas* getIconAtlas() {
+      return atlas;
+  }
 
-      icon = new Image(bmp,iconX, iconY);
-      icon->setTransparency(true);
+  /**
+  * Emite o retângulo texturizado do ícone. Deve ser chamada entre IconAtlas::begin e IconAtlas::end, para que todos os ícones usem a mesma textura.
+  */
+  void drawIcon() {
+      if(atlas != nullptr) atlas->drawIcon(iconIndex, iconX, iconY);
   }
 
   /**
-  * Renderiza o boto na tela.
+  * Desenha o botão (moldura e fundo). O rótulo é desenhado pelo widget de texto filho e o ícone pelo ButtonManager.
   */
-  void render() {
+  void draw() {
       if(selectable && selected) renderFrame();
 
       CV::color(buttonColor.r, buttonColor.g, buttonColor.b);
       CV::rectFill(x1, y1, x2, y2);
+  }
 
-      if(icon != nullptr) {
-        icon->render();
-      } else {
-        text->render();
-      }
+  bool isInteractive() {
+      return true;
   }
 
   /**
-  * Renderiza a moldura do boto quando selecionado.
+  * Executa a ação no clique.
+  */
+  void onMouse(int mx, int my, int state) {
+      if(state == MOUSE_STATE_DOWN) onClick();
+  }
+
+  /**
+  * Renderiza a moldura do botão quando selecionado.
   */
   void renderFrame() {
     CV::color(frameColor.r, frameColor.g, frameColor.b);
@@ -115,48 +148,40 @@ public:
   }
 
   /**
-  * Verifica se um ponto est dentro da rea ocupada pelo boto.
-  * @param mx Coordenada x do ponto.
-  * @param my Coordenada y do ponto.
-  * @return true se o ponto est dentro da rea do boto, false caso contrrio.
-  */
-  bool colidiu(int mx, int my) {
-      return Math::isPointInsideRectangle(mx, my, x1, y1, x2, y2);
-  }
-
-  /**
-  * Executa a ao do boto quando clicado.
+  * Executa a ação do botão quando clicado.
   */
   void onClick(){
-    action();
+    if(action) action();
   }
 
   /**
-  * Define se o boto est selecionado ou no.
-  * @param _selected Indicador de seleo do boto.
+  * Define se o botão está selecionado ou não.
+  * @param _selected Indicador de seleção do botão.
   */
   void setSelected(bool _selected) {
+    if(selected == _selected) return;
     selected = _selected;
+    invalidate();
   }
 
   /**
-  * Alterna o estado de seleo do boto.
+  * Alterna o estado de seleção do botão.
   */
   void toggleSelected() {
-    selected = !selected;
+    setSelected(!selected);
   }
 
   /**
-  * Obtm a altura do boto.
-  * @return A altura do boto.
+  * Obtém a altura do botão.
+  * @return A altura do botão.
   */
   int getHeight() {
     return y2 - y1;
   }
 
   /**
-  * @brief Obtm a largura do boto.
-  * @return A largura do boto.
+  * @brief Obtém a largura do botão.
+  * @return A largura do botão.
   */
   int getWidth() {
     return x2 - x1;
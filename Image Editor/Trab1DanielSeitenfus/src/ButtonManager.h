@@ -1,139 +1,130 @@
 /**
  * @file ButtonManager.h
- * @brief Definio da classe ButtonManager para gerenciamento de botes.
+ * @brief Definição da classe ButtonManager para gerenciamento de botões.
  *
- * Este arquivo contm a definio da classe ButtonManager, responsvel por gerenciar uma coleo de botes e as interaes com eles, como adio, renderizao e tratamento de eventos de mouse.
+ * Este arquivo contém a definição da classe ButtonManager, responsável por gerenciar uma coleção de botões e as interações com eles, como adição, renderização e tratamento de eventos de mouse.
+ * Os botões são filhos do gerenciador na árvore de widgets: a renderização e o teste de colisão são feitos pela árvore.
+ * Os ícones dos botões são desenhados pelo gerenciador depois dos botões, em um único lote com a textura do IconAtlas.
  */
 
 #ifndef BUTTONMANAGER_H_INCLUDED
 #define BUTTONMANAGER_H_INCLUDED
 
-#include <vector>
 #include <functional>
 #include "Button.h"
 #include "Color.h"
-
-#define NO_BUTTON_SELECTED -1
+#include "Widget.h"
+#include "IconAtlas.h"
 
 /**
- * Classe para gerenciamento de botes.
+ * Classe para gerenciamento de botões.
  */
-class ButtonManager {
+class ButtonManager : public Widget {
+    IconAtlas *iconAtlas;
 
-public:
-    std::vector<Button*> buttons;
-    Func action;
-    int selectedIndex;
+protected:
+    bool hasOverlay() {
+        return iconAtlas != nullptr;
+    }
 
     /**
-     * Construtor da classe ButtonManager.
+     * Cria a textura do atlas antes da compilação das listas.
      */
-    ButtonManager() {
-        buttons = {};
-        selectedIndex = NO_BUTTON_SELECTED;
+    void prepare() {
+        if(iconAtlas != nullptr) iconAtlas->upload();
     }
 
     /**
-     * Destrutor da classe ButtonManager.
+     * Desenha os ícones de todos os botões em um lote, com uma única ligação de textura.
      */
-    ~ButtonManager() {
-        for(int i=0; i<buttons.size(); i++) {
-            free(buttons[i]);
+    void drawOverlay() {
+        iconAtlas->begin();
+        for(int i=0; i<getChildCount(); i++) {
+            Button *button = getButton(i);
+            if(button->isVisible() && button->getIconAtlas() == iconAtlas) button->drawIcon();
         }
+        iconAtlas->end();
     }
 
-    /**
-     * Adiciona um boto ao gerenciador.
-     * @param x Coordenada x do canto superior esquerdo do boto.
-     * @param y Coordenada y do canto superior esquerdo do boto.
-     * @param larg Largura do boto.
-     * @param alt Altura do boto.
-     * @param text Texto do boto.
-     * @param buttonColor Cor do boto.
-     * @param textColor Cor do texto do boto.
-     * @param selectable Indica se o boto pode ser selecionado.
-     * @param _action Funo de ao associada ao boto.
-     */
-    void addButton(int x, int y, int larg, int alt, char* text, Color buttonColor, Color textColor, bool selectable, Func _action) {
-        buttons.push_back(new Button(x, y, larg, alt, text, buttonColor, textColor, selectable, _action));
-    }
+public:
+    ButtonManager() : iconAtlas(nullptr) {}
 
     /**
-     * Adiciona um boto com cone ao gerenciador.
-     * @param x Coordenada x do canto superior esquerdo do boto.
-     * @param y Coordenada y do canto superior esquerdo do boto.
-     * @param larg Largura do boto.
-     * @param alt Altura do boto.
-     * @param text Texto do boto.
-     * @param buttonColor Cor do boto.
-     * @param textColor Cor do texto do boto.
-     * @param selectable Indica se o boto pode ser selecionado.
-     * @param fileName Nome do arquivo de cone do boto.
-     * @param _action Funo de ao associada ao boto.
+     * Define o atlas dos ícones dos botões adicionados com nome de ícone.
+     * @param atlas Atlas. Deve existir enquanto o gerenciador existir.
      */
-    void addButton(int x, int y, int larg, int alt, char* text, Color buttonColor, Color textColor, bool selectable, const char *fileName, Func _action) {
-        buttons.push_back(new Button(x, y, larg, alt, text, buttonColor, textColor, selectable, fileName, _action));
+    void setIconAtlas(IconAtlas *atlas) {
+        iconAtlas = atlas;
+        invalidate();
     }
 
     /**
-     * Renderiza todos os botes.
+     * Adiciona um botão ao gerenciador.
+     * @param x Coordenada x do canto superior esquerdo do botão.
+     * @param y Coordenada y do canto superior esquerdo do botão.
+     * @param larg Largura do botão.
+     * @param alt Altura do botão.
+     * @param text Texto do botão.
+     * @param buttonColor Cor do botão.
+     * @param textColor Cor do texto do botão.
+     * @param selectable Indica se o botão pode ser selecionado.
+     * @param _action Função de ação associada ao botão.
      */
-    void render() {
-        for(int i=0; i<buttons.size(); i++) {
-            buttons[i]->render();
-        }
+    void addButton(int x, int y, int larg, int alt, char* text, Color buttonColor, Color textColor, bool selectable, Func _action) {
+        addChild(new Button(x, y, larg, alt, text, buttonColor, textColor, selectable, _action));
     }
 
     /**
-     * @brief Trata os eventos do mouse.
-     * @param mx Coordenada x do mouse.
-     * @param my Coordenada y do mouse.
-     * @param state Estado de clique do mouse.
+     * Adiciona um botão com ícone ao gerenciador.
+     * @param x Coordenada x do canto superior esquerdo do botão.
+     * @param y Coordenada y do canto superior esquerdo do botão.
+     * @param larg Largura do botão.
+     * @param alt Altura do botão.
+     * @param text Texto do botão.
+     * @param buttonColor Cor do botão.
+     * @param textColor Cor do texto do botão.
+     * @param selectable Indica se o botão pode ser selecionado.
+     * @param iconName Nome do ícone no atlas definido em setIconAtlas.
+     * @param _action Função de ação associada ao botão.
      */
-    void onMouseUpdated(int mx, int my, int state) {
-        if(state == 0) {
-            for(int i=0; i<buttons.size(); i++) {
-                if(buttons[i]->colidiu(mx, my)) {
-                    buttons[i]->onClick();
-                    return;
-                }
-            }
-        }
+    void addButton(int x, int y, int larg, int alt, char* text, Color buttonColor, Color textColor, bool selectable, const char *iconName, Func _action) {
+        addChild(new Button(x, y, larg, alt, text, buttonColor, textColor, selectable, iconAtlas, iconName, _action));
+        invalidate();
     }
 
+
     /**
-     * Alterna a seleo do boto.
-     * @param index ndice do boto.
+     * Alterna a seleção do botão.
+     * @param index Índice do botão.
      */
     void toggleSelectButton(int index) {
-        buttons[index]->toggleSelected();
+        getButton(index)->toggleSelected();
     }
 
     /**
-     * Define o estado de seleo de um boto.
-     * @param index ndice do boto.
-     * @param selected True para selecionar o boto, False para deselecion-lo.
+     * Define o estado de seleção de um botão.
+     * @param index Índice do botão.
+     * @param selected True para selecionar o botão, False para deselecioná-lo.
      */
     void setSelectButton(int index, bool selected) {
-        buttons[index]->setSelected(selected);
+        getButton(index)->setSelected(selected);
     }
 
     /**
-     * Obtm o ltimo boto adicionado.
-     * @return Ponteiro para o ltimo boto adicionado.
+     * Obtém o último botão adicionado.
+     * @return Ponteiro para o último botão adicionado.
      */
     Button* getLastButton() {
-        return buttons[buttons.size()-1];
+        return getButton(getChildCount()-1);
     }
 
     /**
-     * Obtm um boto pelo seu ndice.
-     * @param index ndice do boto.
-     * @return Ponteiro para o boto correspondente ao ndice.
+     * Obtém um botão pelo seu índice.
+     * @param index Índice do botão.
+     * @return Ponteiro para o botão correspondente ao índice.
      */
      Button* getButton(int index) {
-        if(index >= buttons.size()) return nullptr;
-        return buttons[index];
+        return static_cast<Button*>(getChild(index));
      }
 };
 
@@ -1,7 +1,7 @@
 /**
  * @file Color.h
- * @brief Define a classe Color, que abstrai a definio de cores RGB. Isso abstrai complexidade do restante do cdigo, melhora a refatorao do projeto e legibilidade do cdigo.
- *  muito mais fcil identificar uma cor por nome, do que por inteiros.
+ * @brief Define a classe Color, que abstrai a definição de cores RGB. Isso abstrai complexidade do restante do código, melhora a refatoração do projeto e legibilidade do código.
+ * É muito mais fácil identificar uma cor por nome, do que por inteiros.
  */
 
 #ifndef COLOR_H_INCLUDED
@@ -0,0 +1,170 @@
+/**
+ * @file DragBackground.h
+ * @brief Definição da classe DragBackground, que guarda em uma textura o fundo do painel enquanto uma imagem é arrastada.
+ *
+ * Durante o arraste apenas a imagem arrastada muda; todas as imagens abaixo dela ficam paradas. No primeiro quadro do arraste, essas imagens
+ * são desenhadas normalmente e a área do painel é copiada do framebuffer para uma textura. Nos quadros seguintes, o fundo inteiro é um único
+ * retângulo texturizado e apenas a imagem arrastada é desenhada por cima, então o custo do quadro não depende do número de imagens abaixo dela.
+ * A cópia e o desenho da textura são comandos da CV, executados pela thread que desenha (a do GLUT ou a de renderização), dona da textura.
+ */
+
+#ifndef DRAGBACKGROUND_H_INCLUDED
+#define DRAGBACKGROUND_H_INCLUDED
+
+#include <stdio.h>
+#include <memory>
+#include "gl_canvas2d.h"
+#include "Image.h"
+
+class DragBackground {
+    /**
+     * Textura com o fundo copiado. Usada apenas pela thread que desenha; a textura não é liberada, pois é reaproveitada em todos os arrastes
+     * e pertence ao contexto dessa thread.
+     */
+    struct Capture {
+        GLuint texture;
+        int width, height;  /**< Tamanho alocado da textura, em potências de 2 (como no IconAtlas; o OpenGL 1.1 não aceita outros tamanhos). */
+        float s, t;         /**< Fração da textura ocupada pela última cópia. */
+        bool valid;         /**< A última cópia foi feita; falso até o primeiro quadro com cópia ser desenhado. */
+    };
+
+    /**
+     * Copia a área do framebuffer, já com as imagens do fundo desenhadas, para a textura.
+     */
+    class CaptureCommand : public CVCommand {
+        std::shared_ptr<Capture> capture;
+        ClipRect area;
+
+        static int powerOfTwo(int value) {
+            int power = 1;
+            while(power < value) power *= 2;
+            return power;
+        }
+
+    public:
+        CaptureCommand(const std::shared_ptr<Capture> &_capture, const ClipRect &_area) : capture(_capture), area(_area) {}
+
+        void execute() {
+            int width = area.x2 - area.x1, height = area.y2 - area.y1;
+            if(capture->texture == 0) {
+                glGenTextures(1, &capture->texture);
+                glBindTexture(GL_TEXTURE_2D, capture->texture);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+            } else {
+                glBindTexture(GL_TEXTURE_2D, capture->texture);
+            }
+            //a textura só é realocada quando a área não cabe mais nela; a cópia ocupa o canto inferior esquerdo
+            if(width > capture->width || height > capture->height) {
+                capture->width = powerOfTwo(width);
+                capture->height = powerOfTwo(height);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, capture->width, capture->height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            }
+            //a canvas usa coordenadas de janela (origem no canto inferior esquerdo), as mesmas da cópia
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, area.x1, area.y1, width, height);
+            capture->s = (float)width/capture->width;
+            capture->t = (float)height/capture->height;
+            glBindTexture(GL_TEXTURE_2D, 0);
+            capture->valid = true;
+        }
+    };
+
+    /**
+     * Desenha o fundo copiado como um único retângulo texturizado.
+     */
+    class DrawCommand : public CVCommand {
+        std::shared_ptr<Capture> capture;
+        ClipRect area;
+
+    public:
+        DrawCommand(const std::shared_ptr<Capture> &_capture, const ClipRect &_area) : capture(_capture), area(_area) {}
+
+        void execute() {
+            if(!capture->valid) return;
+            glEnable(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, capture->texture);
+            glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+            glBegin(GL_QUADS);
+            glTexCoord2f(0, 0);                   glVertex2f(area.x1, area.y1);
+            glTexCoord2f(capture->s, 0);          glVertex2f(area.x2, area.y1);
+            glTexCoord2f(capture->s, capture->t); glVertex2f(area.x2, area.y2);
+            glTexCoord2f(0, capture->t);          glVertex2f(area.x1, area.y2);
+            glEnd();
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glDisable(GL_TEXTURE_2D);
+        }
+    };
+
+    std::shared_ptr<Capture> copy;
+    bool cached;
+    Image *image;             /**< Imagem arrastada quando o fundo foi copiado. */
+    int level;
+    ClipRect area;
+    unsigned int version;     /**< Versão das imagens do fundo quando ele foi copiado. */
+    long long captures, cachedFrames;
+
+    DragBackground(const DragBackground&);
+    DragBackground& operator=(const DragBackground&);
+
+public:
+    DragBackground() : copy(std::make_shared<Capture>()), cached(false), image(nullptr), level(0), version(0), captures(0), cachedFrames(0) {
+        copy->texture = 0;
+        copy->width = copy->height = 0;
+        copy->s = copy->t = 0;
+        copy->valid = false;
+        area = ClipRect::unbounded();
+    }
+
+    /**
+     * Verifica se o fundo copiado ainda vale para o quadro atual.
+     * @param _image Imagem arrastada.
+     * @param _level Nível de mipmap das imagens.
+     * @param _area Área visível das imagens.
+     * @param _version Versão das imagens do fundo, alterada quando alguma delas muda (decodificação, recarga, inclusão).
+     */
+    bool isCached(Image *_image, int _level, const ClipRect &_area, unsigned int _version) {
+        return cached && image == _image && level == _level && version == _version &&
+               area.x1 == _area.x1 && area.y1 == _area.y1 && area.x2 == _area.x2 && area.y2 == _area.y2;
+    }
+
+    /**
+     * Copia o fundo, que deve ter acabado de ser desenhado na área. Os parâmetros são os mesmos de isCached.
+     */
+    void capture(Image *_image, int _level, const ClipRect &_area, unsigned int _version) {
+        if(_area.getArea() <= 0) return;
+        CV::record(new CaptureCommand(copy, _area));
+        cached = true;
+        image = _image;
+        level = _level;
+        area = _area;
+        version = _version;
+        captures++;
+    }
+
+    /**
+     * Desenha o fundo copiado.
+     */
+    void draw() {
+        CV::record(new DrawCommand(copy, area));
+        cachedFrames++;
+    }
+
+    /**
+     * Descarta o fundo copiado; chamada quando não há arraste.
+     */
+    void invalidate() {
+        cached = false;
+    }
+
+    /**
+     * Imprime quantas vezes o fundo foi copiado e em quantos quadros foi reaproveitado.
+     */
+    void printStats() {
+        if(captures == 0) return;
+        printf("\nFundo do arraste: %lld copias, reaproveitado em %lld quadros\n", captures, cachedFrames);
+    }
+};
+
+#endif // DRAGBACKGROUND_H_INCLUDED
@@ -0,0 +1,124 @@
+/**
+ * @file DrawList.h
+ * @brief Definição da classe DrawList, uma lista de desenhos reordenada por estado antes de ser enviada à CV.
+ *
+ * Serve para camadas em que a ordem dos desenhos não importa (elementos que não se sobrepõem, como os pixels de uma imagem).
+ * Os desenhos são agrupados pelo tipo de primitiva e pela cor (radix sort sobre uma chave de 32 bits, em tempo linear),
+ * de modo que a CV emite um glBegin por tipo e uma chamada de cor por grupo de cores iguais, em vez de alternar o estado a cada desenho.
+ */
+
+#ifndef DRAWLIST_H_INCLUDED
+#define DRAWLIST_H_INCLUDED
+
+#include <vector>
+#include <string.h>
+#include "gl_canvas2d.h"
+
+/**
+ * Tipos de desenho, na ordem em que são enviados.
+ */
+enum DrawCommandType {
+    DRAW_POINT = 0,
+    DRAW_LINE,
+    DRAW_RECT_FILL
+};
+
+class DrawList {
+    struct DrawCommand {
+        unsigned int key; /**< Tipo no byte alto, cor quantizada em 8 bits por canal nos demais. */
+        float r, g, b;
+        float x1, y1, x2, y2;
+    };
+
+    std::vector<DrawCommand> commands, buffer;
+    float r, g, b;
+    unsigned int colorKey;
+
+    static unsigned int quantize(float value) {
+        if(value <= 0) return 0;
+        if(value >= 1) return 255;
+        return (unsigned int)(value*255 + 0.5f);
+    }
+
+    void add(DrawCommandType type, float x1, float y1, float x2, float y2) {
+        DrawCommand command = {((unsigned int)type << 24) | colorKey, r, g, b, x1, y1, x2, y2};
+        commands.push_back(command);
+    }
+
+    /**
+     * Ordena os desenhos pela chave, um byte por passada, mantendo a ordem original entre chaves iguais.
+     * Passadas em que todos os desenhos têm o mesmo byte são puladas (o tipo, quando há um só).
+     */
+    void sortByKey() {
+        buffer.resize(commands.size());
+        for(int shift=0; shift<32; shift+=8) {
+            size_t count[256];
+            memset(count, 0, sizeof(count));
+            for(size_t i=0; i<commands.size(); i++) count[(commands[i].key >> shift) & 0xff]++;
+            if(count[(commands[0].key >> shift) & 0xff] == commands.size()) continue;
+
+            size_t offset = 0;
+            for(int v=0; v<256; v++) {
+                size_t c = count[v];
+                count[v] = offset;
+                offset += c;
+            }
+            for(size_t i=0; i<commands.size(); i++) buffer[count[(commands[i].key >> shift) & 0xff]++] = commands[i];
+            commands.swap(buffer);
+        }
+    }
+
+public:
+    DrawList() : r(0), g(0), b(0), colorKey(0) {}
+
+    /**
+     * Define a cor dos próximos desenhos.
+     */
+    void color(float _r, float _g, float _b) {
+        r = _r;
+        g = _g;
+        b = _b;
+        colorKey = (quantize(r) << 16) | (quantize(g) << 8) | quantize(b);
+    }
+
+    void point(float x, float y) {
+        add(DRAW_POINT, x, y, x, y);
+    }
+
+    void line(float x1, float y1, float x2, float y2) {
+        add(DRAW_LINE, x1, y1, x2, y2);
+    }
+
+    void rectFill(float x1, float y1, float x2, float y2) {
+        add(DRAW_RECT_FILL, x1, y1, x2, y2);
+    }
+
+    size_t size() {
+        return commands.size();
+    }
+
+    /**
+     * Envia os desenhos à CV agrupados por tipo e cor e esvazia a lista. A memória é mantida para o próximo uso.
+     */
+    void submit() {
+        if(commands.empty()) return;
+        sortByKey();
+        for(size_t i=0; i<commands.size(); i++) {
+            const DrawCommand &command = commands[i];
+            CV::color(command.r, command.g, command.b);
+            switch(command.key >> 24) {
+                case DRAW_POINT:
+                    CV::point(command.x1, command.y1);
+                    break;
+                case DRAW_LINE:
+                    CV::line(command.x1, command.y1, command.x2, command.y2);
+                    break;
+                default:
+                    CV::rectFill(command.x1, command.y1, command.x2, command.y2);
+            }
+        }
+        commands.clear();
+    }
+};
+
+#endif // DRAWLIST_H_INCLUDED
@@ -0,0 +1,154 @@
+/**
+ * @file FileWatcher.h
+ * @brief Definição da classe FileWatcher, que detecta alterações em arquivos.
+ *
+ * No Linux usa inotify, observando o diretório de cada arquivo (assim também são detectados programas que salvam gravando um arquivo temporário e renomeando).
+ * Nas demais plataformas compara periodicamente a data de modificação e o tamanho dos arquivos.
+ * A consulta (poll) nunca bloqueia, podendo ser feita a cada frame.
+ */
+
+#ifndef FILEWATCHER_H_INCLUDED
+#define FILEWATCHER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#define FILE_WATCH_POLL_INTERVAL_MS 500 //intervalo entre verificações quando não há inotify
+
+class FileWatcher {
+    struct WatchedFile {
+        std::string path, dir, name;
+        long long modified, size;
+        int watchDescriptor;
+    };
+
+    std::vector<WatchedFile> files;
+    std::chrono::steady_clock::time_point lastPoll;
+    int inotifyFd;
+
+    /**
+     * Separa o caminho em diretório e nome. No Windows, '\\' também é separador.
+     */
+    static void splitPath(const std::string &path, std::string &dir, std::string &name) {
+#ifdef _WIN32
+        size_t slash = path.find_last_of("/\\");
+#else
+        size_t slash = path.find_last_of('/');
+#endif
+        dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    static void readFileState(const std::string &path, long long *modified, long long *size) {
+        struct stat info;
+        if(stat(path.c_str(), &info) == 0) {
+            *modified = (long long)info.st_mtime;
+            *size = (long long)info.st_size;
+        } else {
+            *modified = *size = -1;
+        }
+    }
+
+    /**
+     * Verifica todos os arquivos pela data de modificação e tamanho.
+     */
+    void pollByStat(std::vector<int> &changed) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPoll).count() < FILE_WATCH_POLL_INTERVAL_MS) return;
+        lastPoll = now;
+
+        for(size_t i=0; i<files.size(); i++) {
+            if(files[i].watchDescriptor >= 0) continue;
+            long long modified, size;
+            readFileState(files[i].path, &modified, &size);
+            if(modified != files[i].modified || size != files[i].size) {
+                files[i].modified = modified;
+                files[i].size = size;
+                changed.push_back(i);
+            }
+        }
+    }
+
+#ifdef __linux__
+    /**
+     * Lê os eventos pendentes do inotify e marca os arquivos observados que foram gravados ou substituídos.
+     */
+    void pollInotify(std::vector<int> &changed) {
+        if(inotifyFd < 0) return;
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for(char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+                struct inotify_event *event = (struct inotify_event*)p;
+                if(event->len == 0) continue;
+                for(size_t i=0; i<files.size(); i++) {
+                    if(files[i].watchDescriptor == event->wd && files[i].name == event->name) {
+                        changed.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+public:
+    FileWatcher() : lastPoll(std::chrono::steady_clock::now()) {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+        inotifyFd = -1;
+#endif
+    }
+
+    ~FileWatcher() {
+#ifdef __linux__
+        if(inotifyFd >= 0) close(inotifyFd);
+#endif
+    }
+
+    /**
+     * Passa a observar um arquivo.
+     * @param path Caminho do arquivo.
+     * @return Identificador do arquivo, usado no retorno de poll().
+     */
+    int addFile(const char *path) {
+        WatchedFile file;
+        file.path = path;
+        splitPath(file.path, file.dir, file.name);
+        readFileState(file.path, &file.modified, &file.size);
+        file.watchDescriptor = -1;
+#ifdef __linux__
+        //inotify retorna o mesmo descritor se o diretório já estiver sendo observado
+        if(inotifyFd >= 0) {
+            file.watchDescriptor = inotify_add_watch(inotifyFd, file.dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        }
+#endif
+        files.push_back(file);
+        return files.size() - 1;
+    }
+
+    /**
+     * Obtém os arquivos alterados desde a última consulta. Não bloqueia.
+     * @param changed Recebe os identificadores dos arquivos alterados (pode conter repetições).
+     */
+    void poll(std::vector<int> &changed) {
+#ifdef __linux__
+        pollInotify(changed);
+#endif
+        pollByStat(changed);
+    }
+
+    const char* getPath(int id) {
+        return files[id].path.c_str();
+    }
+};
+
+#endif // FILEWATCHER_H_INCLUDED
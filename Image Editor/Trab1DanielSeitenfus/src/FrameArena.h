@@ -0,0 +1,108 @@
+/**
+ * @file FrameArena.h
+ * @brief Definição da classe FrameArena, um alocador linear para objetos temporários de um quadro.
+ *
+ * Os objetos criados durante um quadro (como a cópia da imagem exibida na seção de imagem selecionada) são alocados em sequência em um único bloco,
+ * e liberados todos de uma vez por reset() no início do quadro seguinte. Não há chamadas a new/delete no laço de renderização.
+ */
+
+#ifndef FRAMEARENA_H_INCLUDED
+#define FRAMEARENA_H_INCLUDED
+
+#include <new>
+#include <vector>
+#include <type_traits>
+#include "PixelAllocator.h"
+
+#define FRAME_ARENA_INITIAL_SIZE (64*1024)
+
+/**
+ * Estatísticas do alocador de quadro.
+ */
+struct FrameArenaStats {
+    long long frames;             /**< Quadros (chamadas a reset). */
+    long long allocations;        /**< Alocações no quadro atual. */
+    long long bytes;              /**< Bytes usados no quadro atual. */
+    long long peakBytes;          /**< Maior uso em um quadro. */
+    long long overflowBlocks;     /**< Blocos extras alocados porque o bloco principal encheu. */
+};
+
+class FrameArena {
+    unsigned char *block;
+    size_t capacity;
+    size_t offset;
+    std::vector<void*> overflow; /**< Blocos extras do quadro atual, liberados no reset. */
+    FrameArenaStats stats;
+
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+public:
+    FrameArena(size_t _capacity = FRAME_ARENA_INITIAL_SIZE) : capacity(_capacity), offset(0) {
+        block = PixelAllocator::allocateArray<unsigned char>(capacity);
+        stats = FrameArenaStats();
+    }
+
+    ~FrameArena() {
+        reset();
+        PixelAllocator::release(block);
+    }
+
+    /**
+     * Aloca bytes no quadro atual.
+     * @param bytes Tamanho do bloco.
+     * @param alignment Alinhamento (potência de 2, até PIXEL_ALIGNMENT).
+     * @return Ponteiro válido até o próximo reset().
+     */
+    void* allocate(size_t bytes, size_t alignment = 16) {
+        size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        stats.allocations++;
+        stats.bytes += bytes;
+
+        if(block == NULL || start + bytes > capacity) {
+            //o bloco principal encheu: usa um bloco extra neste quadro e aumenta o principal no próximo reset
+            void *extra = PixelAllocator::allocate(bytes);
+            overflow.push_back(extra);
+            stats.overflowBlocks++;
+            return extra;
+        }
+
+        offset = start + bytes;
+        return block + start;
+    }
+
+    /**
+     * Cria um objeto no quadro atual. O destrutor não é chamado, então apenas tipos com destrutor trivial são aceitos.
+     */
+    template<typename T, typename... Args>
+    T* create(Args... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena: o tipo deve ter destrutor trivial");
+        return new(allocate(sizeof(T), alignof(T))) T(args...);
+    }
+
+    /**
+     * Libera tudo o que foi alocado no quadro. Se houve blocos extras, o bloco principal é aumentado para caber o quadro inteiro.
+     */
+    void reset() {
+        if(stats.bytes > stats.peakBytes) stats.peakBytes = stats.bytes;
+
+        if(!overflow.empty()) {
+            for(size_t i=0; i<overflow.size(); i++) PixelAllocator::release(overflow[i]);
+            overflow.clear();
+            while(capacity < (size_t)stats.peakBytes*2) capacity *= 2;
+            PixelAllocator::release(block);
+            block = PixelAllocator::allocateArray<unsigned char>(capacity);
+        }
+
+        offset = 0;
+        stats.frames++;
+        stats.allocations = 0;
+        stats.bytes = 0;
+    }
+
+    const FrameArenaStats& getStats() {
+        return stats;
+    }
+};
+
+#endif // FRAMEARENA_H_INCLUDED
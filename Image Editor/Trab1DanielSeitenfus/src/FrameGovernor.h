@@ -0,0 +1,248 @@
+/**
+ * @file FrameGovernor.h
+ * @brief Definição da classe FrameGovernor, que reduz a qualidade do desenho para manter o tempo de cada quadro dentro de um orçamento.
+ *
+ * O tempo de cada quadro é medido por subsistema: imagens, histograma e interface (controles e molduras). Quando o quadro excede o orçamento
+ * durante uma interação por GOVERNOR_OVER_FRAMES quadros seguidos, a qualidade é reduzida em um passo, escolhido pelo subsistema mais caro:
+ * um nível de mipmap mais grosso para as imagens do painel, o histograma atualizado apenas a cada GOVERNOR_HISTOGRAM_INTERVAL quadros
+ * ou, para a interface, o MSAA desligado. Os passos são desfeitos na ordem inversa, um por vez, depois de GOVERNOR_RECOVER_FRAMES quadros
+ * abaixo da metade do orçamento, e todos de uma vez quando não há mais interação: a cena parada não precisa de quadros rápidos.
+ * Cada decisão é impressa na saída padrão, com os tempos que a motivaram.
+ */
+
+#ifndef FRAMEGOVERNOR_H_INCLUDED
+#define FRAMEGOVERNOR_H_INCLUDED
+
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+#include "gl_canvas2d.h"
+
+#define GOVERNOR_DEFAULT_BUDGET_MS    16
+#define GOVERNOR_OVER_FRAMES          3   /**< Quadros seguidos acima do orçamento antes de reduzir a qualidade. */
+#define GOVERNOR_RECOVER_FRAMES       30  /**< Quadros seguidos abaixo da metade do orçamento antes de restaurar um passo. */
+#define GOVERNOR_IDLE_FRAMES          30  /**< Quadros sem eventos de entrada após os quais a cena é considerada parada. */
+#define GOVERNOR_MAX_IMAGE_LEVEL      3   /**< Nível de mipmap mais grosso usado nas imagens do painel (1/64 dos pixels). */
+#define GOVERNOR_HISTOGRAM_INTERVAL   4   /**< Com o histograma adiado, ele é atualizado apenas uma vez a cada tantos quadros. */
+
+/**
+ * Subsistemas medidos a cada quadro.
+ */
+enum FrameSubsystem {
+    SUBSYSTEM_IMAGES = 0,
+    SUBSYSTEM_HISTOGRAM,
+    SUBSYSTEM_UI,
+    SUBSYSTEM_COUNT
+};
+
+/**
+ * Qualidade atual do desenho.
+ */
+struct FrameQuality {
+    int imageLevel;          /**< Nível de mipmap das imagens do painel; 0 é a imagem completa. */
+    bool histogramDeferred;  /**< O histograma não é atualizado em todos os quadros. */
+    bool multisample;
+};
+
+class FrameGovernor {
+    /**
+     * Passos de redução de qualidade, desfeitos na ordem inversa.
+     */
+    enum QualityStep {
+        STEP_IMAGE_LEVEL,
+        STEP_HISTOGRAM,
+        STEP_MULTISAMPLE
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    double budgetMs;         /**< 0 desativa o governador. */
+    FrameQuality quality;
+    std::vector<QualityStep> steps;
+
+    Clock::time_point frameStart, lastSwitch;
+    double costs[SUBSYSTEM_COUNT];
+    static const int STACK_SIZE = 8;
+    int stack[STACK_SIZE];
+    int depth;               /**< Subsistemas aninhados em andamento; o tempo é contado apenas no mais interno. */
+
+    long long frame;
+    int overFrames, underFrames, idleFrames;
+    long long frames, slowFrames, reductions, restorations;
+
+    static double elapsedMs(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    /**
+     * Conta o tempo desde a última troca no subsistema em andamento.
+     */
+    void charge(Clock::time_point now) {
+        int top = depth < STACK_SIZE ? depth : STACK_SIZE; //níveis além da pilha contam no último guardado
+        if(top > 0) costs[stack[top-1]] += elapsedMs(lastSwitch, now);
+        lastSwitch = now;
+    }
+
+    static const char* getStepName(QualityStep step) {
+        switch(step) {
+            case STEP_IMAGE_LEVEL: return "resolucao das imagens";
+            case STEP_HISTOGRAM:   return "frequencia do histograma";
+            default:               return "MSAA";
+        }
+    }
+
+    bool canReduce(FrameSubsystem subsystem) {
+        switch(subsystem) {
+            case SUBSYSTEM_IMAGES:    return quality.imageLevel < GOVERNOR_MAX_IMAGE_LEVEL;
+            case SUBSYSTEM_HISTOGRAM: return !quality.histogramDeferred;
+            default:                  return quality.multisample;
+        }
+    }
+
+    /**
+     * Reduz a qualidade do subsistema mais caro que ainda pode ser reduzido.
+     */
+    void reduce(double total) {
+        FrameSubsystem order[SUBSYSTEM_COUNT] = {SUBSYSTEM_IMAGES, SUBSYSTEM_HISTOGRAM, SUBSYSTEM_UI};
+        for(int i=1; i<SUBSYSTEM_COUNT; i++) {
+            for(int j=i; j>0 && costs[order[j]] > costs[order[j-1]]; j--) {
+                FrameSubsystem swap = order[j]; order[j] = order[j-1]; order[j-1] = swap;
+            }
+        }
+
+        for(int i=0; i<SUBSYSTEM_COUNT; i++) {
+            if(!canReduce(order[i])) continue;
+            QualityStep step;
+            if(order[i] == SUBSYSTEM_IMAGES) {
+                quality.imageLevel++;
+                step = STEP_IMAGE_LEVEL;
+            } else if(order[i] == SUBSYSTEM_HISTOGRAM) {
+                quality.histogramDeferred = true;
+                step = STEP_HISTOGRAM;
+            } else {
+                quality.multisample = false;
+                CV::setMultisample(false);
+                step = STEP_MULTISAMPLE;
+            }
+            steps.push_back(step);
+            reductions++;
+            printf("\nGovernador (quadro %lld): %.1f ms (imagens %.1f, histograma %.1f, interface %.1f) acima de %.0f ms; reduzido: %s (imagens no nivel %d)",
+                   frame, total, costs[SUBSYSTEM_IMAGES], costs[SUBSYSTEM_HISTOGRAM], costs[SUBSYSTEM_UI], budgetMs, getStepName(step), quality.imageLevel);
+            return;
+        }
+    }
+
+    /**
+     * Desfaz o último passo de redução.
+     */
+    void restore(double total, const char *reason) {
+        QualityStep step = steps.back();
+        steps.pop_back();
+        if(step == STEP_IMAGE_LEVEL) {
+            quality.imageLevel--;
+        } else if(step == STEP_HISTOGRAM) {
+            quality.histogramDeferred = false;
+        } else {
+            quality.multisample = true;
+            CV::setMultisample(true);
+        }
+        restorations++;
+        printf("\nGovernador (quadro %lld): %.1f ms, %s; restaurado: %s (imagens no nivel %d)", frame, total, reason, getStepName(step), quality.imageLevel);
+    }
+
+public:
+    FrameGovernor() : budgetMs(GOVERNOR_DEFAULT_BUDGET_MS), depth(0), frame(0), overFrames(0), underFrames(0), idleFrames(0),
+                      frames(0), slowFrames(0), reductions(0), restorations(0) {
+        quality.imageLevel = 0;
+        quality.histogramDeferred = false;
+        quality.multisample = true;
+        for(int i=0; i<SUBSYSTEM_COUNT; i++) costs[i] = 0;
+    }
+
+    /**
+     * Define o orçamento de cada quadro.
+     * @param milliseconds Tempo alvo; 0 desativa o governador, que mantém a qualidade máxima.
+     */
+    void setBudget(double milliseconds) {
+        budgetMs = milliseconds > 0 ? milliseconds : 0;
+    }
+
+    const FrameQuality& getQuality() {
+        return quality;
+    }
+
+    /**
+     * Indica se o histograma pode ser atualizado neste quadro.
+     */
+    bool isHistogramRefreshAllowed() {
+        return !quality.histogramDeferred || frame % GOVERNOR_HISTOGRAM_INTERVAL == 0;
+    }
+
+    /**
+     * Início de um quadro, antes da atualização da cena.
+     */
+    void beginFrame() {
+        frameStart = lastSwitch = Clock::now();
+        depth = 0;
+        for(int i=0; i<SUBSYSTEM_COUNT; i++) costs[i] = 0;
+    }
+
+    /**
+     * Passa a contar o tempo no subsistema, até a chamada correspondente de leave. Pode ser aninhada.
+     */
+    void enter(FrameSubsystem subsystem) {
+        charge(Clock::now());
+        if(depth < STACK_SIZE) stack[depth] = subsystem;
+        depth++;
+    }
+
+    void leave() {
+        charge(Clock::now());
+        if(depth > 0) depth--;
+    }
+
+    /**
+     * Fim do quadro: compara o tempo total com o orçamento e decide se a qualidade deve ser reduzida ou restaurada.
+     * @param hadInput true se algum evento de entrada foi despachado neste quadro.
+     */
+    void endFrame(bool hadInput) {
+        Clock::time_point now = Clock::now();
+        double total = elapsedMs(frameStart, now);
+        frame++;
+        frames++;
+        if(budgetMs <= 0) return;
+
+        idleFrames = hadInput ? 0 : idleFrames + 1;
+        bool over = total > budgetMs;
+        if(over) slowFrames++;
+
+        if(idleFrames >= GOVERNOR_IDLE_FRAMES) {
+            overFrames = underFrames = 0;
+            while(!steps.empty()) restore(total, "sem interacao");
+            return;
+        }
+
+        overFrames = over ? overFrames + 1 : 0;
+        underFrames = total < budgetMs/2 ? underFrames + 1 : 0;
+        if(overFrames >= GOVERNOR_OVER_FRAMES) {
+            overFrames = 0;
+            reduce(total);
+        } else if(underFrames >= GOVERNOR_RECOVER_FRAMES && !steps.empty()) {
+            underFrames = 0;
+            restore(total, "abaixo da metade do orcamento");
+        }
+    }
+
+    /**
+     * Imprime os quadros acima do orçamento e as decisões tomadas.
+     */
+    void printStats() {
+        if(budgetMs <= 0) return;
+        printf("\nGovernador de quadros: orcamento de %.0f ms, %lld de %lld quadros acima, %lld reducoes e %lld restauracoes de qualidade\n",
+               budgetMs, slowFrames, frames, reductions, restorations);
+    }
+};
+
+FrameGovernor frameGovernor; /**< Mede os quadros da thread do GLUT e define a qualidade do desenho. */
+
+#endif // FRAMEGOVERNOR_H_INCLUDED
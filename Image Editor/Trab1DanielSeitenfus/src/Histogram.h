@@ -4,27 +4,28 @@
 #include <vector>
 #include "gl_canvas2d.h"
 #include "Bmp.h"
+#include "Widget.h"
+#include "FrameGovernor.h"
 using namespace std;
 
 /**
  * @file Histogram.h
- * @brief Definio da classe Histogram, que representa um histograma de uma imagem.
+ * @brief Definição da classe Histogram, que representa um histograma de uma imagem.
  */
 
 /**
- * Modos de visualizao do histograma. O grfico pode estar "preenchido" ou "vazado", permitindo diferentes vises.
+ * Modos de visualização do histograma. O gráfico pode estar "preenchido" ou "vazado", permitindo diferentes visões.
  */
 enum class HistogramVisualMode {
     FILLED = 0,
     UNFILLED
 };
 
-HistogramVisualMode visualMode;
-
 /**
- * Classe que representa um histograma de uma imagem.
+ * Classe que representa um histograma de uma imagem. As colunas só são redesenhadas quando os valores ou o modo de visualização mudam.
  */
-class Histogram {
+class Histogram : public Widget {
+    HistogramVisualMode visualMode;
     int height, width;
     float xIncrementer;
     Image *image;
@@ -34,16 +35,18 @@ class Histogram {
     vector<int> bVector;
     vector<int> lVector;
 
-    //Variveis auxiliares para renderizao.
-    const int NUM_COLORS = 256;
-    int bytesPerRow;
-    int rowPadding;
+    //Variáveis auxiliares para renderização.
+    const int NUM_COLORS = HISTOGRAM_SIZE;
     float lightness;
 
-public:
-    int x1=0, y1=0, x2=200, y2=200;
+    //Conteúdo, brilho e canais dos valores atuais, para recalculá-los apenas quando mudarem. O conteúdo é identificado pela
+    //geração do Bmp, e não pelo ponteiro dos pixels: a recarga troca o conteúdo do mesmo Bmp, e os pixels novos podem reaproveitar o endereço dos antigos.
+    unsigned int shownGeneration = 0;
+    float shownLightness = 0;
+    bool shownR = false, shownG = false, shownB = false, shownL = false;
 
-    Histogram(int _x1, int _y1, int _x2, int _y2, Image *_image) : x1(_x1), y1(_y1), x2(_x2), y2(_y2), image(_image) {
+public:
+    Histogram(int _x1, int _y1, int _x2, int _y2, Image *_image) : Widget(_x1, _y1, _x2, _y2), image(_image) {
         width = x2-x1;
         height = y2-y1;
         xIncrementer = width/NUM_COLORS;
@@ -52,7 +55,7 @@ public:
         generateRGBVectors();
     }
 
-    Histogram(int _x1, int _y1, int _x2, int _y2) : x1(_x1), y1(_y1), x2(_x2), y2(_y2) {
+    Histogram(int _x1, int _y1, int _x2, int _y2) : Widget(_x1, _y1, _x2, _y2), image(nullptr) {
         width = x2-x1;
         height = y2-y1;
         xIncrementer = width/NUM_COLORS;
@@ -66,25 +69,26 @@ public:
     }
 
     /**
-    * Inicializa variveis auxiliares da classe.
+    * Inicializa variáveis auxiliares da classe.
     */
     void setupVariables() {
-        rowPadding = image->getBmp()->getRowPadding();
-        bytesPerRow = image->getBmp()->getWidth() * 3 + rowPadding;
         lightness = image->getLightness()*(NUM_COLORS-1);
     }
 
     /**
-     * Altera o modo de visualizao do histograma.
+     * Altera o modo de visualização do histograma.
      */
-    static void changeVisualizationOption() {
+    void changeVisualizationOption() {
         visualMode = visualMode == HistogramVisualMode::FILLED ? HistogramVisualMode::UNFILLED : HistogramVisualMode::FILLED;
+        invalidate();
     }
 
     /**
-     *  Renderiza o histograma na tela.
+     *  Desenha o histograma.
      */
-    void render() {
+    void draw() {
+        frameGovernor.enter(SUBSYSTEM_HISTOGRAM);
+        highest = 0;
         CV::color(0,0,0);
         CV::rect(x1, y1, x2, y2);
 
@@ -92,6 +96,7 @@ public:
         renderHistogramColumns(gVector, Color::GREEN);
         renderHistogramColumns(bVector, Color::BLUE);
         renderHistogramColumns(lVector, Color::GREY);
+        frameGovernor.leave();
     }
 
     /**
@@ -124,7 +129,7 @@ public:
     }
 
      /**
-     * @brief Obtm a altura de uma linha do histograma com base em seu valor.
+     * @brief Obtém a altura de uma linha do histograma com base em seu valor.
      * @param lineValue Valor da linha.
      * @return Altura da linha.
      */
@@ -133,19 +138,39 @@ public:
     }
 
 
+    /**
+     * Verifica se os valores exibidos não correspondem mais à imagem (conteúdo do Bmp, brilho ou canais selecionados diferentes).
+     */
+    bool needsRefresh(Image *_image) {
+        return getContentGeneration(_image) != shownGeneration || _image->getLightness() != shownLightness || _image->rSelected != shownR ||
+               _image->gSelected != shownG || _image->bSelected != shownB || _image->lSelected != shownL;
+    }
+
    /**
-     * Define a imagem associada ao histograma.
+     * Define a imagem associada ao histograma, recalcula os valores e marca as colunas para serem redesenhadas.
      * @param _image Ponteiro para a imagem.
      */
     void setImage(Image *_image) {
+        frameGovernor.enter(SUBSYSTEM_HISTOGRAM);
         image = _image;
         setupVariables();
         generateRGBVectors();
+        shownGeneration = getContentGeneration(image);
+        shownLightness = image->getLightness();
+        shownR = image->rSelected;
+        shownG = image->gSelected;
+        shownB = image->bSelected;
+        shownL = image->lSelected;
+        frameGovernor.leave();
     }
 
 private:
     int highest = 0; /**< Valor mais alto do histograma */
 
+    static unsigned int getContentGeneration(Image *_image) {
+        return _image->getBmp() != nullptr ? _image->getBmp()->getContentGeneration() : 0;
+    }
+
     /**
      * Calcula o valor mais alto do histograma.
      * @param vetor Vetor com os valores do histograma.
@@ -159,50 +184,45 @@ private:
     }
 
     /**
-     * @brief Gera os vetores de RGB e luminncia para a imagem associada.
+     * @brief Gera os vetores de RGB e luminância para a imagem associada.
+     * Parte dos histogramas calculados no carregamento do Bmp: o brilho apenas desloca cada valor, então basta percorrer os 256 valores
+     * de cada canal, sem uma nova passada pelos pixels da imagem. A luminância original é agrupada em valores inteiros no carregamento.
+     * As colunas são marcadas para serem redesenhadas: a display list com os valores anteriores não vale mais.
      */
     void generateRGBVectors() {
+        invalidate();
         clearVectors();
         if(image == nullptr || image->getBmp() == nullptr) return;
 
-        Bmp *bitmap = image->getBmp();
-        uchar* data = bitmap->getImage();
-
-        for (int i = 0; i < bitmap->getHeight(); i++) {
-            int rowOffset = i * bytesPerRow;
-           for (int j = 0; j < bitmap->getWidth(); j++) {
-               int pixelPosition = rowOffset + j * 3;
-               unsigned char r = data[pixelPosition];
-               unsigned char g = data[pixelPosition + 1];
-               unsigned char b = data[pixelPosition + 2];
-
-                if(image->rSelected) {
-                    int value = r-lightness;
-                    if(isInRgbRange(value))rVector[value]++;
-               }
-
-               if(image->gSelected) {
-                    int value = g-lightness;
-                    if(isInRgbRange(value))gVector[value]++;
-               }
-
-               if(image->bSelected) {
-                    int value = b-lightness;
-                    if(isInRgbRange(value))bVector[value]++;
-               }
-
-               if (image->lSelected) {
-                   float luminance = Image::getLuminance(r,g,b)-lightness;
-                   if(isInRgbRange(luminance)) lVector[luminance]++;
-               }
-           }
-       }
+        const IMAGESTATS *stats = image->getBmp()->getStats();
+
+        for (int v = 0; v < NUM_COLORS; v++) {
+            if(image->rSelected) {
+                int value = v-lightness;
+                if(isInRgbRange(value)) rVector[value] += stats->histogram[CHANNEL_R][v];
+            }
+
+            if(image->gSelected) {
+                int value = v-lightness;
+                if(isInRgbRange(value)) gVector[value] += stats->histogram[CHANNEL_G][v];
+            }
+
+            if(image->bSelected) {
+                int value = v-lightness;
+                if(isInRgbRange(value)) bVector[value] += stats->histogram[CHANNEL_B][v];
+            }
+
+            if (image->lSelected) {
+                float luminance = v-lightness;
+                if(isInRgbRange(luminance)) lVector[luminance] += stats->histogram[CHANNEL_L][v];
+            }
+        }
     }
 
     /**
-     * Verifica se um valor est dentro do intervalo RGB vlido.
+     * Verifica se um valor está dentro do intervalo RGB válido.
      * @param value Valor a ser verificado.
-     * @return true se o valor estiver dentro do intervalo vlido, false caso contrrio.
+     * @return true se o valor estiver dentro do intervalo válido, false caso contrário.
      */
     bool isInRgbRange(int value) {
         return value > 0 && value < NUM_COLORS;
@@ -0,0 +1,419 @@
+/**
+ * @file IconAtlas.h
+ * @brief Definição da classe IconAtlas, que reúne os ícones da interface em uma única textura RGBA.
+ *
+ * Os ícones são empacotados em prateleiras (linhas de ícones ordenados pela altura) em uma imagem RGBA com transparência real:
+ * o fundo branco dos arquivos BMP vira alfa 0, e arquivos QOI com 4 canais mantêm o próprio alfa.
+ * O atlas é gravado em um único arquivo (cabeçalho, tabela de ícones e pixels em QOI). Nas execuções seguintes apenas esse arquivo é lido,
+ * sem decodificar os ícones; ele é refeito quando algum arquivo de origem muda de tamanho ou data de modificação.
+ * Na tela, o atlas vira uma textura e os ícones são desenhados como retângulos texturizados em um único lote (begin/drawIcon/end).
+ * Quando a CV grava o quadro para a thread de renderização, o lote é gravado e a textura é criada e usada por aquela thread.
+ */
+
+#ifndef ICONATLAS_H_INCLUDED
+#define ICONATLAS_H_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "gl_canvas2d.h"
+#include "Bmp.h"
+#include "Qoi.h"
+
+#define ICON_ATLAS_VERSION   1
+#define ICON_NAME_SIZE       32
+#define ICON_ATLAS_PADDING   1   /**< Espaço entre ícones, evita que a filtragem misture ícones vizinhos. */
+#define ICON_ATLAS_WIDTH     256 /**< Largura das prateleiras (aumentada se algum ícone for mais largo). */
+#define ICON_WHITE_KEY       178 /**< Canais acima deste valor (0.70) formam o fundo branco dos ícones BMP. */
+#define ICON_MAX_SIZE        1024 /**< Largura e altura máximas de um ícone; cabeçalhos maiores são tratados como corrompidos. */
+
+/**
+ * Cabeçalho do arquivo do atlas, seguido por iconCount registros ATLASICON e pelos pixels codificados em QOI (RGBA, de cima para baixo).
+ */
+typedef struct {
+    char magic[4];              /**< "ATL1" */
+    unsigned int version;
+    int width, height;
+    int iconCount;
+} ATLASHEADER;
+
+/**
+ * Posição de um ícone no atlas (y a partir do topo) e a assinatura do arquivo de origem.
+ */
+typedef struct {
+    char name[ICON_NAME_SIZE];  /**< Nome do arquivo de origem, sem diretório e extensão. */
+    int x, y, width, height;
+    long long sourceSize;
+    long long sourceModified;
+} ATLASICON;
+
+class IconAtlas {
+    /**
+     * Lote de ícones gravado pela CV para a thread de renderização, que cria a textura e desenha o lote.
+     */
+    class IconBatch : public CVCommand {
+        struct Entry {
+            int index;
+            float x, y;
+        };
+        IconAtlas *atlas;
+        std::vector<Entry> entries;
+
+    public:
+        IconBatch(IconAtlas *_atlas) : atlas(_atlas) {}
+
+        void add(int index, float x, float y) {
+            Entry entry = {index, x, y};
+            entries.push_back(entry);
+        }
+
+        void execute() {
+            atlas->upload();
+            atlas->begin();
+            for(size_t i=0; i<entries.size(); i++) atlas->drawIcon(entries[i].index, entries[i].x, entries[i].y);
+            atlas->end();
+        }
+    };
+
+    std::vector<unsigned char> pixels; /**< RGBA, linhas de cima para baixo. */
+    std::vector<ATLASICON> icons;
+    int width, height;
+    GLuint texture;           /**< Usada apenas pela thread que desenha. */
+    IconBatch *recordingBatch; /**< Lote em gravação, usado apenas pela thread que grava. */
+
+    IconAtlas(const IconAtlas&);
+    IconAtlas& operator=(const IconAtlas&);
+
+    /**
+     * Nome do ícone: o nome do arquivo sem diretório e extensão.
+     */
+    static std::string iconName(const char *fileName) {
+        std::string name(fileName);
+        size_t slash = name.find_last_of("/\\");
+        if(slash != std::string::npos) name = name.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        if(dot != std::string::npos) name = name.substr(0, dot);
+        return name;
+    }
+
+    static bool readSignature(const char *fileName, long long *size, long long *modified) {
+        struct stat info;
+        if(stat(fileName, &info) != 0) return false;
+        *size = (long long)info.st_size;
+        *modified = (long long)info.st_mtime;
+        return true;
+    }
+
+    static bool isValidIconSize(int iconWidth, int iconHeight) {
+        return iconWidth > 0 && iconHeight > 0 && iconWidth <= ICON_MAX_SIZE && iconHeight <= ICON_MAX_SIZE;
+    }
+
+    /**
+     * Lê um ícone para RGBA (de cima para baixo).
+     * @return false se o arquivo não puder ser lido, tiver dimensões inválidas ou estiver truncado.
+     */
+    static bool readIcon(const char *fileName, std::vector<unsigned char> &rgba, int *iconWidth, int *iconHeight) {
+        FILE *fp = fopen(fileName, "rb");
+        if(fp == NULL) return false;
+        unsigned char magic[4] = {0};
+        bool isQoi = fread(magic, 1, 4, fp) == 4 && Qoi::isQoi(magic);
+
+        if(isQoi) {
+            //QOI com alfa: decodificado diretamente em RGBA, preservando a transparência do arquivo
+            fseek(fp, 0, SEEK_END);
+            long size = ftell(fp);
+            std::vector<unsigned char> bytes(size > 0 ? size : 0);
+            fseek(fp, 0, SEEK_SET);
+            bool ok = size > QOI_HEADER_SIZE && (long)fread(&bytes[0], 1, size, fp) == size;
+            fclose(fp);
+
+            QOIHEADER header;
+            if(!ok || !Qoi::readHeader(&bytes[0], &header) || !isValidIconSize(header.width, header.height)) return false;
+            *iconWidth = header.width;
+            *iconHeight = header.height;
+            rgba.resize((size_t)header.width*header.height*4);
+            QoiDecoder decoder(&bytes[QOI_HEADER_SIZE], size - QOI_HEADER_SIZE);
+            if(!decoder.decodePixels(&rgba[0], header.width*header.height, 4)) return false;
+            if(header.channels == 3) {
+                for(size_t i=3; i<rgba.size(); i+=4) rgba[i] = 255;
+            }
+            return true;
+        }
+        fclose(fp);
+
+        //BMP: fundo branco vira transparente (mesma regra da exibição de ícones em Image)
+        Bmp bmp(fileName);
+        if(!bmp.isValid() || !isValidIconSize(bmp.getWidth(), bmp.getHeight())) return false;
+        if(!bmp.decode() || bmp.getImage() == NULL) return false;
+        *iconWidth = bmp.getWidth();
+        *iconHeight = bmp.getHeight();
+        int stride = bmp.getWidth()*3 + bmp.getRowPadding();
+        rgba.resize((size_t)bmp.getWidth()*bmp.getHeight()*4);
+        for(int y=0; y<bmp.getHeight(); y++) {
+            const unsigned char *src = bmp.getImage() + (bmp.getHeight() - 1 - y)*stride; //Bmp em memória é de baixo para cima
+            unsigned char *dst = &rgba[(size_t)y*bmp.getWidth()*4];
+            for(int x=0; x<bmp.getWidth(); x++) {
+                dst[x*4]     = src[x*3];
+                dst[x*4 + 1] = src[x*3 + 1];
+                dst[x*4 + 2] = src[x*3 + 2];
+                bool white = src[x*3] > ICON_WHITE_KEY && src[x*3 + 1] > ICON_WHITE_KEY && src[x*3 + 2] > ICON_WHITE_KEY;
+                dst[x*4 + 3] = white ? 0 : 255;
+            }
+        }
+        return true;
+    }
+
+    static bool compareHeight(const std::pair<int, int> &a, const std::pair<int, int> &b) {
+        return a.second > b.second;
+    }
+
+public:
+    IconAtlas() : width(0), height(0), texture(0), recordingBatch(nullptr) {}
+
+    ~IconAtlas() {
+        if(texture != 0) glDeleteTextures(1, &texture);
+    }
+
+    /**
+     * Carrega o atlas do arquivo ou, se ele não existir ou estiver desatualizado, monta o atlas a partir dos ícones e grava o arquivo.
+     * @param atlasFile Arquivo do atlas.
+     * @param sources Arquivos dos ícones (BMP ou QOI).
+     * @param count Número de ícones.
+     * @return false se algum ícone não pôde ser lido.
+     */
+    bool open(const char *atlasFile, const char **sources, int count) {
+        if(load(atlasFile, sources, count)) return true;
+        if(!build(sources, count)) return false;
+        if(!write(atlasFile)) printf("\nAviso: nao foi possivel gravar o atlas de icones %s", atlasFile);
+        return true;
+    }
+
+    /**
+     * Lê o atlas gravado. Falha se ele não contiver exatamente os ícones informados, com as mesmas assinaturas de arquivo.
+     */
+    bool load(const char *atlasFile, const char **sources, int count) {
+        FILE *fp = fopen(atlasFile, "rb");
+        if(fp == NULL) return false;
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        std::vector<unsigned char> bytes(size > 0 ? size : 0);
+        bool ok = size > (long)sizeof(ATLASHEADER) && (long)fread(&bytes[0], 1, size, fp) == size;
+        fclose(fp);
+        if(!ok) return false;
+
+        ATLASHEADER header;
+        memcpy(&header, &bytes[0], sizeof(ATLASHEADER));
+        long tableEnd = sizeof(ATLASHEADER) + (long)header.iconCount*sizeof(ATLASICON);
+        if(memcmp(header.magic, "ATL1", 4) != 0 || header.version != ICON_ATLAS_VERSION || header.iconCount != count ||
+           tableEnd + QOI_HEADER_SIZE > size) return false;
+
+        std::vector<ATLASICON> table(count);
+        if(count > 0) memcpy(&table[0], &bytes[sizeof(ATLASHEADER)], count*sizeof(ATLASICON));
+        for(int i=0; i<count; i++) {
+            long long sourceSize, sourceModified;
+            table[i].name[ICON_NAME_SIZE - 1] = '\0';
+            if(!readSignature(sources[i], &sourceSize, &sourceModified) || iconName(sources[i]) != table[i].name ||
+               table[i].sourceSize != sourceSize || table[i].sourceModified != sourceModified ||
+               table[i].x < 0 || table[i].y < 0 || table[i].x + table[i].width > header.width || table[i].y + table[i].height > header.height) {
+                return false;
+            }
+        }
+
+        QOIHEADER qoiHeader;
+        if(!Qoi::readHeader(&bytes[tableEnd], &qoiHeader) || (int)qoiHeader.width != header.width || (int)qoiHeader.height != header.height) return false;
+        std::vector<unsigned char> decoded((size_t)header.width*header.height*4);
+        QoiDecoder decoder(&bytes[tableEnd + QOI_HEADER_SIZE], size - tableEnd - QOI_HEADER_SIZE);
+        if(!decoder.decodePixels(&decoded[0], header.width*header.height, 4)) return false;
+
+        pixels.swap(decoded);
+        icons.swap(table);
+        width = header.width;
+        height = header.height;
+        return true;
+    }
+
+    /**
+     * Monta o atlas a partir dos arquivos dos ícones, em prateleiras ordenadas pela altura.
+     */
+    bool build(const char **sources, int count) {
+        std::vector<std::vector<unsigned char> > images(count);
+        std::vector<ATLASICON> table(count);
+        std::vector<std::pair<int, int> > order; //(índice, altura)
+
+        for(int i=0; i<count; i++) {
+            memset(&table[i], 0, sizeof(ATLASICON));
+            if(!readIcon(sources[i], images[i], &table[i].width, &table[i].height) ||
+               !readSignature(sources[i], &table[i].sourceSize, &table[i].sourceModified)) {
+                printf("\nErro: nao foi possivel ler o icone %s", sources[i]);
+                return false;
+            }
+            strncpy(table[i].name, iconName(sources[i]).c_str(), ICON_NAME_SIZE - 1);
+            order.push_back(std::make_pair(i, table[i].height));
+        }
+        std::stable_sort(order.begin(), order.end(), compareHeight);
+
+        int atlasWidth = 1;
+        for(int i=0; i<count; i++) atlasWidth = std::max(atlasWidth, table[i].width + ICON_ATLAS_PADDING);
+        atlasWidth = std::max(atlasWidth, ICON_ATLAS_WIDTH);
+
+        int shelfX = 0, shelfY = 0, shelfHeight = 0;
+        for(size_t k=0; k<order.size(); k++) {
+            ATLASICON *icon = &table[order[k].first];
+            if(shelfX + icon->width > atlasWidth) {
+                shelfY += shelfHeight + ICON_ATLAS_PADDING;
+                shelfX = shelfHeight = 0;
+            }
+            icon->x = shelfX;
+            icon->y = shelfY;
+            shelfX += icon->width + ICON_ATLAS_PADDING;
+            shelfHeight = std::max(shelfHeight, icon->height);
+        }
+
+        //dimensões em potências de 2, aceitas por qualquer implementação do OpenGL
+        int atlasHeight = 1;
+        while(atlasHeight < shelfY + shelfHeight) atlasHeight *= 2;
+        int powerWidth = 1;
+        while(powerWidth < atlasWidth) powerWidth *= 2;
+
+        std::vector<unsigned char> atlas((size_t)powerWidth*atlasHeight*4, 0);
+        for(int i=0; i<count; i++) {
+            for(int y=0; y<table[i].height; y++) {
+                memcpy(&atlas[((size_t)(table[i].y + y)*powerWidth + table[i].x)*4], &images[i][(size_t)y*table[i].width*4], table[i].width*4);
+            }
+        }
+
+        pixels.swap(atlas);
+        icons.swap(table);
+        width = powerWidth;
+        height = atlasHeight;
+        if(texture != 0) {
+            glDeleteTextures(1, &texture);
+            texture = 0;
+        }
+        return true;
+    }
+
+    /**
+     * Grava o atlas em um arquivo temporário e o renomeia, para que um arquivo parcial nunca seja lido.
+     */
+    bool write(const char *atlasFile) {
+        int qoiSize = 0;
+        unsigned char *qoi = Qoi::encode(&pixels[0], width, height, 4, width*4, false, &qoiSize);
+        if(qoi == NULL) return false;
+
+        ATLASHEADER header;
+        memset(&header, 0, sizeof(ATLASHEADER));
+        memcpy(header.magic, "ATL1", 4);
+        header.version = ICON_ATLAS_VERSION;
+        header.width = width;
+        header.height = height;
+        header.iconCount = icons.size();
+
+        std::string temporary = std::string(atlasFile) + ".tmp";
+        FILE *fp = fopen(temporary.c_str(), "wb");
+        bool ok = fp != NULL;
+        if(ok) {
+            ok = fwrite(&header, sizeof(ATLASHEADER), 1, fp) == 1;
+            ok = ok && (icons.empty() || fwrite(&icons[0], sizeof(ATLASICON), icons.size(), fp) == icons.size());
+            ok = ok && fwrite(qoi, 1, qoiSize, fp) == (size_t)qoiSize;
+            ok = (fclose(fp) == 0) && ok;
+        }
+        delete[] qoi;
+
+        if(ok) {
+            remove(atlasFile); //no Windows, rename não substitui um arquivo existente
+            ok = rename(temporary.c_str(), atlasFile) == 0;
+        }
+        if(!ok) remove(temporary.c_str());
+        return ok;
+    }
+
+    /**
+     * Procura um ícone pelo nome (nome do arquivo sem diretório e extensão).
+     * @return Índice do ícone, ou -1.
+     */
+    int find(const char *name) {
+        std::string key = iconName(name);
+        for(size_t i=0; i<icons.size(); i++) {
+            if(key == icons[i].name) return i;
+        }
+        return -1;
+    }
+
+    const ATLASICON* getIcon(int index) {
+        if(index < 0 || index >= (int)icons.size()) return nullptr;
+        return &icons[index];
+    }
+
+    /**
+     * Cria a textura. Deve ser chamada com o contexto OpenGL ativo e fora da compilação de display lists.
+     */
+    void upload() {
+        if(texture != 0 || pixels.empty()) return;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    /**
+     * Inicia o lote de ícones: liga a textura (uma única vez para todos os ícones) e a mistura por alfa.
+     */
+    void begin() {
+        if(CV::isRecording()) {
+            recordingBatch = new IconBatch(this);
+            return;
+        }
+        CV::flush();
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBegin(GL_QUADS);
+    }
+
+    /**
+     * Desenha um ícone com o canto inferior esquerdo em (x, y). Deve ser chamada entre begin e end.
+     */
+    void drawIcon(int index, float x, float y) {
+        if(CV::isRecording()) {
+            recordingBatch->add(index, x, y);
+            return;
+        }
+        const ATLASICON *icon = getIcon(index);
+        if(icon == nullptr) return;
+        float u1 = (float)icon->x/width, u2 = (float)(icon->x + icon->width)/width;
+        float v1 = (float)icon->y/height, v2 = (float)(icon->y + icon->height)/height; //v1 é o topo do ícone
+        glTexCoord2f(u1, v2); glVertex2f(x, y);
+        glTexCoord2f(u2, v2); glVertex2f(x + icon->width, y);
+        glTexCoord2f(u2, v1); glVertex2f(x + icon->width, y + icon->height);
+        glTexCoord2f(u1, v1); glVertex2f(x, y + icon->height);
+    }
+
+    /**
+     * Encerra o lote de ícones.
+     */
+    void end() {
+        if(CV::isRecording()) {
+            CV::record(recordingBatch);
+            recordingBatch = nullptr;
+            return;
+        }
+        glEnd();
+        glDisable(GL_BLEND);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+    }
+};
+
+#endif // ICONATLAS_H_INCLUDED
@@ -1,16 +1,98 @@
 /**
  * @file Image.h
- * @brief Definio da classe Image para representar uma imagem.
+ * @brief Definição da classe Image para representar uma imagem.
  *
- * Este arquivo contm a definio da classe Image, que representa uma imagem bitmap (BMP) e suas propriedades, como posio, seleo, efeitos de visualizao, entre outros.
+ * Este arquivo contém a definição da classe Image, que representa uma imagem bitmap (BMP) e suas propriedades, como posição, seleção, efeitos de visualização, entre outros.
  */
 
 #ifndef IMAGE_H_INCLUDED
 #define IMAGE_H_INCLUDED
 
+#include <math.h>
+#include <limits.h>
+#include <vector>
 #include "Bmp.h"
+#include "ImageEffects.h"
+#include "DrawList.h"
 using namespace std;
 
+#define IMAGE_MAX_CLIP_RECTS 16 /**< Partes visíveis desenhadas separadamente; com mais partes, é usado o retângulo que as envolve. */
+
+/**
+ * Retângulo de recorte, em coordenadas da canvas: apenas os pixels da imagem que o intersectam são desenhados.
+ */
+struct ClipRect {
+    int x1, y1, x2, y2; /**< x2 e y2 exclusivos. */
+
+    /**
+     * Retângulo que não recorta nada.
+     */
+    static ClipRect unbounded() {
+        ClipRect clip = {INT_MIN/2, INT_MIN/2, INT_MAX/2, INT_MAX/2};
+        return clip;
+    }
+
+    ClipRect intersect(const ClipRect &other) const {
+        ClipRect clip = {x1 > other.x1 ? x1 : other.x1, y1 > other.y1 ? y1 : other.y1,
+                         x2 < other.x2 ? x2 : other.x2, y2 < other.y2 ? y2 : other.y2};
+        return clip;
+    }
+
+    /**
+     * Verifica se o retângulo [_x1, _x2) x [_y1, _y2) está totalmente fora do recorte.
+     */
+    bool excludes(int _x1, int _y1, int _x2, int _y2) const {
+        return _x2 <= x1 || _x1 >= x2 || _y2 <= y1 || _y1 >= y2;
+    }
+
+    long long getArea() const {
+        return x2 > x1 && y2 > y1 ? (long long)(x2 - x1)*(y2 - y1) : 0;
+    }
+
+    /**
+     * Acrescenta a out as partes de r fora de cover (até quatro retângulos disjuntos).
+     */
+    static void subtract(const ClipRect &r, const ClipRect &cover, std::vector<ClipRect> &out) {
+        if(cover.excludes(r.x1, r.y1, r.x2, r.y2)) {
+            out.push_back(r);
+            return;
+        }
+        int top = r.y1 > cover.y1 ? r.y1 : cover.y1;
+        int bottom = r.y2 < cover.y2 ? r.y2 : cover.y2;
+        if(r.y1 < cover.y1) out.push_back(ClipRect{r.x1, r.y1, r.x2, cover.y1});
+        if(cover.y2 < r.y2) out.push_back(ClipRect{r.x1, cover.y2, r.x2, r.y2});
+        if(r.x1 < cover.x1) out.push_back(ClipRect{r.x1, top, cover.x1, bottom});
+        if(cover.x2 < r.x2) out.push_back(ClipRect{cover.x2, top, r.x2, bottom});
+    }
+
+    /**
+     * Calcula os índices [first, last) dos blocos de uma fileira que intersectam o intervalo [low, high) do recorte.
+     * O bloco i ocupa [start + i*step, start + i*step + size), com step igual a size ou -size.
+     */
+    static void clipRange(int start, int step, int size, int count, int low, int high, int *first, int *last) {
+        double a, b;
+        if(step > 0) {
+            a = floor((double)(low - start - size)/size) + 1;
+            b = ceil((double)(high - start)/size);
+        } else {
+            a = floor((double)(start - high)/size) + 1;
+            b = ceil((double)(start + size - low)/size);
+        }
+        *first = a < 0 ? 0 : (a > count ? count : (int)a);
+        *last = b < *first ? *first : (b > count ? count : (int)b);
+    }
+};
+
+/**
+ * Pixels usados para desenhar uma imagem: os do Bmp ou os de um nível de mipmap, em que cada pixel cobre scale x scale pixels da imagem.
+ */
+struct ImagePixels {
+    const unsigned char *data;   /**< RGB, linhas de baixo para cima. NULL enquanto o Bmp não for decodificado. */
+    int width, height, stride;   /**< Dimensões e bytes por linha de data. */
+    int scale;
+    int imageWidth, imageHeight; /**< Dimensões da imagem exibida. */
+};
+
 class Image {
 
 
@@ -19,13 +101,13 @@ public:
     int frameWidth = 5;
     Bmp *bmp;
     float lightness;
-    bool transparency; /**<Se true, no exibe a cor branca.  uma definio para exibio dos cones. Por padro, todos arquivos de cone do projeto possuem fundo branco e so removidos na exibio.*/
+    bool transparency; /**<Se true, não exibe a cor branca. É uma definição para exibição dos ícones. Por padrão, todos arquivos de ícone do projeto possuem fundo branco e são removidos na exibição.*/
     bool flippedHorizontally;
     bool flippedVertically;
 
     bool rSelected, gSelected, bSelected, lSelected;
 
-    //Auxiliares de renderizao. Foram declaradas globalmente para evitar clculos processamentos desnecessrios dentro da render, melhorando performance
+    //Auxiliares de renderização. Foram declaradas globalmente para evitar cálculos processamentos desnecessários dentro da render, melhorando performance
     int column, row;
     int pixelPosition;
     float r,g,b;
@@ -35,12 +117,14 @@ public:
     int columnCounter, columnIncrementer;
     int rowPadding;
     int bytesPerRow;
+    ClipRect clipRects[IMAGE_MAX_CLIP_RECTS] = {ClipRect::unbounded()}; /**< Partes disjuntas em que a imagem pode ser desenhada (painel, janela e oclusão). */
+    int clipCount = 1;
 
     /**
-     * Construtor de cpia da classe Image.
-     * @param _image Referncia para a imagem a ser copiada.
-     * @param _x Posio x da nova imagem.
-     * @param _y Posio y da nova imagem.
+     * Construtor de cópia da classe Image.
+     * @param _image Referência para a imagem a ser copiada.
+     * @param _x Posição x da nova imagem.
+     * @param _y Posição y da nova imagem.
      */
     Image(Image *_image, int _x, int _y) {
         x = _x;
@@ -64,8 +148,8 @@ public:
     /**
      * Construtor da classe Image.
      * @param _bmp Ponteiro para o objeto Bmp contendo os dados da imagem.
-     * @param _x Posio x da imagem.
-     * @param _y Posio y da imagem.
+     * @param _x Posição x da imagem.
+     * @param _y Posição y da imagem.
      */
     Image(Bmp *_bmp, int _x, int _y) {
         x = _x;
@@ -86,16 +170,16 @@ public:
     }
 
     /**
-     * Construtor da classe Image com parmetros adicionais.
+     * Construtor da classe Image com parâmetros adicionais.
      * @param _bmp Ponteiro para o objeto Bmp contendo os dados da imagem.
-     * @param _x Posio x da imagem.
-     * @param _y Posio y da imagem.
-     * @param _rSelected Indicador de seleo do canal de cor vermelha.
-     * @param _gSelected Indicador de seleo do canal de cor verde.
-     * @param _bSelected Indicador de seleo do canal de cor azul.
-     * @param _lSelected Indicador de seleo da luminosidade.
-     * @param _flippedHorizontally Indicador de reflexo horizontal da imagem.
-     * @param _flippedVertically Indicador de reflexo vertical da imagem.
+     * @param _x Posição x da imagem.
+     * @param _y Posição y da imagem.
+     * @param _rSelected Indicador de seleção do canal de cor vermelha.
+     * @param _gSelected Indicador de seleção do canal de cor verde.
+     * @param _bSelected Indicador de seleção do canal de cor azul.
+     * @param _lSelected Indicador de seleção da luminosidade.
+     * @param _flippedHorizontally Indicador de reflexão horizontal da imagem.
+     * @param _flippedVertically Indicador de reflexão vertical da imagem.
      */
     Image(Bmp *_bmp, int _x, int _y, bool _rSelected, bool _gSelected, bool _bSelected, bool _lSelected, bool _flippedHorizontally, bool _flippedVertically) : bmp(_bmp), x(_x), y(_y),
                                             rSelected(_rSelected), gSelected(_gSelected), bSelected(_bSelected), lSelected(_lSelected), flippedHorizontally(_flippedHorizontally), flippedVertically(_flippedVertically) {
@@ -107,19 +191,131 @@ public:
     }
 
     /**
-     * Renderiza a imagem na tela.
+     * Renderiza a imagem na tela. Enquanto os pixels do Bmp não forem decodificados, exibe um retângulo no lugar da imagem.
      */
     void render() {
         if(bmp == NULL) return;
 
-        renderImage();
+        renderPixels(getPixels(0));
+    }
+
+    /**
+     * Renderiza uma prévia da imagem a partir de um nível de mipmap do Bmp, com um quarto dos pixels a cada nível.
+     * @param level Nível do mipmap; 0 é a imagem completa.
+     */
+    void renderPreview(int level) {
+        if(bmp == NULL) return;
+        renderPixels(getPixels(level));
+    }
+
+    /**
+     * Obtém os pixels atuais do Bmp, ou de um de seus níveis de mipmap.
+     * @param level Nível do mipmap. Níveis inexistentes usam a imagem completa.
+     */
+    ImagePixels getPixels(int level) {
+        ImagePixels pixels = {NULL, bmp->getWidth(), bmp->getHeight(), bytesPerRow, 1, bmp->getWidth(), bmp->getHeight()};
+        if(!bmp->isDecoded()) return pixels;
+        if(level > 0 && level < bmp->getMipCount()) {
+            pixels.data = bmp->getMipLevel(level, &pixels.width, &pixels.height, &pixels.stride);
+            pixels.scale = 1 << level;
+        } else {
+            pixels.data = bmp->getImage();
+        }
+        return pixels;
+    }
+
+    /**
+     * Renderiza a imagem a partir de pixels já lidos do Bmp, sem acessá-lo. Enquanto o Bmp não for decodificado, exibe um retângulo no lugar da imagem.
+     */
+    void renderContents(const ImagePixels &pixels) {
+        if(isClippedOut(pixels.imageWidth, pixels.imageHeight)) return;
+        if(pixels.data != NULL) {
+            renderImage(pixels);
+        } else {
+            renderPlaceholder(pixels.imageWidth, pixels.imageHeight);
+        }
         if(selected) {
-            renderImageFrame();
+            renderImageFrame(pixels.imageWidth, pixels.imageHeight);
+        }
+    }
+
+    /**
+     * Renderiza a imagem ou, se a CV estiver gravando o quadro, grava a renderização. O quadro guarda uma cópia da imagem e dos pixels lidos do Bmp,
+     * pois é desenhado em outra thread enquanto a imagem pode ser alterada ou o conteúdo do Bmp trocado por uma recarga.
+     */
+    void renderPixels(const ImagePixels &pixels);
+
+    /**
+     * Define a área em que a imagem pode ser desenhada. Os pixels fora dela não são percorridos.
+     */
+    void setClip(const ClipRect &_clip) {
+        clipRects[0] = _clip;
+        clipCount = 1;
+    }
+
+    /**
+     * Define as partes, disjuntas, em que a imagem pode ser desenhada. Sem nenhuma parte, a imagem não é desenhada.
+     * Com mais de IMAGE_MAX_CLIP_RECTS partes, a imagem é desenhada no retângulo que as envolve.
+     */
+    void setClipRects(const ClipRect *rects, int count) {
+        if(count <= IMAGE_MAX_CLIP_RECTS) {
+            for(int i=0; i<count; i++) clipRects[i] = rects[i];
+            clipCount = count;
+            return;
+        }
+        ClipRect bounds = rects[0];
+        for(int i=1; i<count; i++) {
+            if(rects[i].x1 < bounds.x1) bounds.x1 = rects[i].x1;
+            if(rects[i].y1 < bounds.y1) bounds.y1 = rects[i].y1;
+            if(rects[i].x2 > bounds.x2) bounds.x2 = rects[i].x2;
+            if(rects[i].y2 > bounds.y2) bounds.y2 = rects[i].y2;
+        }
+        setClip(bounds);
+    }
+
+    /**
+     * Verifica se a imagem, incluindo a moldura quando selecionada, está totalmente fora do recorte.
+     */
+    bool isClippedOut(int width, int height) {
+        int border = selected ? frameWidth : 0;
+        for(int i=0; i<clipCount; i++) {
+            if(!clipRects[i].excludes(x - border, y, x + width + border, y + height)) return false;
         }
+        return true;
+    }
+
+    /**
+     * Retângulo da canvas coberto pelos pixels desenhados (ou pelo retângulo exibido antes da decodificação).
+     */
+    ClipRect getPaintedRect(const ImagePixels &pixels) {
+        if(pixels.data == NULL) return ClipRect{x, y, x + pixels.imageWidth, y + pixels.imageHeight};
+        int scale = pixels.scale;
+        int firstRow = flippedVertically ? rowCounter - (scale - 1) : rowCounter;
+        int firstColumn = flippedHorizontally ? columnCounter - (scale - 1) : columnCounter;
+        int lastRow = firstRow + rowIncrementer*scale*(pixels.height - 1);
+        int lastColumn = firstColumn + columnIncrementer*scale*(pixels.width - 1);
+        return ClipRect{x + (firstColumn < lastColumn ? firstColumn : lastColumn), y + (firstRow < lastRow ? firstRow : lastRow),
+                        x + (firstColumn > lastColumn ? firstColumn : lastColumn) + scale, y + (firstRow > lastRow ? firstRow : lastRow) + scale};
+    }
+
+    /**
+     * Indica se a imagem cobre tudo o que está atrás dela no retângulo desenhado (sem a remoção do fundo branco dos ícones).
+     */
+    bool isOpaque() {
+        return !transparency;
+    }
+
+    /**
+    * Recalcula as variáveis que dependem das dimensões do Bmp. Deve ser chamada quando o conteúdo do Bmp é recarregado.
+    */
+    void refreshLayout() {
+        setupImageInversionVariables();
+        rowPadding = bmp->getRowPadding();
+        bytesPerRow = bmp->getWidth() * 3 + rowPadding;
     }
 
     /**
-    * Inicializa as variveis auxiliares utilizadas para realizar a inverso da imagem nos eixos horizontal e vertical.
+    * Inicializa as variáveis auxiliares utilizadas para realizar a inversão da imagem nos eixos horizontal e vertical.
     */
     void setupImageInversionVariables() {
         if(flippedHorizontally) {
@@ -140,56 +336,97 @@ public:
     }
 
     /**
-    * Renderiza a imagem.
+    * Ativa o envio dos pixels agrupados por cor (DrawList). Os pixels não se sobrepõem, então a ordem não altera o resultado;
+    * o agrupamento reduz as trocas de cor ao custo de ordenar os pixels a cada quadro.
     */
-    void renderImage() {
-        float* data = bmp->getProcessedData();
-        row = rowCounter;
-        for (int i = 0; i < bmp->getHeight(); i++) {
-            column = columnCounter;
-            int rowOffset = i * bytesPerRow;
-           for (int j = 0 ; j < bmp->getWidth(); j++) {
+    static void setSortedDrawing(bool enable) {
+        sortedDrawing() = enable;
+    }
+
+    /**
+    * Renderiza a imagem, parte a parte do recorte.
+    */
+    void renderImage(const ImagePixels &pixels) {
+        DrawList *list = sortedDrawing() ? &getDrawList() : NULL;
+        for(int i=0; i<clipCount; i++) renderImagePart(pixels, clipRects[i], list);
+        if(list != NULL) list->submit();
+    }
+
+    /**
+    * Renderiza os pixels da imagem que intersectam uma parte do recorte.
+    */
+    void renderImagePart(const ImagePixels &pixels, const ClipRect &clip, DrawList *list) {
+        const unsigned char* data = pixels.data;
+        int scale = pixels.scale;
+        const float* normalized = Bmp::getNormalizationTable();
+        //com a imagem invertida, o bloco de cada pixel da prévia termina onde terminaria o último pixel que ele cobre
+        int firstRow = flippedVertically ? rowCounter - (scale - 1) : rowCounter;
+        int firstColumn = flippedHorizontally ? columnCounter - (scale - 1) : columnCounter;
+        //apenas as linhas e colunas que intersectam o recorte são percorridas
+        int rowBegin, rowEnd, columnBegin, columnEnd;
+        ClipRect::clipRange(y + firstRow, rowIncrementer*scale, scale, pixels.height, clip.y1, clip.y2, &rowBegin, &rowEnd);
+        ClipRect::clipRange(x + firstColumn, columnIncrementer*scale, scale, pixels.width, clip.x1, clip.x2, &columnBegin, &columnEnd);
+        row = firstRow + rowIncrementer*scale*rowBegin;
+        for (int i = rowBegin; i < rowEnd; i++) {
+            column = firstColumn + columnIncrementer*scale*columnBegin;
+            int rowOffset = i * pixels.stride;
+           for (int j = columnBegin ; j < columnEnd; j++) {
                 pixelPosition = rowOffset + j * 3;
-                r = data[pixelPosition];
-                g = data[pixelPosition + 1];
-                b = data[pixelPosition + 2];
+                r = normalized[data[pixelPosition]];
+                g = normalized[data[pixelPosition + 1]];
+                b = normalized[data[pixelPosition + 2]];
 
                 if(transparency && isWhiteRgb(r,g,b)) {
-                    column += columnIncrementer;
+                    column += columnIncrementer*scale;
                     continue;
                 }
 
                if (lSelected) {
                    luminance = getLuminance(r,g,b)-lightness;
-                   CV::color(luminance, luminance, luminance);
+                   rFactor = gFactor = bFactor = luminance;
                } else {
                     rFactor = rSelected ? r-lightness : 0;
                     gFactor = gSelected ? g-lightness : 0;
                     bFactor = bSelected ? b-lightness : 0;
-                    CV::color(rFactor, gFactor, bFactor);
                }
 
-               CV::rectFill(x+column, y+row, x+column+1, y+row+1);
-               column += columnIncrementer;
+               if(list != NULL) {
+                   list->color(rFactor, gFactor, bFactor);
+                   list->rectFill(x+column, y+row, x+column+scale, y+row+scale);
+               } else {
+                   CV::color(rFactor, gFactor, bFactor);
+                   CV::rectFill(x+column, y+row, x+column+scale, y+row+scale);
+               }
+               column += columnIncrementer*scale;
            }
-           row += rowIncrementer;
+           row += rowIncrementer*scale;
        }
     }
 
     /**
-     * Verifica se a cor RGB  branca (ou prxima de branca).
+     * Renderiza o retângulo exibido no lugar de uma imagem ainda não decodificada.
+     */
+    void renderPlaceholder(int width, int height) {
+        CV::color(0.85, 0.85, 0.85);
+        CV::rectFill(x, y, x + width, y + height);
+        CV::color(0.6, 0.6, 0.6);
+        CV::rect(x, y, x + width, y + height);
+    }
+
+    /**
+     * Verifica se a cor RGB é branca (ou próxima de branca).
      * @param r Valor do canal vermelho (0 a 1).
      * @param g Valor do canal verde (0 a 1).
      * @param b Valor do canal azul (0 a 1).
-     * @return true se a cor  branca, false caso contrrio.
+     * @return true se a cor é branca, false caso contrário.
      */
     bool isWhiteRgb(float r, float g, float b) {
         return r > 0.70 && b > 0.70 && b > 0.70;
     }
 
     /**
-     * Define a transparncia da imagem.
-     * @param enable true para ativar a transparncia, false para desativar.
+     * Define a transparência da imagem.
+     * @param enable true para ativar a transparência, false para desativar.
      */
     void setTransparency(bool enable) {
         transparency = enable;
@@ -204,7 +441,7 @@ public:
     }
 
     /**
-     * Obtm o valor da luminosidade atual.
+     * Obtém o valor da luminosidade atual.
      * @return O valor da luminosidade atual.
      */
     float getLightness() {
@@ -212,51 +449,84 @@ public:
     }
 
     /**
-     * Obtm a luminncia normalizada de uma cor RGB.
+     * Indica se os pixels são enviados agrupados por cor (ver setSortedDrawing).
+     */
+    static bool& sortedDrawing() {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    /**
+     * Lista compartilhada pelas imagens, reaproveitando a memória entre os quadros.
+     */
+    static DrawList& getDrawList() {
+        static DrawList list;
+        return list;
+    }
+
+    /**
+     * Obtém a luminância normalizada de uma cor RGB.
      * @param r Valor do canal vermelho (0 a 255).
      * @param g Valor do canal verde (0 a 255).
      * @param b Valor do canal azul (0 a 255).
-     * @return O valor da luminncia normalizada (0 a 1).
+     * @return O valor da luminância normalizada (0 a 1).
      */
     static float getNormalizedLuminance(unsigned char r, unsigned char g, unsigned char b) {
         return (r/ 255.0)*0.229 + (g/ 255.0)*0.587 + (b/ 255.0*0.114);
     }
 
     /**
-     * Obtm a luminncia de uma cor RGB.
+     * Obtém a luminância de uma cor RGB.
      * @param r Valor do canal vermelho (0 a 1).
      * @param g Valor do canal verde (0 a 1).
      * @param b Valor do canal azul (0 a 1).
-     * @return O valor da luminncia.
+     * @return O valor da luminância.
      */
     static float getLuminance(float r, float g, float b) {
-        return r*0.229 + g*0.587 + b*0.114;
+        return ImageEffects::getLuminance(r, g, b);
+    }
+
+    /**
+     * Obtém os efeitos de visualização atuais da imagem, para aplicá-los fora da canvas (exportação).
+     * @return Cópia dos efeitos.
+     */
+    ImageEffects getEffects() {
+        ImageEffects effects;
+        effects.rSelected = rSelected;
+        effects.gSelected = gSelected;
+        effects.bSelected = bSelected;
+        effects.lSelected = lSelected;
+        effects.lightness = lightness;
+        effects.flippedHorizontally = flippedHorizontally;
+        effects.flippedVertically = flippedVertically;
+        effects.prepare();
+        return effects;
     }
 
     /**
      * Renderiza a moldura da imagem quando selecionada.
      */
-    void renderImageFrame() {
+    void renderImageFrame(int width, int height) {
         CV::color(0,0,0);
         for(int i=0; i<frameWidth; i++) {
-            CV::rect(x-i,y+i,x+bmp->getWidth()+i, y+bmp->getHeight()-i);
+            CV::rect(x-i,y+i,x+width+i, y+height-i);
         }
     }
 
     /**
-     * Verifica se o ponto (mx, my) est dentro da rea ocupada pela imagem.
-     * @param mx Posio x do ponto.
-     * @param my Posio y do ponto.
-     * @return true se o ponto est dentro da rea da imagem, false caso contrrio.
+     * Verifica se o ponto (mx, my) está dentro da área ocupada pela imagem.
+     * @param mx Posição x do ponto.
+     * @param my Posição y do ponto.
+     * @return true se o ponto está dentro da área da imagem, false caso contrário.
      */
     bool checkCollision(int mx, int my) {
       return mx >= x && mx <= (x + bmp->getWidth()) && my >= y && my <= (y + bmp->getHeight());
     }
 
      /**
-     * Define a posio da imagem.
-     * @param _x Nova posio x da imagem.
-     * @param _y Nova posio y da imagem.
+     * Define a posição da imagem.
+     * @param _x Nova posição x da imagem.
+     * @param _y Nova posição y da imagem.
      */
     void setPosition(int _x, int _y) {
         x = _x;
@@ -264,22 +534,22 @@ public:
     }
 
     /**
-     * Define se a imagem est selecionada ou no.
-     * @param _selected Indicador de seleo da imagem.
+     * Define se a imagem está selecionada ou não.
+     * @param _selected Indicador de seleção da imagem.
      */
     void setSelected(bool _selected) {
         selected = _selected;
     }
 
     /**
-     * Alterna o estado de seleo da imagem.
+     * Alterna o estado de seleção da imagem.
      */
     void toggleSelected() {
         selected = !selected;
     }
 
     /**
-     * Obtm o objeto Bmp associado  imagem.
+     * Obtém o objeto Bmp associado à imagem.
      * @return Ponteiro para o objeto Bmp.
      */
     Bmp* getBmp() {
@@ -287,15 +557,15 @@ public:
     }
 
     /**
-     * Verifica se a imagem est selecionada.
-     * @return true se a imagem est selecionada, false caso contrrio.
+     * Verifica se a imagem está selecionada.
+     * @return true se a imagem está selecionada, false caso contrário.
      */
     bool isSelected() {
         return selected;
     }
 
     /**
-     * Obtm a largura da imagem.
+     * Obtém a largura da imagem.
      * @return A largura da imagem.
      */
     int getWidth() {
@@ -303,7 +573,7 @@ public:
     }
 
     /**
-     * Obtm a altura da imagem.
+     * Obtém a altura da imagem.
      * @return A altura da imagem.
      */
     int getHeight() {
@@ -327,5 +597,29 @@ public:
     }
 };
 
+/**
+ * Renderização de uma imagem gravada no quadro da CV, executada pela thread de renderização.
+ */
+class ImageRenderCommand : public CVCommand {
+    Image image;
+    ImagePixels pixels;
+
+public:
+    ImageRenderCommand(const Image &_image, const ImagePixels &_pixels) : image(_image), pixels(_pixels) {}
+
+    void execute() {
+        image.renderContents(pixels);
+    }
+};
+
+inline void Image::renderPixels(const ImagePixels &pixels) {
+    if(isClippedOut(pixels.imageWidth, pixels.imageHeight)) return; //nem grava a cópia da imagem
+    if(CV::isRecording()) {
+        CV::record(new ImageRenderCommand(*this, pixels));
+        return;
+    }
+    renderContents(pixels);
+}
+
 
 #endif // IMAGE_H_INCLUDED
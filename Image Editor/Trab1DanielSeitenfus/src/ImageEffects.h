@@ -0,0 +1,94 @@
+/**
+ * @file ImageEffects.h
+ * @brief Definição da estrutura ImageEffects, com os efeitos de visualização de uma imagem.
+ *
+ * Este arquivo contém a definição da estrutura ImageEffects, que guarda os efeitos aplicados a uma imagem (canais de cor, escala de cinza, brilho e inversões)
+ * e os aplica linha a linha sobre os pixels do Bmp, sem depender da canvas. O resultado é o mesmo exibido por Image::renderImage, e é usado para exportar a imagem editada.
+ */
+
+#ifndef IMAGEEFFECTS_H_INCLUDED
+#define IMAGEEFFECTS_H_INCLUDED
+
+/**
+ * Estrutura com os efeitos de visualização de uma imagem.
+ */
+struct ImageEffects {
+    bool rSelected, gSelected, bSelected, lSelected;
+    float lightness; /**< Valor subtraído de cada canal normalizado (-1 a 1). */
+    bool flippedHorizontally, flippedVertically;
+
+    ImageEffects() : rSelected(true), gSelected(true), bSelected(true), lSelected(false), lightness(0), flippedHorizontally(false), flippedVertically(false) {
+        prepare();
+    }
+
+    /**
+     * Obtém a luminância de uma cor RGB.
+     * @param r Valor do canal vermelho.
+     * @param g Valor do canal verde.
+     * @param b Valor do canal azul.
+     * @return O valor da luminância, na mesma escala dos canais.
+     */
+    static float getLuminance(float r, float g, float b) {
+        return r*0.229 + g*0.587 + b*0.114;
+    }
+
+    /**
+     * Recalcula a tabela de brilho. Deve ser chamada sempre que lightness for alterado.
+     */
+    void prepare() {
+        for(int v=0; v<256; v++) {
+            lightnessTable[v] = clampToByte(v - lightness*255);
+        }
+    }
+
+    /**
+     * Obtém a linha de origem que corresponde a uma linha de destino, considerando a inversão vertical.
+     * @param row Linha de destino.
+     * @param height Altura da imagem.
+     * @return Linha de origem.
+     */
+    int getSourceRow(int row, int height) const {
+        return flippedVertically ? height - 1 - row : row;
+    }
+
+    /**
+     * Aplica os efeitos a uma linha da imagem.
+     * @param data Pixels RGB do Bmp (linhas de baixo para cima).
+     * @param width Largura da imagem.
+     * @param height Altura da imagem.
+     * @param stride Bytes por linha em data (incluindo o preenchimento).
+     * @param row Linha de destino, de baixo para cima.
+     * @param out Linha de saída, com width pixels em BGR (ordem do arquivo BMP).
+     */
+    void applyRow(const unsigned char *data, int width, int height, int stride, int row, unsigned char *out) const {
+        const unsigned char *source = data + getSourceRow(row, height)*stride;
+        int column = flippedHorizontally ? (width - 1)*3 : 0;
+        int columnIncrementer = flippedHorizontally ? -3 : 3;
+
+        for(int x=0; x<width; x++, out+=3, column+=columnIncrementer) {
+            unsigned char r = source[column], g = source[column + 1], b = source[column + 2];
+            if(lSelected) {
+                unsigned char luminance = clampToByte(getLuminance(r, g, b) - lightness*255);
+                out[0] = out[1] = out[2] = luminance;
+            } else {
+                out[0] = bSelected ? lightnessTable[b] : 0;
+                out[1] = gSelected ? lightnessTable[g] : 0;
+                out[2] = rSelected ? lightnessTable[r] : 0;
+            }
+        }
+    }
+
+private:
+    unsigned char lightnessTable[256]; /**< Valor de cada canal após a aplicação do brilho. */
+
+    /**
+     * Arredonda e limita um valor ao intervalo 0-255, como a canvas faz com as cores fora do intervalo.
+     */
+    static unsigned char clampToByte(float value) {
+        if(value <= 0) return 0;
+        if(value >= 255) return 255;
+        return (unsigned char)(value + 0.5);
+    }
+};
+
+#endif // IMAGEEFFECTS_H_INCLUDED
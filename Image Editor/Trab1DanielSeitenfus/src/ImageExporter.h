@@ -0,0 +1,115 @@
+/**
+ * @file ImageExporter.h
+ * @brief Definição da classe ImageExporter, que exporta a imagem editada para um arquivo BMP.
+ *
+ * A exportação roda em uma thread separada: cada linha é gerada com os efeitos da imagem (ImageEffects) diretamente no buffer de linha do BmpWriter e gravada em seguida.
+ * A imagem editada nunca é montada por inteiro na memória, e o progresso pode ser consultado a cada quadro.
+ */
+
+#ifndef IMAGEEXPORTER_H_INCLUDED
+#define IMAGEEXPORTER_H_INCLUDED
+
+#include <thread>
+#include <atomic>
+#include <string>
+#include "Image.h"
+#include "BmpWriter.h"
+
+enum ExportState {
+    EXPORT_IDLE,
+    EXPORT_RUNNING,
+    EXPORT_DONE,
+    EXPORT_FAILED
+};
+
+class ImageExporter {
+    std::thread worker;
+    std::atomic<int> state;
+    std::atomic<int> rowsDone;
+    std::atomic<bool> cancelled;
+    int totalRows;
+    std::string fileName;
+
+    /**
+     * Corpo da thread de exportação. Usa apenas a cópia dos efeitos e as dimensões e o ponteiro dos pixels lidos em start: o Bmp pode ter
+     * o conteúdo trocado por uma recarga durante a exportação, e os pixels antigos continuam válidos enquanto a exportação os lê.
+     */
+    void run(ImagePixels pixels, ImageEffects effects) {
+        BmpWriter writer;
+        int width = pixels.width;
+        int height = pixels.height;
+        int stride = pixels.stride;
+        const unsigned char *data = pixels.data;
+
+        bool ok = writer.open(fileName.c_str(), width, height);
+        for(int row=0; ok && row<height; row++) {
+            if(cancelled) {
+                ok = false;
+                break;
+            }
+            effects.applyRow(data, width, height, stride, row, writer.getRowBuffer());
+            ok = writer.writeRow();
+            rowsDone = row + 1;
+        }
+        ok = writer.close() && ok;
+
+        if(!ok) remove(fileName.c_str()); //não deixa um arquivo incompleto
+        state = ok ? EXPORT_DONE : EXPORT_FAILED;
+    }
+
+public:
+    ImageExporter() : state(EXPORT_IDLE), rowsDone(0), cancelled(false), totalRows(0) {}
+
+    ~ImageExporter() {
+        cancel();
+    }
+
+    /**
+     * Inicia a exportação da imagem com os efeitos atuais. Os efeitos são copiados no início, então alterações posteriores não afetam o arquivo.
+     * @param image Imagem a ser exportada.
+     * @param _fileName Nome do arquivo BMP de saída.
+     * @return false se já houver uma exportação em andamento ou a imagem for inválida.
+     */
+    bool start(Image *image, const char *_fileName) {
+        if(isRunning() || image == nullptr || image->getBmp() == nullptr || image->getBmp()->getImage() == NULL) return false;
+        if(worker.joinable()) worker.join();
+
+        fileName = _fileName;
+        totalRows = image->getHeight();
+        rowsDone = 0;
+        cancelled = false;
+        state = EXPORT_RUNNING;
+        worker = std::thread(&ImageExporter::run, this, image->getPixels(0), image->getEffects());
+        return true;
+    }
+
+    /**
+     * Interrompe a exportação em andamento e aguarda o término da thread.
+     */
+    void cancel() {
+        cancelled = true;
+        if(worker.joinable()) worker.join();
+    }
+
+    bool isRunning() {
+        return state == EXPORT_RUNNING;
+    }
+
+    int getState() {
+        return state;
+    }
+
+    /**
+     * Obtém o progresso da exportação.
+     * @return Fração das linhas já gravadas (0 a 1).
+     */
+    float getProgress() {
+        return totalRows > 0 ? (float)rowsDone/totalRows : 0;
+    }
+
+    const char* getFileName() {
+        return fileName.c_str();
+    }
+};
+
+#endif // IMAGEEXPORTER_H_INCLUDED
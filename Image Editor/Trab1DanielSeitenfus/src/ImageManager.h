@@ -1,8 +1,8 @@
 /**
  * @file ImageManager.h
- * @brief Definio da classe ImageManager para gerenciamento de imagens.
+ * @brief Definição da classe ImageManager para gerenciamento de imagens.
  *
- * Este arquivo contm a definio da classe ImageManager, responsvel por gerenciar uma coleo de imagens e as interaes com elas, como adio, seleo, manipulao, dragging, drop, e renderizao.
+ * Este arquivo contém a definição da classe ImageManager, responsável por gerenciar uma coleção de imagens e as interações com elas, como adição, seleção, manipulação, dragging, drop, e renderização.
  */
 
 #ifndef IMAGEMANAGER_H_INCLUDED
@@ -11,9 +11,21 @@
 #include <vector>
 #include "Panel.h"
 #include "Image.h"
+#include "FrameGovernor.h"
+#include "DragBackground.h"
 #define NO_IMAGE_SELECTED -1
 using namespace std;
 
+/**
+ * Áreas, em pixels da canvas, acumuladas pelo teste de oclusão ao longo dos quadros.
+ */
+struct OcclusionStats {
+    long long frames;
+    long long imageArea;   /**< Soma das áreas das imagens dentro do recorte: o que seria desenhado sem o teste de oclusão. */
+    long long drawnArea;   /**< Soma das áreas efetivamente desenhadas. */
+    long long visibleArea; /**< Área da união das imagens: cada pixel visível contado uma vez. */
+};
+
 /**
  * Classe para gerenciamento de um conjunto de imagens.
  */
@@ -22,24 +34,96 @@ class ImageManager {
     vector<Image*> images;
     int selectedImageIndex = NO_IMAGE_SELECTED;
     bool draggingImage = false;
-    Panel panel;
+    Panel &panel;
+
+    //cobertura das imagens já percorridas (da frente para trás) e partes visíveis da imagem atual, reaproveitadas entre os quadros
+    vector<ClipRect> coverage, parts, remaining;
+    OcclusionStats occlusionStats = OcclusionStats();
+    DragBackground dragBackground;
+    unsigned int imagesVersion = 0; /**< Alterada quando o conteúdo de alguma imagem muda, invalidando o fundo do arraste. */
+
+    /**
+     * Nível de mipmap efetivamente usado por uma imagem: o pedido, limitado aos níveis do Bmp; 0 antes da decodificação.
+     */
+    static int getImageLevel(Bmp *bmp, int level) {
+        if(level <= 0 || !bmp->isDecoded()) return 0;
+        return level < bmp->getMipCount() ? level : bmp->getMipCount() - 1;
+    }
+
+    /**
+     * Decodifica a primeira imagem visível ainda não decodificada.
+     */
+    void decodeNextVisibleImage() {
+        for(int i=0; i<images.size(); i++) {
+            Bmp *bmp = images[i]->getBmp();
+            if(!bmp->isDecoded() && bmp->isValid() && isImageVisible(i)) {
+                bmp->decode();
+                imagesVersion++;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Teste de oclusão: percorre as imagens da frente para trás, mantendo a união (em retângulos disjuntos) das áreas já cobertas
+     * por imagens opacas, e define como recorte de cada imagem as partes dela ainda não cobertas.
+     * @param count Número de imagens consideradas, a partir da primeira (a mais ao fundo).
+     * @param apply Se false, apenas calcula as estatísticas e desenha as imagens inteiras (para comparação).
+     */
+    void cullOccludedImages(int level, const ClipRect &clip, int count, bool apply) {
+        coverage.clear();
+        occlusionStats.frames++;
+        for(int i=count-1; i>=0; i--) {
+            Image *image = images[i];
+            ClipRect painted = image->getPaintedRect(image->getPixels(getImageLevel(image->getBmp(), level))).intersect(clip);
+            long long area = painted.getArea();
+            occlusionStats.imageArea += area;
+
+            parts.clear();
+            if(area > 0) parts.push_back(painted);
+            for(size_t c=0; c<coverage.size() && !parts.empty(); c++) {
+                remaining.clear();
+                for(size_t p=0; p<parts.size(); p++) ClipRect::subtract(parts[p], coverage[c], remaining);
+                parts.swap(remaining);
+            }
+
+            long long visible = 0;
+            for(size_t p=0; p<parts.size(); p++) visible += parts[p].getArea();
+            occlusionStats.visibleArea += visible;
+
+            if(apply) {
+                image->setClipRects(parts.empty() ? NULL : &parts[0], parts.size());
+                occlusionStats.drawnArea += parts.size() <= IMAGE_MAX_CLIP_RECTS ? visible : image->clipRects[0].getArea();
+            } else {
+                image->setClip(clip);
+                occlusionStats.drawnArea += area;
+            }
+            if(image->isOpaque()) coverage.insert(coverage.end(), parts.begin(), parts.end());
+        }
+    }
+
+    static bool& occlusionCulling() {
+        static bool enabled = true;
+        return enabled;
+    }
 
 public:
 
     /**
      * Construtor da classe ImageManager.
-     * @param _panel Painel para realizao de clculos referentes ao posicionamento das imagens.
+     * @param _panel Painel para realização de cálculos referentes ao posicionamento das imagens. Deve existir enquanto o gerenciador existir.
      */
-    ImageManager(Panel _panel) : panel(_panel) {
+    ImageManager(Panel &_panel) : panel(_panel) {
         images = {};
     }
 
     /**
-     * Destrutor da classe ImageManager.
+     * Destrutor da classe ImageManager. O gerenciador é dono das imagens e dos respectivos Bmp.
      */
     ~ImageManager() {
         for(int i=0; i<images.size(); i++) {
-            free(images[i]);
+            delete images[i]->getBmp();
+            delete images[i];
         }
     }
 
@@ -49,35 +133,85 @@ public:
      */
     void addImage(Image *image) {
         images.push_back(image);
+        imagesVersion++;
     }
 
     /**
-     * Inicializa a seleo de imagem, selecionando a ltima imagem adicionada.
+     * Inicializa a seleção de imagem, selecionando a última imagem adicionada.
      */
     void initializeImageSelection() {
         selectImage(getLastIndex());
     }
 
     /**
-     * Renderiza todas as imagens.
+     * Renderiza todas as imagens, de trás para frente. Cada imagem desenha apenas as partes não cobertas pelas imagens opacas à frente dela.
+     * As imagens são decodificadas apenas quando ficam visíveis, no máximo uma por frame para não travar a interface; as demais exibem um retângulo até lá.
+     * @param level Nível de mipmap usado para desenhar as imagens (reduzido pelo governador de quadros); 0 desenha as imagens completas.
+     * @param clip Área visível das imagens. Imagens totalmente fora dela são ignoradas e das demais são percorridos apenas os pixels dentro dela.
      */
-    void render() {
-        for(int i=0; i<images.size(); i++) {
-            images[i]->render();
+    void render(int level, const ClipRect &clip) {
+        frameGovernor.enter(SUBSYSTEM_IMAGES);
+        decodeNextVisibleImage(); //antes do teste de oclusão, que depende da área desenhada por cada imagem
+
+        //durante o arraste, a imagem selecionada é a última e as demais formam o fundo, copiado no primeiro quadro
+        bool dragging = draggingImage && hasImageSelected() && images.size() > 1;
+        int background = dragging ? images.size() - 1 : images.size();
+        if(!dragging) {
+            dragBackground.invalidate();
+        } else if(dragBackground.isCached(images.back(), level, clip, imagesVersion)) {
+            dragBackground.draw();
+            background = 0;
         }
+
+        if(background > 0) cullOccludedImages(level, clip, background, occlusionCulling());
+        for(int i=0; i<background; i++) {
+            images[i]->renderPreview(getImageLevel(images[i]->getBmp(), level));
+        }
+
+        if(dragging) {
+            if(background > 0) dragBackground.capture(images.back(), level, clip, imagesVersion);
+            images.back()->setClip(clip);
+            images.back()->renderPreview(getImageLevel(images.back()->getBmp(), level));
+        }
+        frameGovernor.leave();
+    }
+
+    /**
+     * Ativa ou desativa o teste de oclusão (para comparação; as estatísticas continuam sendo calculadas).
+     */
+    static void setOcclusionCulling(bool enable) {
+        occlusionCulling() = enable;
     }
 
     /**
-     * Verifica se h alguma imagem selecionada.
-     * @return True se h uma imagem selecionada, False caso contrrio.
+     * Imprime quantas vezes o fundo do arraste foi copiado e reaproveitado.
+     */
+    void printDragStats() {
+        dragBackground.printStats();
+    }
+
+    /**
+     * Imprime a razão de sobreposição (área desenhada sobre a área visível) sem e com o teste de oclusão.
+     */
+    void printOcclusionStats() {
+        if(occlusionStats.visibleArea == 0) return;
+        double visible = (double)occlusionStats.visibleArea;
+        printf("\nOclusao das imagens: %s, sobreposicao de %.2fx sem o teste e %.2fx desenhada (%.0f pixels visiveis por quadro)\n",
+               occlusionCulling() ? "ativada" : "desativada", occlusionStats.imageArea/visible, occlusionStats.drawnArea/visible,
+               visible/occlusionStats.frames);
+    }
+
+    /**
+     * Verifica se há alguma imagem selecionada.
+     * @return True se há uma imagem selecionada, False caso contrário.
      */
     bool hasImageSelected() {
         return selectedImageIndex >= 0;
     }
 
     /**
-     * @brief Trata os eventos do mouse. Se clicado, verifica se h coliso com as imagens e realiza os tratamentos necessrios.
-     * Se o clique for solto, desabilita o dragging da imagem. Em todos os casos, a funo de atualizao da posio da imagem  chamada.
+     * @brief Trata os eventos do mouse. Se clicado, verifica se há colisão com as imagens e realiza os tratamentos necessários.
+     * Se o clique for solto, desabilita o dragging da imagem. Em todos os casos, a função de atualização da posição da imagem é chamada.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
      * @param state Estado de clique do mouse.
@@ -93,8 +227,8 @@ public:
     }
 
     /**
-     * Seleciona uma imagem com base no ndice fornecido. Chama a funo que renderiza uma moldura na imagem.
-     * @param index ndice da imagem a ser selecionada.
+     * Seleciona uma imagem com base no índice fornecido. Chama a função que renderiza uma moldura na imagem.
+     * @param index Índice da imagem a ser selecionada.
      */
     void selectImage(int index) {
         setRenderPriority(index);
@@ -103,7 +237,7 @@ public:
     }
 
     /**
-     * Obtm a imagem selecionada.
+     * Obtém a imagem selecionada.
      * @return Ponteiro para a imagem selecionada.
      */
      Image* getSelectedImage() {
@@ -132,16 +266,27 @@ public:
     }
 
     /**
-     * Verifica se o gerenciador est vazio (sem imagens adicionadas).
-     * @return True se no h imagens no gerenciador, False caso contrrio.
+     * Atualiza as imagens que exibem um Bmp recarregado. Posição, efeitos e ordem de renderização são mantidos.
+     * @param bmp Bmp cujo conteúdo foi trocado.
+     */
+    void refreshImagesOf(Bmp *bmp) {
+        imagesVersion++;
+        for(int i=0; i<images.size(); i++) {
+            if(images[i]->getBmp() == bmp) images[i]->refreshLayout();
+        }
+    }
+
+    /**
+     * Verifica se o gerenciador está vazio (sem imagens adicionadas).
+     * @return True se não há imagens no gerenciador, False caso contrário.
      */
     bool isEmpty() {
         return images.empty();
     }
 
     /**
-     * Obtm a ltima imagem adicionada.
-     * @return Ponteiro para a ltima imagem adicionada.
+     * Obtém a última imagem adicionada.
+     * @return Ponteiro para a última imagem adicionada.
      */
     Image* getLastImage() {
         return images[getLastIndex()];
@@ -150,7 +295,7 @@ public:
 private:
 
     /**
-     *  Verifica colises com as imagens e processa seleo. A checagem ocorre percorrendo da ltima imagem at a primeira, pois a ltima possui prioridade de renderizao na tela (aparecer na frente das outras).
+     *  Verifica colisões com as imagens e processa seleção. A checagem ocorre percorrendo da última imagem até a primeira, pois a última possui prioridade de renderização na tela (aparecerá na frente das outras).
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
      */
@@ -167,18 +312,18 @@ private:
                     }
 
                     selectImage(i);
-                    return; //Para a execuo para evitar o processamento desncessrio para outras imagens
+                    return; //Para a execução para evitar o processamento desncessário para outras imagens
                 }
             }
     }
 
     /**
-     * Atualiza a posio da imagem de acordo com a coordenada do mouse.
-     So realizados alguns clculos para garantir que a imagem se mantenha dentro do painel.
-        - Verificao se a imagem est dentro do painel nos dois eixos. Caso sim, atualiza x e y
-        - Caso no, algum eixo estar fora do paniel. Para garantir fluidez no movimento, a funo atualiza apenas um dos eixos que ainda est dentro do painel.
-            Para o outro eixo,  realizado o clculo do tamanho mximo do painel - o tamanho da imagem (altura ou largura). Isso evita que a imagem fique travada caso o mouse se mova muito rpido e o clculo retorna que a imagem est fora.
-            Porm, a ltima atualizao da imagem foi enquanto ainda sobrava espao entre a imagem e o painel. Ou seja, caso isso acontea, a funo fora a atualizao, renderizando a imagem nas bordas do painel.
+     * Atualiza a posição da imagem de acordo com a coordenada do mouse.
+     São realizados alguns cálculos para garantir que a imagem se mantenha dentro do painel.
+        - Verificação se a imagem está dentro do painel nos dois eixos. Caso sim, atualiza x e y
+        - Caso não, algum eixo estará fora do paniel. Para garantir fluidez no movimento, a função atualiza apenas um dos eixos que ainda está dentro do painel.
+            Para o outro eixo, é realizado o cálculo do tamanho máximo do painel - o tamanho da imagem (altura ou largura). Isso evita que a imagem fique travada caso o mouse se mova muito rápido e o cálculo retorna que a imagem está fora.
+            Porém, a última atualização da imagem foi enquanto ainda sobrava espaço entre a imagem e o painel. Ou seja, caso isso aconteça, a função força a atualização, renderizando a imagem nas bordas do painel.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
      */
@@ -211,30 +356,30 @@ private:
     }
 
     /**
-     * Verifica se a imagem est dentro do painel no eixo x.
+     * Verifica se a imagem está dentro do painel no eixo x.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
-     * @return True se a imagem est dentro do painel no eixo x, False caso contrrio.
+     * @return True se a imagem está dentro do painel no eixo x, False caso contrário.
      */
     bool isImageXInsidePanel(int mx, int my) {
         return mx >= panel.x1 && (mx + images[selectedImageIndex]->getWidth()) <= panel.x2;
     }
 
     /**
-     * Verifica se a imagem est dentro do painel no eixo y.
+     * Verifica se a imagem está dentro do painel no eixo y.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
-     * @return True se a imagem est dentro do painel no eixo y, False caso contrrio.
+     * @return True se a imagem está dentro do painel no eixo y, False caso contrário.
      */
     bool isImageYInsidePanel(int mx, int my) {
         return my >= panel.y1 && (my + images[selectedImageIndex]->getHeight()) <= panel.y2;
     }
 
     /**
-     * Verifica se a imagem est dentro do painel.
+     * Verifica se a imagem está dentro do painel.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
-     * @return True se a imagem est dentro do painel, False caso contrrio.
+     * @return True se a imagem está dentro do painel, False caso contrário.
      */
     bool isImageInsidePanel(int mx, int my) {
         Image *image = images[selectedImageIndex];
@@ -242,19 +387,40 @@ private:
     }
 
     /**
-     * Obtm o ndice da ltima imagem no vetor.
-     * @return ndice da ltima imagem no vetor.
+     * Verifica se alguma parte da imagem aparece na tela: ela precisa estar ao menos parcialmente dentro do painel e não estar totalmente coberta por uma das imagens renderizadas depois dela.
+     * @param index Índice da imagem.
+     * @return True se a imagem está visível.
+     */
+    bool isImageVisible(int index) {
+        Image *image = images[index];
+        int x2 = image->x + image->getWidth();
+        int y2 = image->y + image->getHeight();
+        if(x2 < panel.x1 || image->x > panel.x2 || y2 < panel.y1 || image->y > panel.y2) return false;
+
+        for(int i=index+1; i<images.size(); i++) {
+            Image *above = images[i];
+            if(above->x <= image->x && above->y <= image->y &&
+               above->x + above->getWidth() >= x2 && above->y + above->getHeight() >= y2) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Obtém o índice da última imagem no vetor.
+     * @return Índice da última imagem no vetor.
      */
     int getLastIndex() {
         return images.size()-1;
     }
 
     /**
-     * Define a prioridade de renderizao da imagem selecionada para que seja renderizada por cima das outras.
-     * @param index ndice da imagem a ser movida para a ltima posio no vetor.
+     * Define a prioridade de renderização da imagem selecionada para que seja renderizada por cima das outras.
+     * @param index Índice da imagem a ser movida para a última posição no vetor.
      */
     void setRenderPriority(int index) {
-        if(index == getLastIndex()) return; //Se a imagem for a ltima do vetor, nada precisa ser feito.
+        if(index == getLastIndex()) return; //Se a imagem for a última do vetor, nada precisa ser feito.
         Image *image = images[index];
         images.erase(images.begin() + index);
         images.push_back(image);
@@ -1,10 +1,10 @@
 /**
  * @file ImagePanel.h
- * @brief Definio da classe ImagePanel para representar um painel de exibio de imagens.
+ * @brief Definição da classe ImagePanel para representar um painel de exibição de imagens.
  *
- * Este arquivo contm a definio da classe ImagePanel, que  responsvel por criar e gerenciar o painel de exibio de imagens.
- * O painel pode exibir vrias imagens carregadas a partir de arquivos BMP e fornece funcionalidades para interagir com essas imagens, como virar horizontalmente ou verticalmente, alm de permitir a seleo e manipulao das mesmas.
- * O painel tambm faz o controle de posicionamento das imagens, impedindo que elas sejam arrastadas para fora da dimenso do painel.
+ * Este arquivo contém a definição da classe ImagePanel, que é responsável por criar e gerenciar o painel de exibição de imagens.
+ * O painel pode exibir várias imagens carregadas a partir de arquivos BMP e fornece funcionalidades para interagir com essas imagens, como virar horizontalmente ou verticalmente, além de permitir a seleção e manipulação das mesmas.
+ * O painel também faz o controle de posicionamento das imagens, impedindo que elas sejam arrastadas para fora da dimensão do painel.
  */
 
 #ifndef IMAGEPANEL_H_INCLUDED
@@ -16,16 +16,22 @@
 #include "Image.h"
 #include "Math.h"
 #include "ButtonManager.h"
+#include "ImageReloader.h"
+#include "IconAtlas.h"
 #include <functional>
 
+#define ICON_ATLAS_FILE ".\\Trab1DanielSeitenfus\\images\\icons\\icons.atlas"
+
 ImageManager *imageManager;
+ImageReloader imageReloader;
 int xAux, yAux;
 bool showHint1;
 
 /**
- * Classe que representa um painel de exibio de imagens.
+ * Classe que representa um painel de exibição de imagens.
  */
 class ImagePanel {
+IconAtlas iconAtlas;
 ButtonManager *buttonManager;
 Panel panel;
 
@@ -40,6 +46,7 @@ public:
     ImagePanel(int x1, int y1, int x2, int y2) : panel(x1, y1, x2, y2) {
         imageManager = new ImageManager(panel);
         buttonManager = new ButtonManager();
+        setupIconAtlas();
         setupButtons();
         xAux = panel.x1;
         yAux = panel.y1;
@@ -47,17 +54,21 @@ public:
     }
 
     /**
-     * Renderiza o painel de exibio de imagens.
+     * Renderiza o painel de exibição de imagens. A moldura e os botões são raízes de árvores de widgets e reaproveitam a geometria entre os quadros.
+     * As imagens são recortadas pelo painel e pela janela.
+     * @param imageLevel Nível de mipmap das imagens; 0 desenha as imagens completas.
      */
-    void render() {
+    void render(int imageLevel = 0) {
         panel.render();
-        imageManager->render();
+        ClipRect window = {0, 0, screenWidth, screenHeight};
+        ClipRect area = {(int)panel.x1, (int)panel.y1, (int)panel.x2 + 1, (int)panel.y2 + 1};
+        imageManager->render(imageLevel, area.intersect(window));
         buttonManager->render();
         if(showHint1) renderStartHint();
     }
 
     /**
-     * Carrega imagens para exibio no painel e desabilita a exibio da dica 1.
+     * Carrega imagens para exibição no painel e desabilita a exibição da dica 1.
      */
     static void loadImages() {
         if(!imageManager->isEmpty()) return;
@@ -74,11 +85,43 @@ public:
      * @param fileName Nome do arquivo da imagem.
      */
     static void addImage(const char *fileName) {
-        imageManager->addImage(new Image(new Bmp(fileName), xAux, yAux));
+        Bmp *bmp = new Bmp(fileName);
+        imageReloader.watch(bmp);
+        imageManager->addImage(new Image(bmp, xAux, yAux));
         xAux += imageManager->getLastImage()->getWidth()/2;
         yAux += imageManager->getLastImage()->getHeight()-10;
     }
 
+    /**
+     * Troca, no início do frame, o conteúdo das imagens cujos arquivos foram alterados e já foram recarregados em segundo plano.
+     * Os pixels antigos são mantidos até releaseReplacedImages.
+     * @return true se alguma imagem foi trocada.
+     */
+    bool applyReloadedImages() {
+        std::vector<Bmp*> reloaded;
+        imageReloader.applyPending(reloaded);
+        for(size_t i=0; i<reloaded.size(); i++) {
+            imageManager->refreshImagesOf(reloaded[i]);
+            printf("\nImagem recarregada: %s", reloaded[i]->getFileName());
+        }
+        return !reloaded.empty();
+    }
+
+    /**
+     * Libera os pixels substituídos pelas recargas. Só deve ser chamada quando nenhuma outra thread (exportação, renderização) pode estar lendo os pixels antigos.
+     */
+    void releaseReplacedImages() {
+        imageReloader.releaseRetired();
+    }
+
+    /**
+     * Imprime as estatísticas do desenho das imagens: teste de oclusão e fundo do arraste.
+     */
+    void printImageStats() {
+        imageManager->printOcclusionStats();
+        imageManager->printDragStats();
+    }
+
     /**
      * Inverte a imagem horizontalmente.
      */
@@ -94,7 +137,22 @@ public:
     }
 
     /**
-     * Configura todos os botes do painel.
+     * Carrega o atlas com os ícones dos botões do painel (montado a partir dos arquivos dos ícones apenas na primeira execução).
+     */
+    void setupIconAtlas() {
+        const char *icons[] = {
+            ".\\Trab1DanielSeitenfus\\images\\icons\\addimages.bmp",
+            ".\\Trab1DanielSeitenfus\\images\\icons\\flipvertical.bmp",
+            ".\\Trab1DanielSeitenfus\\images\\icons\\fliphorizontal.bmp"
+        };
+        if(!iconAtlas.open(ICON_ATLAS_FILE, icons, 3)) {
+            printf("\nAviso: icones indisponiveis");
+        }
+        buttonManager->setIconAtlas(&iconAtlas);
+    }
+
+    /**
+     * Configura todos os botões do painel.
      */
     void setupButtons() {
         const int spacing = 1;
@@ -104,43 +162,43 @@ public:
         int x2Button = panel.x2-spacing;
         int y2Button = panel.y2-spacing;
 
-        buttonManager->addButton(x1Button, y1Button, x2Button, y2Button, "", Color::GREY, Color::BLACK, false, ".\\Trab1DanielSeitenfus\\images\\icons\\addimages.bmp", loadImages);
+        buttonManager->addButton(x1Button, y1Button, x2Button, y2Button, "", Color::GREY, Color::BLACK, false, "addimages", loadImages);
         y1Button -= buttonSize - spacing;
-        buttonManager->addButton(x1Button, y1Button, x2Button, buttonManager->getLastButton()->y1 - spacing, "", Color::GREY, Color::BLACK, false, ".\\Trab1DanielSeitenfus\\images\\icons\\flipvertical.bmp", flipImageVertically);
+        buttonManager->addButton(x1Button, y1Button, x2Button, buttonManager->getLastButton()->y1 - spacing, "", Color::GREY, Color::BLACK, false, "flipvertical", flipImageVertically);
         y1Button -= buttonSize - spacing;
-        buttonManager->addButton(x1Button, y1Button, x2Button, buttonManager->getLastButton()->y1 - spacing, "", Color::GREY, Color::BLACK, false, ".\\Trab1DanielSeitenfus\\images\\icons\\fliphorizontal.bmp", flipImageHorizontally);
+        buttonManager->addButton(x1Button, y1Button, x2Button, buttonManager->getLastButton()->y1 - spacing, "", Color::GREY, Color::BLACK, false, "fliphorizontal", flipImageHorizontally);
     }
 
     /**
-     * Inicializa a seleo de imagem no painel, selecionando a ltima imagem adicionada.
+     * Inicializa a seleção de imagem no painel, selecionando a última imagem adicionada.
      */
     static void initializeImageSelection() {
         imageManager->initializeImageSelection();
     }
 
     /**
-     * Trata os eventos do mouse, chamando os eventos correspondentes do manager de imagens e botes.
+     * Trata os eventos do mouse, chamando os eventos correspondentes do manager de imagens e botões.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
      * @param state Estado de clique do mouse.
      */
     void onMouseUpdated(int mx, int my, int state) {
         imageManager->onMouseUpdated(mx, my, state);
-        buttonManager->onMouseUpdated(mx, my, state);
+        buttonManager->dispatchMouse(mx, my, state);
     }
 
     /**
-     * Verifica se o mouse est dentro do painel.
+     * Verifica se o mouse está dentro do painel.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
-     * @return True se o mouse est dentro do painel, False caso contrrio.
+     * @return True se o mouse está dentro do painel, False caso contrário.
      */
     bool isMouseInsidePanel(int mx, int my) {
         return Math::isPointInsideRectangle(mx, my, panel.x1, panel.y1, panel.x2, panel.y2);
     }
 
     /**
-     * Obtm a imagem selecionada no painel.
+     * Obtém a imagem selecionada no painel.
      * @return Ponteiro para a imagem selecionada.
      */
     Image* getSelectedImage() {
@@ -160,7 +218,7 @@ public:
     }
 
     /**
-     * Obtm a coordenada x do canto inferior esquerdo do painel.
+     * Obtém a coordenada x do canto inferior esquerdo do painel.
      * @return Coordenada x do canto inferior esquerdo do painel.
      */
     int getX1() {
@@ -0,0 +1,267 @@
+/**
+ * @file ImagePreview.h
+ * @brief Definição da classe ImagePreview, que exibe a imagem selecionada de forma progressiva enquanto os efeitos mudam.
+ *
+ * Enquanto um controle que altera os efeitos (o slider de brilho) é arrastado, a imagem é desenhada a partir de um nível de mipmap do Bmp,
+ * com no máximo PREVIEW_MAX_PIXELS pixels. Quando o arraste termina ou pausa, uma thread aplica os efeitos à imagem completa (ImageEffects),
+ * e a imagem processada passa a ser exibida assim que fica pronta. Uma alteração durante o processamento o cancela: apenas o pedido mais
+ * recente é concluído. A imagem processada é compartilhada com os quadros que a desenham, então pode ser substituída a qualquer momento.
+ */
+
+#ifndef IMAGEPREVIEW_H_INCLUDED
+#define IMAGEPREVIEW_H_INCLUDED
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include "gl_canvas2d.h"
+#include "Image.h"
+#include "ImageEffects.h"
+
+#define PREVIEW_MAX_PIXELS 32768 /**< Pixels da prévia desenhada durante o arraste. */
+#define PREVIEW_PAUSE_MS   150   /**< Tempo sem alterações após o qual o arraste é considerado pausado. */
+
+/**
+ * Imagem completa com os efeitos aplicados.
+ */
+struct ProcessedImage {
+    unsigned int generation;
+    unsigned int source;               /**< Bmp::getContentGeneration da origem; muda quando o arquivo é recarregado. */
+    ImageEffects effects;
+    int width, height;
+    std::vector<unsigned char> pixels; /**< BGR, linhas de baixo para cima, sem preenchimento. */
+};
+
+/**
+ * Desenho de uma imagem processada. Guarda uma referência à imagem, que continua válida mesmo se uma nova a substituir antes do quadro ser desenhado.
+ */
+class ProcessedImageCommand : public CVCommand {
+    std::shared_ptr<const ProcessedImage> image;
+    int x, y;
+
+public:
+    ProcessedImageCommand(const std::shared_ptr<const ProcessedImage> &_image, int _x, int _y) : image(_image), x(_x), y(_y) {}
+
+    void execute() {
+        const float *normalized = Bmp::getNormalizationTable();
+        const unsigned char *pixel = image->pixels.empty() ? NULL : &image->pixels[0];
+        for(int row=0; row<image->height; row++) {
+            for(int column=0; column<image->width; column++, pixel+=3) {
+                CV::color(normalized[pixel[2]], normalized[pixel[1]], normalized[pixel[0]]);
+                CV::rectFill(x+column, y+row, x+column+1, y+row+1);
+            }
+        }
+    }
+};
+
+class ImagePreview {
+    struct BuildJob {
+        unsigned int generation;
+        const unsigned char *data;
+        unsigned int source;
+        int width, height, stride;
+        ImageEffects effects;
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    BuildJob job;
+    bool hasJob, building, stopping;
+    std::shared_ptr<const ProcessedImage> ready;     /**< Resultado da thread, ainda não usado. */
+    std::atomic<unsigned int> generation;            /**< Incrementada a cada pedido; processamentos de gerações anteriores são abandonados. */
+    long long builds, cancelledBuilds;
+
+    std::shared_ptr<const ProcessedImage> current;   /**< Última imagem processada exibida. */
+    bool upToDate;                                   /**< current corresponde à imagem e aos efeitos atuais. */
+    unsigned int requestedSource;                    /**< 0 sem pedido: as gerações de conteúdo do Bmp começam em 1. */
+    ImageEffects requestedEffects;
+    unsigned int lastSource;
+    ImageEffects lastEffects;
+    std::chrono::steady_clock::time_point lastChange;
+
+    ImagePreview(const ImagePreview&);
+    ImagePreview& operator=(const ImagePreview&);
+
+    static bool sameEffects(const ImageEffects &a, const ImageEffects &b) {
+        return a.rSelected == b.rSelected && a.gSelected == b.gSelected && a.bSelected == b.bSelected && a.lSelected == b.lSelected &&
+               a.lightness == b.lightness && a.flippedHorizontally == b.flippedHorizontally && a.flippedVertically == b.flippedVertically;
+    }
+
+    /**
+     * Aplica os efeitos à imagem completa, linha a linha.
+     * @return NULL se um pedido mais recente chegou durante o processamento.
+     */
+    std::shared_ptr<ProcessedImage> build(const BuildJob &request) {
+        std::shared_ptr<ProcessedImage> image = std::make_shared<ProcessedImage>();
+        image->generation = request.generation;
+        image->source = request.source;
+        image->effects = request.effects;
+        image->width = request.width;
+        image->height = request.height;
+        image->pixels.resize((size_t)request.width*request.height*3);
+        for(int row=0; row<request.height; row++) {
+            if(generation.load() != request.generation) return std::shared_ptr<ProcessedImage>();
+            request.effects.applyRow(request.data, request.width, request.height, request.stride, row, &image->pixels[(size_t)row*request.width*3]);
+        }
+        return image;
+    }
+
+    /**
+     * Laço da thread de processamento: processa sempre o pedido mais recente.
+     */
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            condition.wait(lock, [this] { return stopping || hasJob; });
+            if(stopping) return;
+
+            BuildJob request = job;
+            hasJob = false;
+            building = true;
+            lock.unlock();
+
+            std::shared_ptr<ProcessedImage> image = build(request);
+
+            lock.lock();
+            building = false;
+            if(image) {
+                ready = image;
+                builds++;
+            } else {
+                cancelledBuilds++;
+            }
+        }
+    }
+
+    /**
+     * Pede o processamento da imagem com os efeitos atuais, cancelando o que estiver em andamento.
+     */
+    void request(Image *image, const ImageEffects &effects) {
+        ImagePixels pixels = image->getPixels(0);
+        std::lock_guard<std::mutex> lock(mutex);
+        job.generation = ++generation;
+        job.data = pixels.data;
+        job.source = image->getBmp()->getContentGeneration();
+        job.width = pixels.width;
+        job.height = pixels.height;
+        job.stride = pixels.stride;
+        job.effects = effects;
+        hasJob = true;
+        requestedSource = job.source;
+        requestedEffects = effects;
+        if(!worker.joinable()) worker = std::thread(&ImagePreview::run, this);
+        condition.notify_one();
+    }
+
+    /**
+     * Cancela o pedido pendente ou em andamento, que ficou desatualizado.
+     */
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        if(hasJob) cancelledBuilds++; //o processamento em andamento é contado pela thread ao ser abandonado
+        hasJob = false;
+        requestedSource = 0;
+    }
+
+    /**
+     * Nível de mipmap com no máximo PREVIEW_MAX_PIXELS pixels (ou o menor disponível).
+     */
+    static int getPreviewLevel(Bmp *bmp) {
+        long long pixels = (long long)bmp->getWidth()*bmp->getHeight();
+        int level = 0;
+        while(pixels > PREVIEW_MAX_PIXELS && level + 1 < bmp->getMipCount()) {
+            pixels /= 4;
+            level++;
+        }
+        return level;
+    }
+
+public:
+    ImagePreview() : hasJob(false), building(false), stopping(false), generation(0), builds(0), cancelledBuilds(0),
+                     upToDate(false), requestedSource(0), lastSource(0) {}
+
+    ~ImagePreview() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            generation++; //abandona o processamento em andamento
+        }
+        condition.notify_all();
+        if(worker.joinable()) worker.join();
+    }
+
+    /**
+     * Deve ser chamada a cada frame, na thread principal, com a imagem exibida e seus efeitos atuais.
+     * Usa o resultado do processamento, se pronto, e pede um novo quando a imagem ou os efeitos mudaram e não há arraste em andamento.
+     * Uma alteração durante o arraste cancela o pedido anterior, que ficou desatualizado.
+     * @param interacting true enquanto um controle que altera os efeitos está sendo arrastado.
+     */
+    void update(Image *image, bool interacting) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(ready) {
+                if(ready->generation == generation.load()) current = ready;
+                ready.reset();
+            }
+        }
+
+        upToDate = false;
+        if(image == nullptr || image->getBmp() == nullptr || !image->getBmp()->isDecoded()) return;
+
+        ImageEffects effects = image->getEffects();
+        unsigned int source = image->getBmp()->getContentGeneration();
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(source != lastSource || !sameEffects(effects, lastEffects)) {
+            lastSource = source;
+            lastEffects = effects;
+            lastChange = now;
+        }
+
+        upToDate = current && current->source == source && sameEffects(current->effects, effects);
+        if(upToDate) return;
+
+        bool paused = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastChange).count() >= PREVIEW_PAUSE_MS;
+        if(requestedSource == source && sameEffects(requestedEffects, effects)) return;
+        if(!interacting || paused) {
+            request(image, effects);
+        } else if(requestedSource != 0) {
+            cancel();
+        }
+    }
+
+    /**
+     * Desenha a imagem processada, se corresponder aos efeitos atuais, ou a prévia a partir do mipmap.
+     */
+    void render(Image *image) {
+        if(upToDate) {
+            CV::record(new ProcessedImageCommand(current, image->x, image->y));
+        } else {
+            image->renderPreview(getPreviewLevel(image->getBmp()));
+        }
+    }
+
+    /**
+     * Indica se a thread está lendo (ou vai ler) os pixels de um Bmp.
+     */
+    bool isBuilding() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return building || hasJob;
+    }
+
+    /**
+     * Imprime os processamentos concluídos e cancelados.
+     */
+    void printStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        printf("\nPrevia da imagem selecionada: %lld processamentos completos, %lld cancelados\n", builds, cancelledBuilds);
+    }
+};
+
+#endif // IMAGEPREVIEW_H_INCLUDED
@@ -0,0 +1,155 @@
+/**
+ * @file ImageReloader.h
+ * @brief Definição da classe ImageReloader, que recarrega as imagens cujos arquivos foram alterados por outros programas.
+ *
+ * Os arquivos dos Bmp registrados são observados por um FileWatcher. Quando um arquivo muda, apenas ele é decodificado novamente, em uma thread separada,
+ * para um novo Bmp. No início do frame seguinte (applyPending) o conteúdo novo é trocado com o do Bmp original, de modo que as Image que o referenciam
+ * mantêm posição, efeitos e ordem de renderização, e o histograma passa a usar as novas estatísticas.
+ */
+
+#ifndef IMAGERELOADER_H_INCLUDED
+#define IMAGERELOADER_H_INCLUDED
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "Bmp.h"
+#include "FileWatcher.h"
+
+#define RELOAD_DEBOUNCE_MS 150 //aguarda o arquivo parar de mudar antes de recarregar
+
+class ImageReloader {
+    struct ReloadRequest {
+        int id;
+        bool decode; /**< Se o Bmp original já estava decodificado; senão basta ler o cabeçalho. */
+    };
+
+    struct ReloadResult {
+        int id;
+        Bmp *bmp;
+    };
+
+    FileWatcher watcher;
+    std::vector<Bmp*> targets;       /**< Bmp observado de cada arquivo (índice = identificador do FileWatcher). */
+    std::vector<std::string> names;  /**< Nome do arquivo de cada Bmp, lido pela thread sem acessar o Bmp original. */
+    std::vector<std::chrono::steady_clock::time_point> changedAt;
+    std::vector<bool> pending;
+    std::vector<Bmp*> retired;       /**< Conteúdos antigos, liberados quando ninguém mais os lê. */
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<ReloadRequest> queue;
+    std::vector<ReloadResult> ready;
+    bool stopping;
+
+    /**
+     * Laço da thread de recarga: decodifica os arquivos da fila, um por vez.
+     */
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            condition.wait(lock, [this] { return stopping || !queue.empty(); });
+            if(stopping) return;
+
+            ReloadRequest request = queue.front();
+            queue.pop_front();
+            std::string name = names[request.id];
+            lock.unlock();
+
+            Bmp *bmp = new Bmp(name.c_str());
+            if(request.decode) bmp->decode();
+
+            lock.lock();
+            if(bmp->isValid()) {
+                ReloadResult result = {request.id, bmp};
+                ready.push_back(result);
+            } else {
+                //arquivo incompleto ou inválido: mantém a imagem atual até a próxima alteração
+                printf("\nAviso: nao foi possivel recarregar %s", name.c_str());
+                delete bmp;
+            }
+        }
+    }
+
+public:
+    ImageReloader() : stopping(false) {}
+
+    ~ImageReloader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            for(size_t i=0; i<ready.size(); i++) delete ready[i].bmp;
+            ready.clear();
+        }
+        condition.notify_all();
+        if(worker.joinable()) worker.join();
+        releaseRetired();
+    }
+
+    /**
+     * Passa a observar o arquivo de um Bmp.
+     * @param bmp Bmp carregado de um arquivo. Deve continuar existindo enquanto este objeto existir.
+     */
+    void watch(Bmp *bmp) {
+        if(bmp == NULL || bmp->getFileName() == NULL) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        int id = watcher.addFile(bmp->getFileName());
+        targets.resize(id + 1);
+        names.resize(id + 1);
+        changedAt.resize(id + 1);
+        pending.resize(id + 1);
+        targets[id] = bmp;
+        names[id] = bmp->getFileName();
+        pending[id] = false;
+        if(!worker.joinable()) worker = std::thread(&ImageReloader::run, this);
+    }
+
+    /**
+     * Deve ser chamada no início de cada frame, na thread principal. Verifica os arquivos alterados, agenda as recargas
+     * e troca o conteúdo dos Bmp cujas recargas terminaram.
+     * @param reloaded Recebe os Bmp que mudaram de conteúdo neste frame.
+     */
+    void applyPending(std::vector<Bmp*> &reloaded) {
+        std::vector<int> changed;
+        watcher.poll(changed);
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for(size_t i=0; i<changed.size(); i++) {
+            changedAt[changed[i]] = now;
+            pending[changed[i]] = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t id=0; id<pending.size(); id++) {
+            if(pending[id] && std::chrono::duration_cast<std::chrono::milliseconds>(now - changedAt[id]).count() >= RELOAD_DEBOUNCE_MS) {
+                pending[id] = false;
+                ReloadRequest request = {(int)id, targets[id]->isDecoded()};
+                queue.push_back(request);
+            }
+        }
+        if(!queue.empty()) condition.notify_one();
+
+        for(size_t i=0; i<ready.size(); i++) {
+            Bmp *target = targets[ready[i].id];
+            target->swapContents(ready[i].bmp);
+            retired.push_back(ready[i].bmp);
+            reloaded.push_back(target);
+        }
+        ready.clear();
+    }
+
+    /**
+     * Libera os conteúdos substituídos. Só deve ser chamada quando nenhuma outra thread (exportação, por exemplo) estiver lendo pixels dos Bmp.
+     */
+    void releaseRetired() {
+        for(size_t i=0; i<retired.size(); i++) delete retired[i];
+        retired.clear();
+    }
+};
+
+#endif // IMAGERELOADER_H_INCLUDED
@@ -1,8 +1,10 @@
 /**
  * @file ImageSelectedSection.h
- * @brief Definio da classe ImageSelectedSection para visualizao de uma imagem selecionada.
+ * @brief Definição da classe ImageSelectedSection para visualização de uma imagem selecionada.
  *
- * Este arquivo contm a definio da classe ImageSelectedSection, que representa uma seo de visualizao de uma imagem selecionada juntamente com controles relacionados, como botes de seleo de canal de cor e um histograma.
+ * Este arquivo contém a definição da classe ImageSelectedSection, que representa uma seção de visualização de uma imagem selecionada juntamente com controles relacionados, como botões de seleção de canal de cor e um histograma.
+ * Os controles formam uma árvore de widgets com raiz na seção; a imagem selecionada muda a cada quadro e é desenhada pelo ImagePreview,
+ * em resolução reduzida enquanto o brilho é arrastado.
  */
 
 
@@ -15,9 +17,16 @@
 #include "Histogram.h"
 #include "Slider.h"
 #include "Text.h"
+#include "ImageExporter.h"
+#include "ImagePreview.h"
+#include "FrameArena.h"
+#include "FrameGovernor.h"
+#include "Widget.h"
+
+#define EXPORT_FILE_NAME ".\\Trab1DanielSeitenfus\\images\\exportada.bmp"
 
 /**
- * Estrutura para armazenar informaes sobre a imagem selecionada e as transformaes aplicadas a ela.
+ * Estrutura para armazenar informações sobre a imagem selecionada e as transformações aplicadas a ela.
  */
 struct ImageSelectedContainer {
     int x1, y1, x2, y2;
@@ -28,7 +37,7 @@ struct ImageSelectedContainer {
     Image *image;
 
     /**
-     * Aplica as opes de canal de cor selecionadas  imagem.
+     * Aplica as opções de canal de cor selecionadas à imagem.
      */
     void applyRgbOptions() {
         image->rSelected = rSelected;
@@ -38,7 +47,7 @@ struct ImageSelectedContainer {
     }
 
     /**
-     * Centraliza a imagem dentro do continer.
+     * Centraliza a imagem dentro do contêiner.
      */
     void centralizeImage() {
         int containerWidth = x2 - x1;
@@ -49,17 +58,23 @@ struct ImageSelectedContainer {
     }
 };
 
-ImageSelectedContainer *imageSelected;
-Histogram *histogram;
-ButtonManager* buttonManager;
+FrameArena frameArena; /**< Objetos temporários do quadro atual, liberados no início de cada atualização. */
 
 class ImageSelectedSection {
 int width, height;
 int x1, y1, x2, y2;
+ImageSelectedContainer imageSelected;
+Widget root; /**< Raiz dos controles da seção, que são liberados junto com ela. */
+ButtonManager* buttonManager;
+Histogram *histogram;
 Slider *slider;
 Text* sliderTitle;
 Text* histogramTitle;
 Text* histogramButtonLabel;
+Text* exportStatusText;
+ImageExporter exporter;
+ImagePreview preview;
+char exportStatus[100];
 
 const int buttonWidth = 40;
 const int buttonHeight = 40;
@@ -69,7 +84,7 @@ const int verticalSpacing = 10;
 public:
 
     /**
-     * Construtor da seo de imagem selecionada.
+     * Construtor da seção de imagem selecionada.
      * @param _x1 Coordenada x1 do canto superior esquerdo.
      * @param _y1 Coordenada y1 do canto superior esquerdo.
      * @param _x2 Coordenada x2 do canto inferior direito.
@@ -82,90 +97,103 @@ public:
         setupHistogram();
         setupButtons();
         setupTexts();
+        buildWidgetTree();
     }
 
     /**
-    * Funo para configurar a visualizao da imagem selecionada.
+    * Monta a árvore de controles, na ordem de desenho.
+    */
+    void buildWidgetTree() {
+        root.addChild(buttonManager);
+        root.addChild(histogramTitle);
+        root.addChild(histogram);
+        root.addChild(histogramButtonLabel);
+        root.addChild(sliderTitle);
+        root.addChild(slider);
+        root.addChild(exportStatusText);
+    }
+
+    /**
+    * Função para configurar a visualização da imagem selecionada.
     * @param *_image Ponteiro para a imagem selecionada.
     */
     void setupImageSelectedView(Image *_image) {
-        imageSelected = new ImageSelectedContainer();
-        imageSelected->image = _image;
-        imageSelected->x1 = x1;
-        imageSelected->y1 = y2 - 250;
-        imageSelected->x2 = x2;
-        imageSelected->y2 = y2;
-
-        imageSelected->rSelected = true;
-        imageSelected->gSelected = true;
-        imageSelected->bSelected = true;
-        imageSelected->lSelected = false;
+        imageSelected.image = _image;
+        imageSelected.x1 = x1;
+        imageSelected.y1 = y2 - 250;
+        imageSelected.x2 = x2;
+        imageSelected.y2 = y2;
+
+        imageSelected.rSelected = true;
+        imageSelected.gSelected = true;
+        imageSelected.bSelected = true;
+        imageSelected.lSelected = false;
 
         if(_image != nullptr) {
-            imageSelected->image = new Image(_image->getBmp(), x1, y1);
-            imageSelected->image->setSelected(false);
-            imageSelected->centralizeImage();
+            imageSelected.image = new Image(_image->getBmp(), x1, y1);
+            imageSelected.image->setSelected(false);
+            imageSelected.centralizeImage();
         }
     }
 
     /**
-    * Funo que habilita/desabilita o canal de cor vermelho da imagem no clique do boto ou da tecla 'R'.
+    * Função que habilita/desabilita o canal de cor vermelho da imagem no clique do botão ou da tecla 'R'.
     */
-    static void rButtonClick() {
-        imageSelected->rSelected = !imageSelected->rSelected;
-        imageSelected->lSelected = false;
+    void rButtonClick() {
+        imageSelected.rSelected = !imageSelected.rSelected;
+        imageSelected.lSelected = false;
         refreshButtons();
     }
 
     /**
-    * Funo que habilita/desabilita o canal de cor verde da imagem no clique do boto ou da tecla 'G'.
+    * Função que habilita/desabilita o canal de cor verde da imagem no clique do botão ou da tecla 'G'.
     */
-    static void gButtonClick() {
-        imageSelected->gSelected = !imageSelected->gSelected;
-        imageSelected->lSelected = false;
+    void gButtonClick() {
+        imageSelected.gSelected = !imageSelected.gSelected;
+        imageSelected.lSelected = false;
         refreshButtons();
     }
 
     /**
-    * Funo que habilita/desabilita o canal de cor azul da imagem no clique do boto ou da tecla 'B'.
+    * Função que habilita/desabilita o canal de cor azul da imagem no clique do botão ou da tecla 'B'.
     */
-    static void bButtonClick() {
-        imageSelected->bSelected = !imageSelected->bSelected;
-        imageSelected->lSelected = false;
+    void bButtonClick() {
+        imageSelected.bSelected = !imageSelected.bSelected;
+        imageSelected.lSelected = false;
         refreshButtons();
     }
 
     /**
-    * Funo que habilita/desabilita a exibio da imagem em tons de cinza no clique do boto ou da tecla 'L'.
+    * Função que habilita/desabilita a exibição da imagem em tons de cinza no clique do botão ou da tecla 'L'.
     */
-    static void lButtonClick() {
-        imageSelected->lSelected = !imageSelected->lSelected;
-        imageSelected->rSelected = !imageSelected->lSelected;
-        imageSelected->gSelected = !imageSelected->lSelected;
-        imageSelected->bSelected = !imageSelected->lSelected;
+    void lButtonClick() {
+        imageSelected.lSelected = !imageSelected.lSelected;
+        imageSelected.rSelected = !imageSelected.lSelected;
+        imageSelected.gSelected = !imageSelected.lSelected;
+        imageSelected.bSelected = !imageSelected.lSelected;
         refreshButtons();
     }
 
     /**
-    * Alterna o tipo de visualizao do histograma (preenchido ou vazado).
+    * Alterna o tipo de visualização do histograma (preenchido ou vazado).
     */
-    static void changeHistogramVisualization() {
+    void changeHistogramVisualization() {
         histogram->changeVisualizationOption();
         buttonManager->toggleSelectButton(4);
     }
 
     /**
-    * Atualiza a visualizao dos botes de acordo com a seleo de cores.
+    * Atualiza a visualização dos botões de acordo com a seleção de cores.
     */
-    static void refreshButtons() {
-        buttonManager->setSelectButton(0, imageSelected->rSelected);
-        buttonManager->setSelectButton(1, imageSelected->gSelected);
-        buttonManager->setSelectButton(2, imageSelected->bSelected);
-        buttonManager->setSelectButton(3, imageSelected->lSelected);
+    void refreshButtons() {
+        buttonManager->setSelectButton(0, imageSelected.rSelected);
+        buttonManager->setSelectButton(1, imageSelected.gSelected);
+        buttonManager->setSelectButton(2, imageSelected.bSelected);
+        buttonManager->setSelectButton(3, imageSelected.lSelected);
     }
 
     /**
-    * Cria um manager e configura todos os botes da "seo de imagem selecionada".
+    * Cria um manager e configura todos os botões da "seção de imagem selecionada".
     */
     void setupButtons() {
         buttonManager = new ButtonManager();
@@ -175,22 +203,22 @@ public:
     }
 
     /**
-    * Configura os botes 'R', 'G', 'B' e 'L'.
+    * Configura os botões 'R', 'G', 'B' e 'L'.
     */
     void setupRgbButtons() {
         int x1Button = x1;
         int x2Button = x1Button + buttonWidth;
-        int y1Button = imageSelected->y1 - buttonHeight - verticalSpacing;
+        int y1Button = imageSelected.y1 - buttonHeight - verticalSpacing;
         int y2Button = y1Button + buttonHeight;
 
-        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "R", Color::RED, Color::WHITE, true, rButtonClick);
-        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "G", Color::GREEN, Color::WHITE, true, gButtonClick);
-        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "B", Color::BLUE, Color::WHITE, true, bButtonClick);
-        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "L", Color::GREY, Color::WHITE, true, lButtonClick);
+        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "R", Color::RED, Color::WHITE, true, [this] { rButtonClick(); });
+        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "G", Color::GREEN, Color::WHITE, true, [this] { gButtonClick(); });
+        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "B", Color::BLUE, Color::WHITE, true, [this] { bButtonClick(); });
+        addRgbButton(&x1Button, &y1Button, &x2Button, &y2Button, "L", Color::GREY, Color::WHITE, true, [this] { lButtonClick(); });
     }
 
     /**
-    * Adiciona um boto do tipo 'RGB' ao manager de botes.
+    * Adiciona um botão do tipo 'RGB' ao manager de botões.
     */
     void addRgbButton(int* x1, int* y1, int* x2, int* y2, char* text, Color buttonColor, Color textColor, bool selectable, Func action) {
         buttonManager->addButton(*x1, *y1 , *x2, *y2, text, buttonColor, textColor, selectable, action);
@@ -199,23 +227,23 @@ public:
     }
 
     /**
-    * Configura o boto do histograma.
+    * Configura o botão do histograma.
     */
     void setupHistogramButton() {
-        buttonManager->addButton(histogram->x2 - 120, histogram->y1 - 18, histogram->x2 - 105, histogram->y1 - 7, " ", Color::GREY, Color::WHITE, true, changeHistogramVisualization);
+        buttonManager->addButton(histogram->x2 - 120, histogram->y1 - 18, histogram->x2 - 105, histogram->y1 - 7, " ", Color::GREY, Color::WHITE, true, [this] { changeHistogramVisualization(); });
         buttonManager->getLastButton()->setSelected(true);
     }
 
     /**
-    * Configura a exibio do slider de brilho.
+    * Configura a exibição do slider de brilho.
     */
     void setupSlider() {
         const int marginTop = 110;
-        slider = new Slider(x1, imageSelected->y1 - marginTop, x2, imageSelected->y1 - marginTop, Color::BLACK, true);
+        slider = new Slider(x1, imageSelected.y1 - marginTop, x2, imageSelected.y1 - marginTop, Color::BLACK, true);
     }
 
     /**
-    * Configura a exibio do histograma.
+    * Configura a exibição do histograma.
     */
     void setupHistogram() {
         const int marginBottom = 40;
@@ -224,40 +252,82 @@ public:
     }
 
     /**
-    * Configura todos os textos desta seo.
+    * Configura todos os textos desta seção.
     */
     void setupTexts() {
         sliderTitle = new Text(slider->x1,slider->y2+20, "Brilho", Color::BLACK);
         histogramTitle = new Text(histogram->x1,histogram->y2+10, "Histograma", Color::BLACK);
         histogramButtonLabel = new Text(histogram->x2 - 100, histogram->y1 - 17, "Preenchido", Color::BLACK);
+        exportStatus[0] = '\0';
+        exportStatusText = new Text(x1, y1 + 10, exportStatus, Color::BLACK);
+    }
+
+    /**
+    * Exporta a imagem selecionada, com os efeitos aplicados, no clique da tecla 'S'. A gravação é feita em segundo plano.
+    */
+    void exportImage() {
+        if(imageSelected.image == nullptr) return;
+        if(!exporter.start(imageSelected.image, EXPORT_FILE_NAME)) {
+            printf("\nNao foi possivel iniciar a exportacao");
+        }
     }
 
     /**
-    * Renderiza todos os elementos.
+    * Indica se outra thread (exportação ou processamento da prévia) pode estar lendo os pixels de um Bmp.
+    */
+    bool isReadingPixels() {
+        return exporter.isRunning() || preview.isBuilding();
+    }
+
+    /**
+    * Imprime as estatísticas da prévia da imagem selecionada.
+    */
+    void printPreviewStats() {
+        preview.printStats();
+    }
+
+    /**
+    * Atualiza o texto de progresso da exportação.
+    */
+    void refreshExportStatus() {
+        switch(exporter.getState()) {
+            case EXPORT_RUNNING:
+                snprintf(exportStatus, sizeof(exportStatus), "Exportando... %d%%", (int)(exporter.getProgress()*100));
+                break;
+            case EXPORT_DONE:
+                snprintf(exportStatus, sizeof(exportStatus), "Imagem exportada");
+                break;
+            case EXPORT_FAILED:
+                snprintf(exportStatus, sizeof(exportStatus), "Erro ao exportar a imagem");
+                break;
+            default:
+                exportStatus[0] = '\0';
+        }
+        exportStatusText->setText(exportStatus);
+    }
+
+    /**
+    * Renderiza todos os elementos. Os controles que não mudaram desde o último quadro são reaproveitados pela árvore de widgets.
     */
     void render() {
-       if(imageSelected->image != nullptr) imageSelected->image->render();
-       buttonManager->render();
-       if(histogram != nullptr){
-            histogramTitle->render();
-            histogram->render();
-            histogramButtonLabel->render();
+       if(imageSelected.image != nullptr) {
+           frameGovernor.enter(SUBSYSTEM_IMAGES);
+           preview.render(imageSelected.image);
+           frameGovernor.leave();
        }
-
-       sliderTitle->render();
-       slider->render();
+       refreshExportStatus();
+       root.render();
     }
 
     /**
-    * Aciona os eventos de mouse para o manager de botes e slider sempre que o mouse  movido ou clicado.
+    * Encaminha os eventos de mouse à árvore de controles (botões e slider) sempre que o mouse é movido ou clicado.
     */
     void onMouseUpdated(int mx, int my, int state) {
-        buttonManager->onMouseUpdated(mx, my, state);
-        slider->onMouseUpdated(mx, my, state);
+        root.dispatchMouse(mx, my, state);
     }
 
     /**
-    * Aciona as funes de alterao no canal de cores sempre que houver uma atualizao de teclado.
+    * Aciona as funções de alteração no canal de cores sempre que houver uma atualização de teclado.
     */
     void onKeyboardUpdated(int key) {
         if(key == 114) { //R
@@ -268,22 +338,26 @@ public:
             bButtonClick();
         } else if (key == 108) { // L
             lButtonClick();
+        } else if (key == 115) { // S
+            exportImage();
         }
     }
 
     /**
-    * Atribui uma nova imagem selecionada  esta seo.
+    * Atribui uma nova imagem selecionada à esta seção. A cópia exibida é criada no alocador do quadro e vale até a próxima atualização.
     * @param *_image Ponteiro para a imagem selecionada.
     */
     void setImageSelected(Image *_image) {
         if(_image != nullptr) {
-            imageSelected->image = new Image(_image, x1, y1);
-            imageSelected->applyRgbOptions();
-            imageSelected->centralizeImage();
-            imageSelected->image->setLightness(slider->getValueByPosition()*-1);
-            imageSelected->image->setSelected(false);
-            if(histogram != nullptr) histogram->setImage(imageSelected->image);
+            imageSelected.image = frameArena.create<Image>(_image, x1, y1);
+            imageSelected.applyRgbOptions();
+            imageSelected.centralizeImage();
+            imageSelected.image->setLightness(slider->getValueByPosition()*-1);
+            imageSelected.image->setSelected(false);
+            //com o quadro acima do orçamento, o governador pode adiar a atualização do histograma
+            if(histogram->needsRefresh(imageSelected.image) && frameGovernor.isHistogramRefreshAllowed()) histogram->setImage(imageSelected.image);
         }
+        preview.update(_image != nullptr ? imageSelected.image : nullptr, slider->isDragging());
     }
 };
 
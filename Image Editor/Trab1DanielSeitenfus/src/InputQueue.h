@@ -0,0 +1,118 @@
+/**
+ * @file InputQueue.h
+ * @brief Definição da classe InputQueue, fila dos eventos de entrada recebidos entre dois frames.
+ *
+ * Os callbacks do GLUT apenas enfileiram os eventos, que são despachados uma vez por frame, no início da atualização da cena.
+ * Movimentos consecutivos do mouse são agrupados no último: apenas a posição mais recente é despachada, já que cada movimento
+ * faria os mesmos testes de colisão e atualizações de posição. Cliques, soltura de botões, roda e teclas nunca são agrupados
+ * e mantêm a ordem em que chegaram, assim como o movimento anterior a cada um deles.
+ */
+
+#ifndef INPUTQUEUE_H_INCLUDED
+#define INPUTQUEUE_H_INCLUDED
+
+#include <stdio.h>
+#include <vector>
+#include "InputReplay.h"
+
+/**
+ * Contadores da fila de eventos.
+ */
+struct InputQueueStats {
+    long long received;   /**< Eventos recebidos dos callbacks. */
+    long long dispatched; /**< Eventos despachados aos gerenciadores. */
+    long long coalesced;  /**< Movimentos descartados por terem sido substituídos por um mais recente. */
+    long long frames;     /**< Frames em que algum evento foi despachado. */
+};
+
+class InputQueue {
+    std::vector<InputEvent> events, dispatching;
+    bool coalescing;
+    InputQueueStats stats;
+
+    static bool isMotion(const InputEvent &event) {
+        return event.type == INPUT_MOUSE && event.button == -2 && event.state == -2 && event.wheel == -2;
+    }
+
+public:
+    InputQueue() : coalescing(true) {
+        stats.received = stats.dispatched = stats.coalesced = stats.frames = 0;
+    }
+
+    /**
+     * Ativa ou desativa o agrupamento dos movimentos (para comparação; desativado, todos os eventos são despachados).
+     */
+    void setCoalescing(bool enable) {
+        coalescing = enable;
+    }
+
+    /**
+     * Enfileira um evento de mouse, com os mesmos parâmetros do callback mouse().
+     */
+    void pushMouse(int button, int state, int wheel, int direction, int x, int y) {
+        InputEvent event = InputEvent();
+        event.type = INPUT_MOUSE;
+        event.button = button;
+        event.state = state;
+        event.wheel = wheel;
+        event.direction = direction;
+        event.x = x;
+        event.y = y;
+        stats.received++;
+
+        if(coalescing && isMotion(event) && !events.empty() && isMotion(events.back())) {
+            events.back() = event; //apenas a posição mais recente interessa
+            stats.coalesced++;
+            return;
+        }
+        events.push_back(event);
+    }
+
+    /**
+     * Enfileira um evento de teclado.
+     * @param type INPUT_KEY_DOWN ou INPUT_KEY_UP.
+     */
+    void pushKey(InputEventType type, int key) {
+        InputEvent event = InputEvent();
+        event.type = type;
+        event.key = key;
+        stats.received++;
+        events.push_back(event);
+    }
+
+    /**
+     * Despacha os eventos enfileirados, na ordem em que chegaram, e esvazia a fila. Deve ser chamada uma vez por frame.
+     * Eventos enfileirados pelos próprios tratadores ficam para o frame seguinte.
+     */
+    void dispatch(MouseCallback mouse, KeyCallback keyDown, KeyCallback keyUp) {
+        if(events.empty()) return;
+        dispatching.swap(events);
+        for(size_t i=0; i<dispatching.size(); i++) {
+            const InputEvent &event = dispatching[i];
+            if(event.type == INPUT_MOUSE) {
+                mouse(event.button, event.state, event.wheel, event.direction, event.x, event.y);
+            } else if(event.type == INPUT_KEY_DOWN) {
+                keyDown(event.key);
+            } else {
+                keyUp(event.key);
+            }
+        }
+        stats.dispatched += dispatching.size();
+        stats.frames++;
+        dispatching.clear();
+    }
+
+    const InputQueueStats& getStats() {
+        return stats;
+    }
+
+    /**
+     * Imprime os eventos recebidos e despachados.
+     */
+    void printStats() {
+        printf("\nFila de entrada: %lld eventos recebidos, %lld despachados (%lld movimentos agrupados) em %lld frames\n",
+               stats.received, stats.dispatched, stats.coalesced, stats.frames);
+    }
+};
+
+#endif // INPUTQUEUE_H_INCLUDED
@@ -0,0 +1,320 @@
+/**
+ * @file InputReplay.h
+ * @brief Gravação e reprodução determinística dos eventos de entrada (mouse e teclado).
+ *
+ * O InputRecorder grava em arquivo texto, com instante em microssegundos, cada evento que chega aos callbacks mouse(), keyboard() e keyboardUp(),
+ * já com a coordenada y convertida por ConvertMouseCoord. Também grava um marcador a cada frame renderizado.
+ * O InputReplayer lê esse arquivo e injeta os eventos de volta pelos mesmos callbacks, medindo o tempo de tratamento de cada evento
+ * e a latência entre o evento e o fim do frame que o exibe. Com isso, cenários como "arrastar imagem pelo painel" ou "varrer o slider"
+ * podem ser repetidos e comparados.
+ *
+ * Formato do arquivo (uma linha por evento):
+ *   # input-record 1 <largura> <altura>
+ *   M <tempo> <button> <state> <wheel> <direction> <x> <y>
+ *   K <tempo> <tecla>     (tecla pressionada)
+ *   U <tempo> <tecla>     (tecla liberada)
+ *   F <tempo>             (fim de frame)
+ */
+
+#ifndef INPUTREPLAY_H_INCLUDED
+#define INPUTREPLAY_H_INCLUDED
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#define INPUT_RECORD_VERSION 1
+
+/**
+ * Tipos de evento. O valor é o próprio caractere usado no arquivo.
+ */
+enum InputEventType {
+    INPUT_MOUSE = 'M',
+    INPUT_KEY_DOWN = 'K',
+    INPUT_KEY_UP = 'U',
+    INPUT_FRAME = 'F'
+};
+
+/**
+ * Evento de entrada gravado.
+ */
+struct InputEvent {
+    char type;
+    long long time; /**< Microssegundos desde o início da gravação. */
+    int button, state, wheel, direction, x, y;
+    int key;
+};
+
+/**
+ * Relógio monotônico em microssegundos.
+ */
+inline long long inputClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Classe que grava os eventos de entrada em arquivo.
+ */
+class InputRecorder {
+    FILE *file;
+    long long start;
+
+public:
+    /**
+     * Construtor do gravador.
+     * @param fileName Arquivo de saída.
+     * @param width Largura da tela no início da gravação.
+     * @param height Altura da tela no início da gravação.
+     */
+    InputRecorder(const char *fileName, int width, int height) {
+        start = inputClockMicros();
+        file = fopen(fileName, "w");
+        if(file == NULL) {
+            printf("\nErro ao abrir arquivo %s para gravacao de eventos", fileName);
+            return;
+        }
+        fprintf(file, "# input-record %d %d %d\n", INPUT_RECORD_VERSION, width, height);
+    }
+
+    ~InputRecorder() {
+        if(file != NULL) fclose(file);
+    }
+
+    bool isOpen() {
+        return file != NULL;
+    }
+
+    void recordMouse(int button, int state, int wheel, int direction, int x, int y) {
+        if(file == NULL) return;
+        fprintf(file, "M %lld %d %d %d %d %d %d\n", elapsed(), button, state, wheel, direction, x, y);
+    }
+
+    /**
+     * @param type INPUT_KEY_DOWN ou INPUT_KEY_UP.
+     * @param key Código da tecla.
+     */
+    void recordKey(InputEventType type, int key) {
+        if(file == NULL) return;
+        fprintf(file, "%c %lld %d\n", (char)type, elapsed(), key);
+    }
+
+    void recordFrame() {
+        if(file == NULL) return;
+        fprintf(file, "F %lld\n", elapsed());
+    }
+
+private:
+    long long elapsed() {
+        return inputClockMicros() - start;
+    }
+};
+
+typedef void (*MouseCallback)(int button, int state, int wheel, int direction, int x, int y);
+typedef void (*KeyCallback)(int key);
+
+/**
+ * Classe que reproduz um arquivo de eventos e gera o relatório de tempos.
+ *
+ * Com janela, cada evento é despachado no primeiro frame em que seu instante gravado já passou, e a latência é medida
+ * desde esse instante até o fim do frame. Em modo headless, os eventos são despachados o mais rápido possível, respeitando
+ * os marcadores de frame gravados, e a latência é medida desde o despacho até o fim da atualização do frame.
+ */
+class InputReplayer {
+    std::vector<InputEvent> events;
+    size_t next;
+    long long start;
+    bool started;
+    int width, height;
+
+    MouseCallback mouseCallback;
+    KeyCallback keyDownCallback;
+    KeyCallback keyUpCallback;
+
+    std::vector<long long> pendingEvents; /**< Instante de referência dos eventos despachados e ainda não exibidos em um frame. */
+    std::vector<double> mouseButtonTimes, mouseMotionTimes, keyTimes, latencies, frameTimes;
+    long long lastFrameEnd;
+
+public:
+    /**
+     * Construtor do reprodutor.
+     * @param fileName Arquivo gravado pelo InputRecorder.
+     * @param _mouse Callback de mouse.
+     * @param _keyDown Callback de tecla pressionada.
+     * @param _keyUp Callback de tecla liberada.
+     */
+    InputReplayer(const char *fileName, MouseCallback _mouse, KeyCallback _keyDown, KeyCallback _keyUp)
+        : mouseCallback(_mouse), keyDownCallback(_keyDown), keyUpCallback(_keyUp) {
+        next = 0;
+        started = false;
+        width = height = 0;
+        lastFrameEnd = 0;
+        load(fileName);
+    }
+
+    bool isLoaded() {
+        return !events.empty();
+    }
+
+    int getWidth() {
+        return width;
+    }
+
+    int getHeight() {
+        return height;
+    }
+
+    /**
+     * Indica se todos os eventos já foram despachados e exibidos.
+     */
+    bool isFinished() {
+        return next >= events.size() && pendingEvents.empty();
+    }
+
+    /**
+     * Modo com janela: despacha todos os eventos cujo instante gravado já passou. Deve ser chamado no início do frame.
+     */
+    void dispatchDue() {
+        long long now = inputClockMicros();
+        if(!started) {
+            start = now;
+            lastFrameEnd = now;
+            started = true;
+        }
+
+        while(next < events.size() && start + events[next].time <= now) {
+            InputEvent &event = events[next++];
+            if(event.type == INPUT_FRAME) continue;
+            dispatch(event);
+            pendingEvents.push_back(start + event.time);
+        }
+    }
+
+    /**
+     * Modo headless: despacha os eventos até o próximo marcador de frame.
+     * @return false quando não há mais eventos.
+     */
+    bool dispatchNextFrame() {
+        if(!started) {
+            lastFrameEnd = inputClockMicros();
+            started = true;
+        }
+        if(next >= events.size()) return false;
+
+        while(next < events.size()) {
+            InputEvent &event = events[next++];
+            if(event.type == INPUT_FRAME) break;
+            long long dispatchTime = inputClockMicros();
+            dispatch(event);
+            pendingEvents.push_back(dispatchTime);
+        }
+        return true;
+    }
+
+    /**
+     * Deve ser chamado no fim de cada frame. Registra a latência dos eventos pendentes e o tempo do frame.
+     */
+    void onFrameEnd() {
+        long long now = inputClockMicros();
+        for(size_t i=0; i<pendingEvents.size(); i++) {
+            latencies.push_back((now - pendingEvents[i])/1000.0);
+        }
+        pendingEvents.clear();
+        frameTimes.push_back((now - lastFrameEnd)/1000.0);
+        lastFrameEnd = now;
+    }
+
+    /**
+     * Imprime os percentis de tempo de tratamento por tipo de evento, de latência evento-frame e de tempo de frame.
+     */
+    void printReport() {
+        printf("\n\nReplay: %d eventos", (int)(mouseButtonTimes.size() + mouseMotionTimes.size() + keyTimes.size()));
+        printf("\n%-26s %8s %9s %9s %9s %9s", "(ms)", "n", "p50", "p90", "p99", "max");
+        printPercentiles("tratamento clique mouse", mouseButtonTimes);
+        printPercentiles("tratamento movimento", mouseMotionTimes);
+        printPercentiles("tratamento teclado", keyTimes);
+        printPercentiles("latencia evento-frame", latencies);
+        printPercentiles("tempo de frame", frameTimes);
+        printf("\n");
+    }
+
+private:
+    void load(const char *fileName) {
+        FILE *fp = fopen(fileName, "r");
+        if(fp == NULL) {
+            printf("\nErro ao abrir arquivo de eventos %s", fileName);
+            return;
+        }
+
+        int version = 0;
+        if(fscanf(fp, "# input-record %d %d %d", &version, &width, &height) != 3 || version != INPUT_RECORD_VERSION) {
+            printf("\nError: Arquivo de eventos %s invalido", fileName);
+            fclose(fp);
+            return;
+        }
+
+        char type;
+        while(fscanf(fp, " %c", &type) == 1) {
+            InputEvent event = InputEvent();
+            event.type = type;
+            int read = 0;
+            if(type == INPUT_MOUSE) {
+                read = fscanf(fp, "%lld %d %d %d %d %d %d", &event.time, &event.button, &event.state, &event.wheel, &event.direction, &event.x, &event.y) == 7;
+            } else if(type == INPUT_KEY_DOWN || type == INPUT_KEY_UP) {
+                read = fscanf(fp, "%lld %d", &event.time, &event.key) == 2;
+            } else if(type == INPUT_FRAME) {
+                read = fscanf(fp, "%lld", &event.time) == 1;
+            }
+
+            if(!read) {
+                printf("\nError: Evento invalido no arquivo %s (evento %d)", fileName, (int)events.size());
+                break;
+            }
+            events.push_back(event);
+        }
+        fclose(fp);
+    }
+
+    /**
+     * Chama o callback correspondente ao evento, medindo o tempo de tratamento.
+     */
+    void dispatch(const InputEvent &event) {
+        long long begin = inputClockMicros();
+        if(event.type == INPUT_MOUSE) {
+            mouseCallback(event.button, event.state, event.wheel, event.direction, event.x, event.y);
+        } else if(event.type == INPUT_KEY_DOWN) {
+            keyDownCallback(event.key);
+        } else if(event.type == INPUT_KEY_UP) {
+            keyUpCallback(event.key);
+        }
+        double elapsed = (inputClockMicros() - begin)/1000.0;
+
+        if(event.type == INPUT_MOUSE) {
+            if(event.state == -2) mouseMotionTimes.push_back(elapsed);
+            else mouseButtonTimes.push_back(elapsed);
+        } else {
+            keyTimes.push_back(elapsed);
+        }
+    }
+
+    void printPercentiles(const char *label, std::vector<double> values) {
+        if(values.empty()) {
+            printf("\n%-26s %8d", label, 0);
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        printf("\n%-26s %8d %9.3f %9.3f %9.3f %9.3f", label, (int)values.size(),
+               percentile(values, 0.50), percentile(values, 0.90), percentile(values, 0.99), values.back());
+    }
+
+    /**
+     * Percentil pelo método nearest-rank, sobre um vetor já ordenado.
+     */
+    static double percentile(const std::vector<double> &sorted, double p) {
+        size_t rank = (size_t)(p*sorted.size() + 0.999999);
+        if(rank < 1) rank = 1;
+        return sorted[std::min(rank, sorted.size()) - 1];
+    }
+};
+
+#endif // INPUTREPLAY_H_INCLUDED
@@ -4,19 +4,19 @@
 #include <math.h>
 
 /**
- * Classe utilitria para operaes matemticas simples.
+ * Classe utilitária para operações matemáticas simples.
  */
 class Math {
 public:
      /**
-     * Calcula a distncia entre dois pontos.
+     * Calcula a distância entre dois pontos.
      */
     static float distance(int x1, int y1, int x2, int y2) {
         return std::sqrt((x2 - x1)*(x2 - x1) + (y2 - y1)*(y2 - y1));
     }
 
     /**
-     * Verifica se um ponto est dentro de um retngulo.
+     * Verifica se um ponto está dentro de um retângulo.
      */
     static bool isPointInsideRectangle(int pointX, int pointY, int x1, int y1, int x2, int y2) {
         return pointX >= x1 && pointX <= x2 && pointY >= y1 && pointY <= y2;
@@ -0,0 +1,51 @@
+//*********************************************************
+//
+// alocador de buffers de pixels
+// Os blocos sao alinhados em 64 bytes (linha de cache e largura de um registrador AVX-512),
+// o que permite usar loads/stores alinhados nos kernels SIMD. Blocos grandes podem ser
+// apoiados em paginas grandes (huge pages), reduzindo faltas de TLB ao percorrer a imagem.
+// Todas as alocacoes sao contabilizadas.
+//
+//**********************************************************
+
+#ifndef ___PIXELALLOCATOR__H___
+#define ___PIXELALLOCATOR__H___
+
+#include <stddef.h>
+
+#define PIXEL_ALIGNMENT       64
+#define HUGE_PAGE_SIZE        (2*1024*1024)
+
+typedef struct {
+   long long allocations;      /* Total de alocacoes realizadas            */
+   long long releases;         /* Total de liberacoes                      */
+   long long bytesAllocated;   /* Total de bytes ja alocados               */
+   long long bytesInUse;       /* Bytes alocados e ainda nao liberados     */
+   long long peakBytesInUse;   /* Maior valor de bytesInUse                */
+   long long hugePageBlocks;   /* Blocos apoiados em huge pages            */
+} ALLOCATORSTATS;
+
+
+class PixelAllocator {
+public:
+   //aloca um bloco de bytes alinhado em PIXEL_ALIGNMENT. Retorna NULL se faltar memoria.
+   static void* allocate(size_t bytes);
+
+   //libera um bloco obtido por allocate. Aceita NULL.
+   static void release(void *block);
+
+   //aloca um vetor de count elementos de um tipo simples (sem construtor), como unsigned char e float.
+   template<typename T>
+   static T* allocateArray(size_t count) {
+      return (T*)allocate(count*sizeof(T));
+   }
+
+   //habilita huge pages para blocos a partir de HUGE_PAGE_SIZE (apenas Linux, via madvise; nas demais plataformas nao tem efeito).
+   static void setHugePages(bool enable);
+
+   static ALLOCATORSTATS getStats();
+
+   static void printStats(const char *title);
+};
+
+#endif
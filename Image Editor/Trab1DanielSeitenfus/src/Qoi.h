@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// codificador e decodificador do formato QOI ("Quite OK Image")
+// Formato sem perdas, de codificacao e decodificacao rapidas.
+//
+//  Referencia:  https://qoiformat.org/qoi-specification.pdf
+//
+//**********************************************************
+
+#ifndef ___QOI__H___
+#define ___QOI__H___
+
+#include <stdio.h>
+
+#define QOI_HEADER_SIZE   14
+#define QOI_END_SIZE      8   //7 bytes 0x00 seguidos de 0x01
+#define QOI_SRGB          0
+#define QOI_LINEAR        1
+
+typedef struct {
+   unsigned int width, height;     /* Big endian no arquivo        */
+   unsigned char channels;         /* 3 = RGB, 4 = RGBA            */
+   unsigned char colorspace;       /* QOI_SRGB ou QOI_LINEAR       */
+} QOIHEADER;
+
+
+//decodificador incremental: os pixels sao gerados em ordem (de cima para baixo, da esquerda para a direita),
+//permitindo processar cada linha logo apos decodifica-la.
+class QoiDecoder {
+private:
+   const unsigned char *bytes, *end;
+   unsigned char index[64][4];
+   unsigned char px[4];
+   int run;
+
+public:
+   QoiDecoder(const unsigned char *data, int size);
+
+   //decodifica count pixels para out, com outChannels (3 ou 4) bytes por pixel, na ordem RGB(A).
+   //retorna false se os dados acabarem antes; nesse caso os pixels restantes sao preenchidos com preto.
+   bool decodePixels(unsigned char *out, int count, int outChannels);
+};
+
+
+class Qoi {
+public:
+   //verifica se os 4 primeiros bytes de um arquivo sao a assinatura "qoif"
+   static bool isQoi(const unsigned char magic[4]);
+
+   //le o cabecalho de 14 bytes. Retorna false se a assinatura ou as dimensoes forem invalidas.
+   static bool readHeader(const unsigned char *bytes, QOIHEADER *header);
+
+   //codifica width x height pixels. stride e a distancia em bytes entre linhas de pixels (channels bytes por pixel, RGB(A)).
+   //Se bottomUp, a primeira linha na memoria e a linha de baixo da imagem (como no BMP).
+   //Retorna o buffer codificado (liberar com delete[]) e o tamanho em outSize.
+   static unsigned char* encode(const unsigned char *pixels, int width, int height, int channels, int stride, bool bottomUp, int *outSize);
+
+   //codifica e grava em arquivo. Retorna false em caso de erro.
+   static bool write(const char *fileName, const unsigned char *pixels, int width, int height, int channels, int stride, bool bottomUp);
+};
+
+#endif
@@ -1,17 +1,18 @@
 /**
  * @file Slider.h
- * @brief Definio da classe Slider para criao e manipulao de um controle deslizante.
+ * @brief Definição da classe Slider para criação e manipulação de um controle deslizante.
  *
- * Este arquivo contm a definio da classe Slider, responsvel por representar um controle deslizante na interface grfica.
+ * Este arquivo contém a definição da classe Slider, responsável por representar um controle deslizante na interface gráfica.
  */
 
 #ifndef SLIDER_H_INCLUDED
 #define SLIDER_H_INCLUDED
 
 #include "Math.h"
+#include "Widget.h"
 
 /**
- * Classe para representar o boto deslizante de um slider.
+ * Classe para representar o botão deslizante de um slider.
  */
 class SliderHandle {
 
@@ -23,10 +24,10 @@ public:
 
     /**
      * Construtor da classe SliderHandle.
-     * @param _x1 Coordenada x do boto deslizante.
-     * @param _y1 Coordenada y do boto deslizante.
-     * @param _radius Raio do boto deslizante.
-     * @param _color Cor do boto deslizante.
+     * @param _x1 Coordenada x do botão deslizante.
+     * @param _y1 Coordenada y do botão deslizante.
+     * @param _radius Raio do botão deslizante.
+     * @param _color Cor do botão deslizante.
      */
     SliderHandle(int _x1, int _y1, int _radius, Color _color) : x1(_x1), y1(_y1), radius(_radius), color(_color) {}
 };
@@ -34,7 +35,7 @@ public:
 /**
  * Classe para representar um controle deslizante.
  */
-class Slider {
+class Slider : public Widget {
     Color color;
     bool dragging;
     SliderHandle *sliderHandle;
@@ -45,21 +46,19 @@ class Slider {
     int initialValuePosition;
 
 public:
-    int x1, y1, x2, y2;
-
      /**
      * @brief Construtor da classe Slider.
      * @param _x1 Coordenada x do ponto inicial.
      * @param _y1 Coordenada y do ponto inicial.
      * @param _x2 Coordenada x do ponto final.
      * @param _y2 Coordenada y do ponto final.
-     * @param _color Cor do boto deslizante.
-     * @param _allowNegativeValues Indica se valores negativos so permitidos.
+     * @param _color Cor do botão deslizante.
+     * @param _allowNegativeValues Indica se valores negativos são permitidos.
      */
-    Slider(int _x1, int _y1, int _x2, int _y2, Color _color, bool _allowNegativeValues) : x1(_x1), y1(_y1), x2(_x2), y2(_y2), color(_color), allowNegativeValues(_allowNegativeValues) {
+    Slider(int _x1, int _y1, int _x2, int _y2, Color _color, bool _allowNegativeValues) : Widget(_x1, _y1, _x2, _y2), color(_color), allowNegativeValues(_allowNegativeValues) {
         dragging = false;
 
-        initialValuePosition = allowNegativeValues ? x2/2 : x1;
+        initialValuePosition = allowNegativeValues ? _x2/2 : _x1;
         sliderHandle = new SliderHandle(initialValuePosition, y1, 8, color);
 
         maxValue = 1;
@@ -67,19 +66,19 @@ public:
     }
 
     /**
-     * Renderiza o controle deslizante.
+     * Desenha o controle deslizante.
      */
-    void render() {
+    void draw() {
         CV::color(color.r, color.g, color.b);
         CV::line(x1, y1, x2, y2);
         CV::circleFill(sliderHandle->x1, sliderHandle->y1, sliderHandle->radius, 25);
     }
 
     /**
-     * Verifica a coliso do mouse com o boto do slider.
+     * Verifica a colisão do mouse com o botão do slider.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
-     * @return True se houve coliso, False caso contrrio.
+     * @return True se houve colisão, False caso contrário.
      */
     bool checkCollision(int mx, int my) {
         int dist = Math::distance(mx, my, sliderHandle->x1, sliderHandle->y1);
@@ -87,7 +86,7 @@ public:
     }
 
     /**
-     * Obtm o valor do slider com base na posio do boto.
+     * Obtém o valor do slider com base na posição do botão.
      * @return Valor do slider.
      */
     float getValueByPosition() {
@@ -96,28 +95,62 @@ public:
     }
 
     /**
-     * Atualiza a posio do boto deslizante com base na interao do mouse.
+     * Indica se o botão deslizante está sendo arrastado.
+     */
+    bool isDragging() {
+        return dragging;
+    }
+
+    /**
+     * A área clicável é o botão deslizante.
+     */
+    bool contains(int mx, int my) {
+        return checkCollision(mx, my);
+    }
+
+    /**
+     * Inclui o botão deslizante nas extremidades da linha.
+     */
+    bool getExtent(float *ex1, float *ey1, float *ex2, float *ey2) {
+        *ex1 = x1 - sliderHandle->radius;
+        *ey1 = y1 - sliderHandle->radius;
+        *ex2 = x2 + sliderHandle->radius;
+        *ey2 = y2 + sliderHandle->radius;
+        return true;
+    }
+
+    bool isInteractive() {
+        return true;
+    }
+
+    /**
+     * Atualiza a posição do botão deslizante com base na interação do mouse. Recebe o clique no botão deslizante e os eventos seguintes até o botão do mouse ser solto.
      * @param mx Coordenada x do mouse.
      * @param my Coordenada y do mouse.
      * @param state Estado do mouse.
      */
-    void onMouseUpdated(int mx, int my, int state) {
+    void onMouse(int mx, int my, int state) {
         if(dragging) {
+            int position;
             if(mx >= x2) {
-                sliderHandle->x1 = x2;
+                position = x2;
             } else if(mx <= x1) {
-                sliderHandle->x1 = x1;
+                position = x1;
             } else {
-                sliderHandle->x1 = mx;
+                position = mx;
+            }
+            if(position != sliderHandle->x1) {
+                sliderHandle->x1 = position;
+                invalidate();
             }
         }
 
-        if(state == 0) {
+        if(state == MOUSE_STATE_DOWN) {
             if(checkCollision(mx, my)) {
                 dragging = true;
             }
 
-        } else if(state == 1) {
+        } else if(state == MOUSE_STATE_UP) {
             dragging = false;
         }
     }
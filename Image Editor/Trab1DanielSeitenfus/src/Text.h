@@ -1,41 +1,65 @@
 /**
  * @file Text.h
- * @brief Definio da classe Text para renderizao de texto na tela.
+ * @brief Definição da classe Text para renderização de texto na tela.
  *
- * Este arquivo contm a definio da classe Text, que  utilizada para renderizar texto na tela.
+ * Este arquivo contém a definição da classe Text, que é utilizada para renderizar texto na tela.
  */
 
 #ifndef TEXT_H_INCLUDED
 #define TEXT_H_INCLUDED
 
+#include <string>
 #include "Color.h"
 #include "gl_canvas2d.h"
+#include "Widget.h"
+
+#define TEXT_CHAR_WIDTH  10 /**< Avanço de cada caractere em CV::text. */
+#define TEXT_CHAR_HEIGHT 13
 
 /**
- * Classe para renderizao de texto na tela.
+ * Classe para renderização de texto na tela. A posição do texto é (x1, y1).
  */
-class Text {
+class Text : public Widget {
+    std::string text;
+
+protected:
+    /**
+     * Desenha o texto.
+     */
+    void draw() {
+        CV::color(color.r, color.g, color.b);
+        CV::text(x1, y1, text.c_str());
+    }
+
+    bool getExtent(float *ex1, float *ey1, float *ex2, float *ey2) {
+        *ex1 = x1;
+        *ey1 = y1;
+        *ex2 = x1 + text.size()*TEXT_CHAR_WIDTH;
+        *ey2 = y1 + TEXT_CHAR_HEIGHT;
+        return !text.empty();
+    }
+
 public:
-    int x;
-    int y;
-    const char* text;
     Color color;
 
     /**
      *  Construtor da classe Text.
      * @param _x Coordenada x do texto.
      * @param _y Coordenada y do texto.
-     * @param _text Texto a ser renderizado.
+     * @param _text Texto a ser renderizado (copiado).
      * @param _color Cor do texto.
      */
-    Text(int _x, int _y, const char* _text, Color _color) : x(_x), y(_y), text(_text), color(_color) {}
+    Text(int _x, int _y, const char* _text, Color _color) : Widget(_x, _y, _x, _y), text(_text), color(_color) {}
 
     /**
-     * Renderiza o texto na tela.
+     * Altera o texto. A geometria só é refeita se o conteúdo mudar.
+     * @param _text Novo texto.
      */
-    void render() {
-        CV::color(color.r, color.g, color.b);
-        CV::text(x, y, text);
+    void setText(const char *_text) {
+        if(text == _text) return;
+        text = _text;
+        invalidate();
+        extentChanged();
     }
 };
 
@@ -0,0 +1,166 @@
+/**
+ * @file ThreadPool.h
+ * @brief Definição da classe ThreadPool, um conjunto fixo de threads para processar faixas de um intervalo em paralelo.
+ *
+ * parallelFor divide o intervalo em faixas (bandas) de tamanho fixo e distribui blocos contíguos de faixas entre as threads,
+ * preservando a localidade. Cada thread consome as faixas do seu bloco do início para o fim; quando termina, rouba faixas do fim
+ * do bloco de outra thread (work-stealing), para que uma thread atrasada não segure o resultado com as últimas faixas.
+ * A thread que chama parallelFor também trabalha e só retorna quando todas as faixas foram processadas.
+ */
+
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+class ThreadPool {
+    /**
+     * Faixas ainda não processadas do bloco de uma thread: início nos 32 bits altos, fim (exclusivo) nos baixos.
+     * O dono retira faixas do início e os ladrões do fim, ambos com compare-and-swap, sem travas.
+     */
+    struct BandQueue {
+        std::atomic<unsigned long long> bounds;
+        char padding[64 - sizeof(std::atomic<unsigned long long>)]; /**< Uma fila por linha de cache. */
+    };
+
+    std::vector<std::thread> threads;
+    BandQueue *queues;
+    int threadCount;                 /**< Inclui a thread que chama parallelFor. */
+
+    std::mutex mutex;
+    std::condition_variable startCondition, doneCondition;
+    std::mutex runMutex;             /**< Um parallelFor por vez; as demais chamadas rodam sem paralelismo. */
+    const std::function<void(int, int, int)> *task;
+    int count, grain;
+    unsigned int generation;
+    int running;
+    bool stopping;
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    static unsigned long long pack(unsigned int begin, unsigned int end) {
+        return ((unsigned long long)begin << 32) | end;
+    }
+
+    /**
+     * Retira a primeira faixa da fila (dono) ou a última (ladrão).
+     * @return Índice da faixa, ou -1 se a fila estiver vazia.
+     */
+    int take(BandQueue *queue, bool fromEnd) {
+        unsigned long long bounds = queue->bounds.load();
+        while(true) {
+            unsigned int begin = bounds >> 32, end = (unsigned int)bounds;
+            if(begin >= end) return -1;
+            unsigned long long next = fromEnd ? pack(begin, end - 1) : pack(begin + 1, end);
+            if(queue->bounds.compare_exchange_weak(bounds, next)) return fromEnd ? end - 1 : begin;
+        }
+    }
+
+    /**
+     * Processa as faixas do próprio bloco e depois rouba das outras threads, até não restar nenhuma.
+     */
+    void work(int self) {
+        while(true) {
+            int band = take(&queues[self], false);
+            for(int i=1; band < 0 && i<threadCount; i++) {
+                band = take(&queues[(self + i) % threadCount], true);
+            }
+            if(band < 0) return; //nenhuma faixa é adicionada durante a execução: todas as filas vazias encerram o trabalho
+
+            int first = band*grain;
+            int last = first + grain < count ? first + grain : count;
+            (*task)(first, last, self);
+        }
+    }
+
+    void run(int self) {
+        unsigned int seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            startCondition.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+            lock.unlock();
+
+            work(self);
+
+            lock.lock();
+            if(--running == 0) doneCondition.notify_one();
+        }
+    }
+
+public:
+    /**
+     * @param _threadCount Número de threads, incluindo a que chama parallelFor. 0 usa o número de núcleos.
+     */
+    ThreadPool(int _threadCount = 0) : task(nullptr), count(0), grain(1), generation(0), running(0), stopping(false) {
+        threadCount = _threadCount > 0 ? _threadCount : (int)std::thread::hardware_concurrency();
+        if(threadCount < 1) threadCount = 1;
+        queues = new BandQueue[threadCount];
+        for(int i=1; i<threadCount; i++) {
+            threads.push_back(std::thread(&ThreadPool::run, this, i));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startCondition.notify_all();
+        for(size_t i=0; i<threads.size(); i++) threads[i].join();
+        delete[] queues;
+    }
+
+    int getThreadCount() {
+        return threadCount;
+    }
+
+    /**
+     * Executa task(first, last, thread) para todas as faixas [first, last) de [0, _count), com até _grain itens cada.
+     * Se outro parallelFor estiver em execução (chamado de outra thread), tudo é executado na thread atual.
+     * @param task Função chamada de várias threads ao mesmo tempo. O terceiro parâmetro é o índice da thread (0 a getThreadCount()-1),
+     *        útil para acumular resultados parciais sem sincronização.
+     */
+    void parallelFor(int _count, int _grain, const std::function<void(int, int, int)> &_task) {
+        if(_count <= 0) return;
+        if(_grain < 1) _grain = 1;
+        int bands = (_count + _grain - 1) / _grain;
+
+        std::unique_lock<std::mutex> runLock(runMutex, std::try_to_lock);
+        if(threadCount == 1 || bands == 1 || !runLock.owns_lock()) {
+            for(int first=0; first<_count; first+=_grain) {
+                _task(first, first + _grain < _count ? first + _grain : _count, 0);
+            }
+            return;
+        }
+
+        task = &_task;
+        count = _count;
+        grain = _grain;
+        for(int i=0; i<threadCount; i++) {
+            queues[i].bounds.store(pack((long long)bands*i/threadCount, (long long)bands*(i + 1)/threadCount));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = threadCount - 1;
+            generation++;
+        }
+        startCondition.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return running == 0; });
+        task = nullptr;
+    }
+};
+
+#endif // THREADPOOL_H_INCLUDED
@@ -0,0 +1,72 @@
+/**
+ * @file TripleBuffer.h
+ * @brief Definição da classe TripleBuffer, que passa valores de uma thread produtora para uma consumidora sem travas e sem espera.
+ *
+ * São três cópias do valor: a do produtor (escrita), a do consumidor (leitura) e uma intermediária, com a última publicada.
+ * Publicar troca a cópia do produtor pela intermediária e consumir troca a intermediária pela do consumidor, cada troca com uma única
+ * operação atômica. Nenhum dos lados espera o outro: o produtor pode publicar várias vezes enquanto o consumidor lê (as publicações não lidas
+ * são substituídas) e o consumidor relê a sua cópia enquanto não houver uma nova.
+ * Apenas uma thread deve produzir e apenas uma deve consumir.
+ */
+
+#ifndef TRIPLEBUFFER_H_INCLUDED
+#define TRIPLEBUFFER_H_INCLUDED
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+    static const int INDEX_MASK = 3;
+    static const int FRESH = 4;  /**< A cópia intermediária foi publicada e ainda não foi consumida. */
+
+    T slots[3];
+    std::atomic<int> middle;     /**< Índice da cópia intermediária, com o bit FRESH. */
+    int back;                    /**< Usado apenas pelo produtor. */
+    int front;                   /**< Usado apenas pelo consumidor. */
+
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    /**
+     * Cópia em que o produtor escreve o próximo valor. Pode conter um valor antigo, já descartado pelo consumidor.
+     */
+    T& getBack() {
+        return slots[back];
+    }
+
+    /**
+     * Publica a cópia do produtor, que passa a ser a intermediária. O produtor recebe a intermediária anterior.
+     */
+    void publish() {
+        back = middle.exchange(back | FRESH) & INDEX_MASK;
+    }
+
+    /**
+     * Indica se o último valor publicado ainda não foi consumido. Pode ser chamada pelo produtor para não publicar mais rápido do que o consumidor lê.
+     */
+    bool isPending() {
+        return (middle.load() & FRESH) != 0;
+    }
+
+    /**
+     * Pega o último valor publicado, se houver um novo desde a última chamada.
+     * @return false se nada foi publicado desde então; getFront continua com o valor anterior.
+     */
+    bool acquire() {
+        if((middle.load() & FRESH) == 0) return false;
+        front = middle.exchange(front) & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * Cópia do consumidor, com o último valor pego por acquire.
+     */
+    T& getFront() {
+        return slots[front];
+    }
+};
+
+#endif // TRIPLEBUFFER_H_INCLUDED
@@ -0,0 +1,325 @@
+/**
+ * @file Widget.h
+ * @brief Definição da classe Widget, base dos elementos da interface (botões, textos, slider, painel e histograma) organizados em árvore.
+ *
+ * Cada widget guarda a própria geometria já submetida em uma display list do OpenGL e só a recompila quando é marcado como alterado (invalidate).
+ * A raiz guarda ainda uma lista com as chamadas às listas de todos os widgets visíveis, na ordem de desenho, refeita apenas quando a estrutura
+ * muda (widgets adicionados, exibidos ou ocultados). Assim, um quadro sem alterações custa uma única glCallList para a árvore inteira.
+ * Um widget pode ter ainda uma segunda lista, desenhada depois dos filhos (drawOverlay), usada por exemplo para desenhar os ícones de todos os botões em um lote.
+ * Quando a CV grava os quadros para a thread de renderização, a árvore é desenhada diretamente a cada quadro.
+ * O teste de colisão percorre a árvore descartando os ramos cujo retângulo envolvente não contém o ponto.
+ */
+
+#ifndef WIDGET_H_INCLUDED
+#define WIDGET_H_INCLUDED
+
+#include <vector>
+#include "gl_canvas2d.h"
+#include "Math.h"
+
+#define MOUSE_STATE_DOWN 0
+#define MOUSE_STATE_UP   1
+
+class Widget {
+    Widget *parent;
+    std::vector<Widget*> children;
+    GLuint displayList;      /**< Geometria do próprio widget. */
+    GLuint overlayList;      /**< Geometria desenhada depois dos filhos, se hasOverlay. */
+    GLuint treeList;         /**< Apenas na raiz: chamadas às listas da árvore, em ordem. */
+    bool dirty;              /**< A geometria mudou desde a última compilação. */
+    bool structureChanged;   /**< Apenas na raiz: a lista da árvore precisa ser refeita. */
+    bool boundsChanged;      /**< O retângulo envolvente precisa ser recalculado. */
+    bool visible;
+    bool hasBox;
+    float boxX1, boxY1, boxX2, boxY2; /**< Retângulo que envolve o widget e os descendentes visíveis. */
+    Widget *captured;        /**< Apenas na raiz: widget que recebeu o clique e recebe os eventos até o botão ser solto. */
+
+    Widget(const Widget&);
+    Widget& operator=(const Widget&);
+
+    Widget* getRoot() {
+        Widget *root = this;
+        while(root->parent != nullptr) root = root->parent;
+        return root;
+    }
+
+    void markStructureChanged() {
+        getRoot()->structureChanged = true;
+    }
+
+    void markBoundsChanged() {
+        for(Widget *widget = this; widget != nullptr; widget = widget->parent) widget->boundsChanged = true;
+    }
+
+    /**
+     * Recalcula o retângulo envolvente a partir da extensão própria e dos filhos visíveis.
+     */
+    void refreshBounds() {
+        if(!boundsChanged) return;
+        boundsChanged = false;
+
+        float ex1, ey1, ex2, ey2;
+        hasBox = getExtent(&ex1, &ey1, &ex2, &ey2);
+        if(hasBox) {
+            boxX1 = ex1; boxY1 = ey1; boxX2 = ex2; boxY2 = ey2;
+        }
+        for(size_t i=0; i<children.size(); i++) {
+            Widget *child = children[i];
+            if(!child->visible) continue;
+            child->refreshBounds();
+            if(!child->hasBox) continue;
+            if(!hasBox) {
+                boxX1 = child->boxX1; boxY1 = child->boxY1; boxX2 = child->boxX2; boxY2 = child->boxY2;
+                hasBox = true;
+            } else {
+                if(child->boxX1 < boxX1) boxX1 = child->boxX1;
+                if(child->boxY1 < boxY1) boxY1 = child->boxY1;
+                if(child->boxX2 > boxX2) boxX2 = child->boxX2;
+                if(child->boxY2 > boxY2) boxY2 = child->boxY2;
+            }
+        }
+    }
+
+    /**
+     * Recompila as listas dos widgets visíveis alterados.
+     */
+    void compileDirty() {
+        if(!visible) return;
+        if(displayList == 0) {
+            displayList = glGenLists(1);
+            markStructureChanged();
+            dirty = true;
+        }
+        if(dirty) {
+            prepare();
+            //a cor conhecida pela CV é descartada antes da compilação, para que a lista sempre defina as cores que usa,
+            //e depois dela, pois os comandos compilados não alteram o estado atual
+            CV::resetState();
+            glNewList(displayList, GL_COMPILE);
+            draw();
+            CV::flush();
+            glEndList();
+            if(hasOverlay()) {
+                if(overlayList == 0) {
+                    overlayList = glGenLists(1);
+                    markStructureChanged();
+                }
+                glNewList(overlayList, GL_COMPILE);
+                drawOverlay();
+                CV::flush();
+                glEndList();
+            }
+            CV::resetState();
+            dirty = false;
+        }
+        for(size_t i=0; i<children.size(); i++) children[i]->compileDirty();
+    }
+
+    /**
+     * Grava na lista da raiz a chamada à lista de cada widget visível. As listas chamadas são resolvidas na execução,
+     * então recompilar a lista de um widget não exige refazer a da raiz.
+     */
+    void emitCalls() {
+        if(!visible) return;
+        glCallList(displayList);
+        for(size_t i=0; i<children.size(); i++) children[i]->emitCalls();
+        if(overlayList != 0) glCallList(overlayList);
+    }
+
+    /**
+     * Desenha os widgets visíveis diretamente, sem display lists. Usada quando a CV grava o quadro para a thread de renderização,
+     * que não compartilha as listas do OpenGL com a thread que grava.
+     */
+    void drawTree() {
+        if(!visible) return;
+        draw();
+        for(size_t i=0; i<children.size(); i++) children[i]->drawTree();
+        if(hasOverlay()) drawOverlay();
+    }
+
+protected:
+    /**
+     * Desenha a geometria própria do widget (sem os filhos). Chamada apenas quando o widget foi alterado; o resultado é reutilizado nos quadros seguintes.
+     */
+    virtual void draw() {}
+
+    /**
+     * Indica se o widget tem geometria desenhada depois dos filhos (drawOverlay).
+     */
+    virtual bool hasOverlay() {
+        return false;
+    }
+
+    /**
+     * Desenha a geometria que fica por cima dos filhos. Compilada junto com draw.
+     */
+    virtual void drawOverlay() {}
+
+    /**
+     * Chamada antes de compilar as listas do widget, fora de glNewList: comandos como a criação de texturas seriam gravados na lista em vez de executados.
+     */
+    virtual void prepare() {}
+
+    /**
+     * Retângulo ocupado pelo desenho do widget, usado na poda do teste de colisão.
+     * @return false se o widget não ocupa área própria (grupos).
+     */
+    virtual bool getExtent(float *ex1, float *ey1, float *ex2, float *ey2) {
+        *ex1 = x1; *ey1 = y1; *ex2 = x2; *ey2 = y2;
+        return x2 > x1 || y2 > y1;
+    }
+
+    /**
+     * Indica se o widget recebe cliques.
+     */
+    virtual bool isInteractive() {
+        return false;
+    }
+
+    /**
+     * Trata um evento de mouse. Recebe o clique que o atingiu e os eventos seguintes até o botão ser solto.
+     */
+    virtual void onMouse(int mx, int my, int state) {}
+
+public:
+    float x1, y1, x2, y2;
+
+    Widget(float _x1 = 0, float _y1 = 0, float _x2 = 0, float _y2 = 0) : parent(nullptr), displayList(0), overlayList(0), treeList(0), dirty(true), structureChanged(true),
+                                                                          boundsChanged(true), visible(true), hasBox(false), captured(nullptr),
+                                                                          x1(_x1), y1(_y1), x2(_x2), y2(_y2) {}
+
+    /**
+     * Destrutor. O widget é dono dos filhos.
+     */
+    virtual ~Widget() {
+        for(size_t i=0; i<children.size(); i++) delete children[i];
+        if(displayList != 0) glDeleteLists(displayList, 1);
+        if(overlayList != 0) glDeleteLists(overlayList, 1);
+        if(treeList != 0) glDeleteLists(treeList, 1);
+    }
+
+    /**
+     * Adiciona um filho, desenhado depois (por cima) dos filhos já existentes.
+     * @param child Widget sem pai; passa a pertencer a este widget.
+     * @return O próprio filho.
+     */
+    Widget* addChild(Widget *child) {
+        child->parent = this;
+        children.push_back(child);
+        markStructureChanged();
+        markBoundsChanged();
+        return child;
+    }
+
+    int getChildCount() {
+        return children.size();
+    }
+
+    Widget* getChild(int index) {
+        if(index < 0 || index >= (int)children.size()) return nullptr;
+        return children[index];
+    }
+
+    /**
+     * Marca a geometria do widget como alterada, para ser recompilada no próximo quadro.
+     */
+    void invalidate() {
+        dirty = true;
+    }
+
+    /**
+     * Altera o retângulo do widget.
+     */
+    void setBounds(float _x1, float _y1, float _x2, float _y2) {
+        x1 = _x1; y1 = _y1; x2 = _x2; y2 = _y2;
+        invalidate();
+        markBoundsChanged();
+    }
+
+    /**
+     * Deve ser chamada quando o resultado de getExtent mudar sem passar por setBounds.
+     */
+    void extentChanged() {
+        markBoundsChanged();
+    }
+
+    void setVisible(bool _visible) {
+        if(visible == _visible) return;
+        visible = _visible;
+        markStructureChanged();
+        if(parent != nullptr) parent->markBoundsChanged();
+    }
+
+    bool isVisible() {
+        return visible;
+    }
+
+    /**
+     * Verifica se um ponto está na área clicável do widget.
+     */
+    virtual bool contains(int mx, int my) {
+        return Math::isPointInsideRectangle(mx, my, x1, y1, x2, y2);
+    }
+
+    /**
+     * Procura o widget interativo sob o ponto. Os filhos desenhados por último (por cima) são testados primeiro.
+     * @return O widget atingido, ou nullptr.
+     */
+    Widget* hitTest(int mx, int my) {
+        if(!visible) return nullptr;
+        refreshBounds();
+        if(!hasBox || !Math::isPointInsideRectangle(mx, my, boxX1, boxY1, boxX2, boxY2)) return nullptr; //poda do ramo
+
+        for(int i=(int)children.size()-1; i>=0; i--) {
+            Widget *hit = children[i]->hitTest(mx, my);
+            if(hit != nullptr) return hit;
+        }
+        return isInteractive() && contains(mx, my) ? this : nullptr;
+    }
+
+    /**
+     * Distribui um evento de mouse a partir da raiz: o clique vai para o widget atingido, que recebe os eventos seguintes até o botão ser solto.
+     * @return true se algum widget tratou o evento.
+     */
+    bool dispatchMouse(int mx, int my, int state) {
+        if(captured != nullptr) {
+            Widget *target = captured;
+            if(state == MOUSE_STATE_UP) captured = nullptr;
+            target->onMouse(mx, my, state);
+            return true;
+        }
+        if(state != MOUSE_STATE_DOWN) return false;
+
+        Widget *target = hitTest(mx, my);
+        if(target == nullptr) return false;
+        captured = target;
+        target->onMouse(mx, my, state);
+        return true;
+    }
+
+    /**
+     * Desenha a árvore a partir da raiz: recompila as listas alteradas e executa a lista da árvore.
+     */
+    void render() {
+        if(CV::isRecording()) {
+            drawTree();
+            return;
+        }
+        CV::flush(); //glNewList e glCallList não podem ser chamadas entre glBegin e glEnd
+        compileDirty();
+        if(treeList == 0) {
+            treeList = glGenLists(1);
+            structureChanged = true;
+        }
+        if(structureChanged) {
+            glNewList(treeList, GL_COMPILE);
+            emitCalls();
+            glEndList();
+            structureChanged = false;
+        }
+        glCallList(treeList);
+        CV::resetState(); //as listas alteraram a cor atual
+    }
+};
+
+#endif // WIDGET_H_INCLUDED
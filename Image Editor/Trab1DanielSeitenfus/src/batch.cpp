@@ -0,0 +1,378 @@
+/**
+* batch - Aplica a mesma edição do editor a vários arquivos, sem interface gráfica.
+*
+*  Uso:
+*    batch [opções] entrada1 [entrada2 ...]
+*       Cada entrada pode ser um arquivo (BMP ou QOI) ou um diretório; de um diretório são processados os arquivos .bmp e .qoi,
+*       exceto as saídas de execuções anteriores (*_editada.bmp).
+*       A saída é sempre um BMP de 24 bits.
+*
+*  Opções:
+*    -o diretorio       Grava as saídas no diretório indicado, com o mesmo nome da entrada e extensão .bmp.
+*                       Sem -o, a saída fica ao lado da entrada, com o sufixo "_editada.bmp".
+*                       Entradas com o mesmo nome e extensões diferentes mantêm a extensão no nome (x.qoi -> x_qoi_editada.bmp).
+*    -j N               Número de threads de trabalho (padrão: número de núcleos).
+*    -c canais          Canais mantidos, combinação de r, g e b (ex.: -c rg). Os demais ficam zerados.
+*    -l                 Escala de cinza (luminância, mesma fórmula de Image::getLuminance).
+*    -L valor           Brilho, de -1 (escurece) a 1 (clareia), como o slider do editor.
+*    -fh, -fv           Inversão horizontal e vertical.
+*    -B raio            Desfoque gaussiano (raio de 1 a 32), aplicado antes dos demais efeitos.
+*    -S quantidade      Nitidez: máscara de nitidez de raio 1 (ex.: -S 1).
+*    -U raio,quantidade Máscara de nitidez: imagem + quantidade*(imagem - desfoque de raio raio).
+*
+*    batch -h
+*       Exibe o uso.
+*
+*    batch --bench-filtro [-j N] arquivo
+*       Mede o desfoque gaussiano e a máscara de nitidez para os raios de 1 a 32 e exibe o custo por pixel.
+*
+*  Cada thread carrega, processa e grava um arquivo por vez, então no máximo N imagens ficam na memória ao mesmo tempo.
+*  Com um único arquivo, o filtro (BmpFilter) usa as N threads; com vários, cada filtro roda na thread do seu arquivo.
+*  Ao final são exibidos arquivos/s e MB/s (em relação ao tamanho dos pixels decodificados). O retorno é diferente de zero se algum arquivo falhar.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "Bmp.h"
+#include "BmpWriter.h"
+#include "BmpFilter.h"
+#include "ThreadPool.h"
+#include "ImageEffects.h"
+
+struct BatchJob {
+    std::vector<std::string> files;
+    std::vector<std::string> outputs;  /**< Saída de cada arquivo, definida antes de as threads começarem. */
+    std::string outputDir;
+    ImageEffects effects;
+    BmpFilter filter;
+    bool filtering;
+    ThreadPool *filterPool;  /**< NULL quando vários arquivos são processados em paralelo. */
+
+    std::atomic<int> next;
+    std::atomic<int> failures;
+    std::atomic<long long> bytes;
+    std::mutex printMutex;
+
+    BatchJob() : filtering(false), filterPool(nullptr), next(0), failures(0), bytes(0) {}
+};
+
+bool isDirectory(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR);
+}
+
+std::string toLower(std::string text) {
+    for(size_t i=0; i<text.size(); i++) text[i] = tolower(text[i]);
+    return text;
+}
+
+bool hasImageExtension(const std::string &name) {
+    size_t dot = name.find_last_of('.');
+    if(dot == std::string::npos) return false;
+    std::string extension = toLower(name.substr(dot + 1));
+    return extension == "bmp" || extension == "qoi";
+}
+
+/**
+ * Verifica se o arquivo é a saída de uma execução anterior sem -o, que não deve ser editada de novo ao varrer o diretório.
+ */
+bool isPreviousOutput(const std::string &name) {
+    static const std::string suffix = "_editada.bmp";
+    return name.size() > suffix.size() && toLower(name.substr(name.size() - suffix.size())) == suffix;
+}
+
+std::string joinPath(const std::string &dir, const std::string &name) {
+    if(dir.empty() || dir[dir.size()-1] == '/' || dir[dir.size()-1] == '\\') return dir + name;
+    return dir + "/" + name;
+}
+
+/**
+ * Adiciona à lista uma entrada da linha de comando: o próprio arquivo ou os arquivos de imagem de um diretório.
+ * @return false se a entrada não existir.
+ */
+bool addInput(const char *input, std::vector<std::string> &files) {
+    if(!isDirectory(input)) {
+        FILE *fp = fopen(input, "rb");
+        if(fp == NULL) return false;
+        fclose(fp);
+        files.push_back(input);
+        return true;
+    }
+
+    DIR *dir = opendir(input);
+    if(dir == NULL) return false;
+    std::vector<std::string> names;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL) {
+        std::string name(entry->d_name);
+        if(hasImageExtension(name) && !isPreviousOutput(name) && !isDirectory(joinPath(input, name))) names.push_back(name);
+    }
+    closedir(dir);
+
+    //ordem estável, independente do sistema de arquivos
+    std::sort(names.begin(), names.end());
+    for(size_t i=0; i<names.size(); i++) files.push_back(joinPath(input, names[i]));
+    return true;
+}
+
+/**
+ * Monta o nome do arquivo de saída a partir do nome de entrada.
+ * @param keepExtension Inclui a extensão da entrada no nome (x.qoi -> x_qoi), para distinguir x.bmp de x.qoi.
+ */
+std::string outputName(const std::string &fileName, const std::string &outputDir, bool keepExtension) {
+    size_t slash = fileName.find_last_of("/\\");
+    size_t dot = fileName.find_last_of('.');
+    bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    std::string stem = hasExtension ? fileName.substr(0, dot) : fileName;
+    if(hasExtension && keepExtension) stem += "_" + fileName.substr(dot + 1);
+
+    if(outputDir.empty()) return stem + "_editada.bmp";
+    std::string base = slash == std::string::npos ? stem : stem.substr(slash + 1);
+    return joinPath(outputDir, base + ".bmp");
+}
+
+/**
+ * Define a saída de cada arquivo, para que duas threads nunca gravem o mesmo arquivo ao mesmo tempo.
+ * Entradas repetidas são descartadas e as que resultariam no mesmo nome mantêm a extensão no nome.
+ * Os nomes são comparados sem diferenciar maiúsculas, como no sistema de arquivos do Windows.
+ * @return false se ainda restarem duas entradas com a mesma saída.
+ */
+bool assignOutputs(BatchJob &job) {
+    std::vector<std::string> files;
+    std::set<std::string> seen;
+    for(size_t i=0; i<job.files.size(); i++) {
+        if(seen.insert(job.files[i]).second) files.push_back(job.files[i]);
+    }
+    job.files.swap(files);
+
+    std::map<std::string, int> count;
+    for(size_t i=0; i<job.files.size(); i++) count[toLower(outputName(job.files[i], job.outputDir, false))]++;
+
+    bool unique = true;
+    std::map<std::string, size_t> owner;
+    job.outputs.clear();
+    for(size_t i=0; i<job.files.size(); i++) {
+        std::string output = outputName(job.files[i], job.outputDir, false);
+        if(count[toLower(output)] > 1) output = outputName(job.files[i], job.outputDir, true);
+
+        std::pair<std::map<std::string, size_t>::iterator, bool> inserted = owner.insert(std::make_pair(toLower(output), i));
+        if(!inserted.second) {
+            printf("Erro: %s e %s gravariam o mesmo arquivo %s\n", job.files[inserted.first->second].c_str(), job.files[i].c_str(), output.c_str());
+            unique = false;
+        }
+        job.outputs.push_back(output);
+    }
+    return unique;
+}
+
+/**
+ * Carrega, aplica o filtro (se houver) e os efeitos linha a linha e grava um arquivo.
+ * @return Bytes de pixels processados, ou -1 em caso de erro.
+ */
+long long processFile(const std::string &input, const std::string &output, BatchJob *job, BmpFilter &filter) {
+    const ImageEffects &effects = job->effects;
+    Bmp bmp(input.c_str());
+    if(bmp.getImage() == NULL) return -1;
+
+    int width = bmp.getWidth();
+    int height = bmp.getHeight();
+    int stride = width*3 + bmp.getRowPadding();
+    const unsigned char *pixels = bmp.getImage();
+
+    //os pixels do Bmp podem ser um arquivo de cache mapeado somente para leitura: o filtro grava em outro buffer
+    std::vector<unsigned char> filtered;
+    if(job->filtering) {
+        filtered.resize((size_t)stride*height);
+        if(!filter.apply(pixels, stride, &filtered[0], stride, width, height, job->filterPool)) return -1;
+        pixels = &filtered[0];
+    }
+
+    BmpWriter writer;
+    if(!writer.open(output.c_str(), width, height)) return -1;
+    for(int row=0; row<height; row++) {
+        effects.applyRow(pixels, width, height, stride, row, writer.getRowBuffer());
+        if(!writer.writeRow()) break;
+    }
+    if(!writer.close()) {
+        remove(output.c_str());
+        return -1;
+    }
+    return (long long)width*height*3;
+}
+
+/**
+ * Laço de cada thread: pega o próximo arquivo da lista até acabarem.
+ */
+void worker(BatchJob *job) {
+    BmpFilter filter = job->filter; //cada thread tem o próprio buffer do filtro
+    int index;
+    while((index = job->next++) < (int)job->files.size()) {
+        const std::string &input = job->files[index];
+        const std::string &output = job->outputs[index];
+        long long bytes = processFile(input, output, job, filter);
+
+        if(bytes < 0) {
+            job->failures++;
+            std::lock_guard<std::mutex> lock(job->printMutex);
+            printf("\nErro ao processar %s\n", input.c_str());
+        } else {
+            job->bytes += bytes;
+        }
+    }
+}
+
+/**
+ * Mede o filtro em um arquivo para cada raio, com o melhor de algumas repetições.
+ */
+int benchFilter(const char *fileName, int threads) {
+    Bmp::setVerbose(false);
+    Bmp bmp(fileName);
+    if(bmp.getImage() == NULL) {
+        printf("Erro ao carregar %s\n", fileName);
+        return 1;
+    }
+    int width = bmp.getWidth(), height = bmp.getHeight();
+    int stride = width*3 + bmp.getRowPadding();
+    double pixels = (double)width*height;
+    std::vector<unsigned char> out((size_t)stride*height);
+    ThreadPool pool(threads);
+
+    printf("%s: %dx%d, %d thread(s), convolucao %s\n", fileName, width, height, pool.getThreadCount(), BmpFilter::getImplementation());
+    printf("%5s %12s %12s %12s %12s\n", "raio", "desfoque ms", "ns/pixel", "nitidez ms", "ns/pixel");
+    for(int radius=1; radius<=FILTER_MAX_RADIUS; radius++) {
+        double best[2];
+        for(int mode=0; mode<2; mode++) {
+            BmpFilter filter;
+            if(mode == 0) filter.setGaussianBlur(radius);
+            else filter.setUnsharpMask(radius, 1);
+            best[mode] = 0;
+            for(int i=0; i<3; i++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                filter.apply(bmp.getImage(), stride, &out[0], stride, width, height, &pool);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if(i == 0 || ms < best[mode]) best[mode] = ms;
+            }
+        }
+        printf("%5d %12.1f %12.2f %12.1f %12.2f\n", radius, best[0], best[0]*1e6/pixels, best[1], best[1]*1e6/pixels);
+    }
+    return 0;
+}
+
+void printUsage() {
+    printf("Uso: batch [-o diretorio] [-j threads] [-c rgb] [-l] [-L brilho] [-fh] [-fv] [-B raio] [-S quantidade] [-U raio,quantidade] entrada1 [entrada2 ...]\n");
+    printf("     batch --bench-filtro [-j threads] arquivo\n");
+    printf("     batch -h\n");
+}
+
+int main(int argc, char **argv) {
+    BatchJob job;
+    int threads = std::thread::hardware_concurrency();
+    int first = 1;
+    bool benchMode = false;
+
+    for(; first<argc && argv[first][0] == '-'; first++) {
+        const char *option = argv[first];
+        bool hasValue = first+1 < argc;
+        if(strcmp(option, "-o") == 0 && hasValue) {
+            job.outputDir = argv[++first];
+        } else if(strcmp(option, "-j") == 0 && hasValue) {
+            threads = atoi(argv[++first]);
+        } else if(strcmp(option, "-c") == 0 && hasValue) {
+            const char *channels = argv[++first];
+            job.effects.rSelected = strchr(channels, 'r') != NULL;
+            job.effects.gSelected = strchr(channels, 'g') != NULL;
+            job.effects.bSelected = strchr(channels, 'b') != NULL;
+        } else if(strcmp(option, "-l") == 0) {
+            job.effects.lSelected = true;
+        } else if(strcmp(option, "-L") == 0 && hasValue) {
+            job.effects.lightness = -atof(argv[++first]); //o slider do editor usa o valor invertido
+        } else if(strcmp(option, "-fh") == 0) {
+            job.effects.flippedHorizontally = true;
+        } else if(strcmp(option, "-fv") == 0) {
+            job.effects.flippedVertically = true;
+        } else if(strcmp(option, "-B") == 0 && hasValue) {
+            job.filter.setGaussianBlur(atoi(argv[++first]));
+            job.filtering = true;
+        } else if(strcmp(option, "-S") == 0 && hasValue) {
+            job.filter.setSharpen(atof(argv[++first]));
+            job.filtering = true;
+        } else if(strcmp(option, "-U") == 0 && hasValue) {
+            int radius = 1;
+            float amount = 1;
+            sscanf(argv[++first], "%d,%f", &radius, &amount);
+            job.filter.setUnsharpMask(radius, amount);
+            job.filtering = true;
+        } else if(strcmp(option, "-h") == 0 || strcmp(option, "--help") == 0) {
+            printUsage();
+            return 0;
+        } else if(strcmp(option, "--bench-filtro") == 0) {
+            benchMode = true;
+        } else {
+            printf("Opcao invalida: %s\n", option);
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(first >= argc) {
+        printUsage();
+        return 1;
+    }
+    if(threads < 1) threads = 1;
+    if(benchMode) return benchFilter(argv[first], threads);
+    job.effects.prepare();
+
+    int failures = 0;
+    for(int i=first; i<argc; i++) {
+        if(!addInput(argv[i], job.files)) {
+            printf("Erro: entrada %s nao encontrada\n", argv[i]);
+            failures++;
+        }
+    }
+    if(!job.outputDir.empty() && !isDirectory(job.outputDir)) {
+        printf("Erro: diretorio de saida %s nao existe\n", job.outputDir.c_str());
+        return 1;
+    }
+    if(!assignOutputs(job)) return 1;
+    int requestedThreads = threads; //-j limita também as threads da decodificação e do filtro de cada arquivo
+    if(threads > (int)job.files.size() && !job.files.empty()) threads = job.files.size();
+    ThreadPool *filterPool = nullptr;
+    if(job.filtering && job.files.size() == 1) {
+        filterPool = new ThreadPool(requestedThreads);
+        job.filterPool = filterPool;
+    }
+
+    Bmp::setVerbose(false);
+    //com varios arquivos em paralelo, cada imagem e decodificada em uma unica thread, sem disputar os nucleos;
+    //com um unico arquivo, a decodificacao usa as threads pedidas em -j
+    Bmp::setDecodeThreads(threads > 1 ? 1 : requestedThreads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for(int i=0; i<threads; i++) workers.push_back(std::thread(worker, &job));
+    for(size_t i=0; i<workers.size(); i++) workers[i].join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    delete filterPool;
+    failures += job.failures;
+    int processed = job.files.size() - job.failures;
+    double megabytes = job.bytes/(1024.0*1024.0);
+
+    printf("%d arquivo(s) processado(s), %d falha(s), %d thread(s)\n", processed, failures, threads);
+    if(seconds > 0) {
+        printf("%.3f s, %.1f arquivos/s, %.1f MB/s\n", seconds, processed/seconds, megabytes/seconds);
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -8,23 +8,282 @@
 //**********************************************************
 
 #include "Bmp.h"
+#include "Qoi.h"
+#include "PixelAllocator.h"
+#include "BmpCache.h"
+#include "ThreadPool.h"
 #include <string.h>
 #include <iostream>
+#include <algorithm>
+#include <vector>
 
-Bmp::Bmp(const char *fileName) {
+#define DECODE_BAND_BYTES 65536 //tamanho aproximado de cada bloco de linhas lido e processado de uma vez
+
+#define PARALLEL_DECODE_MIN_BYTES   (8*1024*1024) //imagens menores sao decodificadas em uma unica thread
+#define PARALLEL_DECODE_BAND_BYTES  (256*1024)    //tamanho aproximado de cada faixa de linhas distribuida entre as threads
+
+std::atomic<unsigned int> Bmp::nextContentGeneration(0);
+bool Bmp::verbose = true;
+bool Bmp::cacheEnabled = false;
+int  Bmp::decodeThreads = 0;
+
+//tabela de normalizacao (0-255 para 0-1), preenchida antes de main para poder ser lida por varias threads
+static struct NormalizationTable {
+   float value[256];
+   NormalizationTable() {
+      for(int i=0; i<256; i++) value[i] = i/255.0;
+   }
+   float operator[](int i) const {
+      return value[i];
+   }
+} const normalizationTable;
+
+//formato das linhas de um BMP que nao esta em BGR 24 bits de baixo para cima: como converter cada linha para RGB
+struct BmpRowFormat {
+   int bits;
+   unsigned char expansion[256][24];  //1, 4 e 8 bits: pixels RGB de cada valor de byte (um ou mais indices na paleta)
+   bool standardMasks;                //32 bits com as mascaras 0xFF0000, 0xFF00 e 0xFF (BGRX)
+   unsigned int mask[3];              //32 bits: mascaras de R, G e B
+   int shift[3], maskBits[3];
+   unsigned char scale[3][256];       //32 bits: valor de cada mascara com ate 8 bits convertido para 0-255
+};
+
+//dimensoes que nao cabem no layout em memoria (int) tambem sao tratadas como cabecalho invalido
+static bool validDimensions(int width, int height) {
+   return width > 0 && height > 0 && (long long)(width + 1)*3*height <= 0x7fffffff;
+}
+
+//le a paleta (BGRX) que segue o INFOHEADER. Entradas ausentes no arquivo ficam pretas.
+static void readPalette(FILE *fp, long position, int entries, unsigned char palette[256][3]) {
+   unsigned char bgrx[256*4];
+   memset(palette, 0, 256*3);
+   fseek(fp, position, SEEK_SET);
+   int read = (int)fread(bgrx, 4, entries, fp);
+   for(int i=0; i<read; i++) {
+      palette[i][0] = bgrx[i*4 + 2];
+      palette[i][1] = bgrx[i*4 + 1];
+      palette[i][2] = bgrx[i*4];
+   }
+}
+
+//monta a tabela que expande cada byte de indices (8/bits pixels) diretamente para RGB
+static void setupPaletteFormat(BmpRowFormat *format, const unsigned char palette[256][3], int bits) {
+   int pixelsPerByte = 8 / bits;
+   int indexMask = (1 << bits) - 1;
+   format->bits = bits;
+   for(int value=0; value<256; value++) {
+      for(int k=0; k<pixelsPerByte; k++) {
+         int index = (value >> (8 - bits*(k + 1))) & indexMask; //o pixel mais a esquerda fica nos bits mais altos
+         memcpy(format->expansion[value] + k*3, palette[index], 3);
+      }
+   }
+}
+
+//calcula deslocamento e numero de bits de cada mascara, e a escala para 0-255 das mascaras com ate 8 bits.
+//Retorna false se alguma mascara nao for uma sequencia continua de bits.
+static bool setupMaskFormat(BmpRowFormat *format, const unsigned int mask[3]) {
+   format->bits = 32;
+   format->standardMasks = mask[0] == 0xFF0000 && mask[1] == 0xFF00 && mask[2] == 0xFF;
+   for(int c=0; c<3; c++) {
+      unsigned int m = mask[c];
+      int shift = 0, maskBits = 0;
+      while( m != 0 && (m & 1) == 0 ) { m >>= 1; shift++; }
+      while( (m & 1) != 0 ) { m >>= 1; maskBits++; }
+      if( m != 0 ) return false;
+      format->mask[c] = mask[c];
+      format->shift[c] = shift;
+      format->maskBits[c] = maskBits;
+      int maxValue = (1 << (maskBits < 8 ? maskBits : 8)) - 1;
+      for(int v=0; v<=maxValue; v++) {
+         format->scale[c][v] = maxValue > 0 ? (v*255 + maxValue/2)/maxValue : 0;
+      }
+   }
+   return true;
+}
+
+//expande uma linha de indices com PIXELS pixels por byte: uma copia de PIXELS*3 bytes da tabela por byte lido
+template<int PIXELS>
+static void expandRow(const unsigned char expansion[256][24], const unsigned char *src, unsigned char *dst, int width) {
+   int fullBytes = width / PIXELS;
+   for(int i=0; i<fullBytes; i++, dst+=PIXELS*3) {
+      memcpy(dst, expansion[src[i]], PIXELS*3);
+   }
+   int rest = width - fullBytes*PIXELS;
+   if( rest > 0 ) memcpy(dst, expansion[src[fullBytes]], rest*3);
+}
+
+//converte uma linha do arquivo para RGB
+static void convertRow(const BmpRowFormat *format, const unsigned char *src, unsigned char *dst, int width) {
+   switch( format->bits ) {
+   case 1:
+      expandRow<8>(format->expansion, src, dst, width);
+      break;
+   case 4:
+      expandRow<2>(format->expansion, src, dst, width);
+      break;
+   case 8:
+      expandRow<1>(format->expansion, src, dst, width);
+      break;
+   case 24:
+      for(int x=0; x<width; x++, src+=3, dst+=3) {
+         dst[0] = src[2];
+         dst[1] = src[1];
+         dst[2] = src[0];
+      }
+      break;
+   case 32:
+      if( format->standardMasks ) {
+         for(int x=0; x<width; x++, src+=4, dst+=3) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+         }
+         break;
+      }
+      for(int x=0; x<width; x++, src+=4, dst+=3) {
+         unsigned int pixel = src[0] | (src[1] << 8) | (src[2] << 16) | ((unsigned int)src[3] << 24);
+         for(int c=0; c<3; c++) {
+            unsigned int value = (pixel & format->mask[c]) >> format->shift[c];
+            dst[c] = format->maskBits[c] > 8 ? value >> (format->maskBits[c] - 8) : format->scale[c][value];
+         }
+      }
+      break;
+   }
+}
+
+//decodifica um bloco RLE8 ou RLE4 para um indice por pixel (linhas de baixo para cima, sem alinhamento).
+//Sequencias repetidas sao gravadas com memset. Pixels pulados (deslocamento ou fim de linha antecipado) ficam com indice 0.
+//Retorna false se os dados acabarem antes do marcador de fim da imagem.
+static bool expandRle(const unsigned char *src, long size, unsigned char *indices, int width, int height, bool rle4) {
+   const unsigned char *end = src + size;
+   int x = 0, y = 0;
+   while( y < height && end - src >= 2 ) {
+      int count = src[0], value = src[1];
+      src += 2;
+      unsigned char *row = indices + (long long)y*width;
+      int room = x < width ? width - x : 0;
+
+      if( count > 0 ) {                    //sequencia de count pixels
+         int n = count < room ? count : room;
+         if( !rle4 || (value >> 4) == (value & 15) ) {
+            memset(row + x, rle4 ? value & 15 : value, n);
+         } else {
+            for(int i=0; i<n; i++) row[x + i] = (i & 1) ? value & 15 : value >> 4;
+         }
+         x += count;
+      } else if( value == 0 ) {            //fim de linha
+         x = 0;
+         y++;
+      } else if( value == 1 ) {            //fim da imagem
+         return true;
+      } else if( value == 2 ) {            //deslocamento
+         if( end - src < 2 ) return false;
+         x += src[0];
+         y += src[1];
+         src += 2;
+      } else {                             //modo absoluto: value indices literais, alinhados em 2 bytes
+         int bytes = rle4 ? (value + 1)/2 : value;
+         int padded = (bytes + 1) & ~1;
+         if( end - src < padded ) return false;
+         int n = value < room ? value : room;
+         if( rle4 ) {
+            for(int i=0; i<n; i++) row[x + i] = (i & 1) ? src[i/2] & 15 : src[i/2] >> 4;
+         } else {
+            memcpy(row + x, src, n);
+         }
+         x += value;
+         src += padded;
+      }
+   }
+   return y >= height;
+}
+
+
+Bmp::Bmp(const char *_fileName) {
    width = height = 0;
    data = NULL;
-   if( fileName != NULL && strlen(fileName) > 0 ) {
-      load(fileName);
+   cacheFile = NULL;
+   mipData = NULL;
+   mipBase = NULL;
+   mipCount = 0;
+   fileName = NULL;
+   qoi = decoded = topDown = false;
+   error = BMP_OK;
+   contentGeneration = ++nextContentGeneration;
+   memset(&stats, 0, sizeof(stats));
+   if( _fileName != NULL && strlen(_fileName) > 0 ) {
+      fileName = new char[strlen(_fileName) + 1];
+      strcpy(fileName, _fileName);
+      probe();
    } else {
       printf("Error: Invalid BMP filename");
+      error = BMP_ERROR_OPEN;
    }
 }
 
+Bmp::~Bmp() {
+   releaseBuffers();
+   delete[] fileName;
+}
+
+//buffers de pixels alinhados (PixelAllocator), para permitir acesso SIMD alinhado
+bool Bmp::allocateBuffers() {
+   data = PixelAllocator::allocateArray<unsigned char>(imagesize);
+   if( data == NULL ) {
+      releaseBuffers();
+      width = height = 0;
+      return false;
+   }
+   return true;
+}
+
+void Bmp::releaseBuffers() {
+   if( cacheFile != NULL ) {
+      delete cacheFile; //desfaz o mapeamento
+      cacheFile = NULL;
+   } else {
+      PixelAllocator::release(data);
+   }
+   PixelAllocator::release(mipData);
+   data = NULL;
+   mipData = NULL;
+   mipBase = NULL;
+   mipCount = 0;
+}
+
 uchar* Bmp::getImage() {
+  decode();
   return data;
 }
 
+bool Bmp::isDecoded() {
+  return decoded;
+}
+
+unsigned int Bmp::getContentGeneration() {
+  return contentGeneration;
+}
+
+bool Bmp::isValid() {
+  return error == BMP_OK;
+}
+
+int Bmp::getError() {
+  return error;
+}
+
+const char* Bmp::getErrorMessage(int error) {
+  switch( error ) {
+  case BMP_OK:                return "sem erro";
+  case BMP_ERROR_OPEN:        return "erro ao abrir arquivo para leitura";
+  case BMP_ERROR_HEADER:      return "arquivo invalido";
+  case BMP_ERROR_UNSUPPORTED: return "formato nao suportado";
+  case BMP_ERROR_DATA:        return "bloco de pixels invalido";
+  case BMP_ERROR_MEMORY:      return "memoria insuficiente";
+  }
+  return "erro desconhecido";
+}
+
 int Bmp::getWidth(void) {
   return width;
 }
@@ -35,7 +294,7 @@ int Bmp::getHeight(void) {
 
 void Bmp::convertBGRtoRGB() {
   unsigned char tmp;
-  if( data != NULL ) {
+  if( data != NULL && cacheFile == NULL ) { //o cache e mapeado somente para leitura
      for(int y=0; y<height; y++)
      for(int x=0; x<width*3; x+=3) {
         int pos = y*bytesPerLine + x;
@@ -46,16 +305,148 @@ void Bmp::convertBGRtoRGB() {
   }
 }
 
+//registra o erro e imprime a mensagem. Nunca espera entrada do usuario: quem chamou verifica isValid()/getError().
+void Bmp::setError(int code) {
+  error = code;
+  if( code == BMP_ERROR_UNSUPPORTED && !qoi ) {
+     printf("\nError: Arquivo %s: %s (%d bits/pixel, compressao %d)", fileName, getErrorMessage(code), bits, info.compression);
+  } else {
+     printf("\nError: Arquivo %s: %s", fileName, getErrorMessage(code));
+  }
+}
+
 
-void Bmp::load(const char *fileName) {
+//le apenas o cabecalho (54 bytes no BMP, 14 no QOI) para obter o formato e as dimensoes, sem tocar nos pixels.
+//O formato e escolhido pela assinatura do arquivo ("BM" para BMP, "qoif" para QOI).
+void Bmp::probe() {
   FILE *fp = fopen(fileName, "rb");
   if( fp == NULL ) {
-     printf("\nErro ao abrir arquivo %s para leitura", fileName);
+     setError(BMP_ERROR_OPEN);
      return;
   }
 
-  printf("\n\nCarregando arquivo %s", fileName);
+  unsigned char magic[QOI_HEADER_SIZE];
+  memset(magic, 0, sizeof(magic));
+  fread(magic, sizeof(unsigned char), QOI_HEADER_SIZE, fp);
+  fseek(fp, 0, SEEK_SET);
+
+  int result = BMP_OK;
+  qoi = Qoi::isQoi(magic);
+  if( qoi ) {
+     QOIHEADER qoiHeader;
+     if( Qoi::readHeader(magic, &qoiHeader) && validDimensions(qoiHeader.width, qoiHeader.height) ) {
+        width  = qoiHeader.width;
+        height = qoiHeader.height;
+        bits   = 24;
+     } else {
+        result = BMP_ERROR_HEADER;
+     }
+  } else {
+     result = readBmpHeader(fp);
+  }
+  fclose(fp);
+
+  if( result != BMP_OK ) {
+     setError(result);
+     width = height = 0;
+  }
+  setupLayout();
+}
+
+//decodifica os pixels no primeiro uso. Apos uma falha, nao tenta novamente.
+bool Bmp::decode() {
+  if( decoded ) return true;
+  if( error != BMP_OK ) return false;
+
+  if( cacheEnabled && loadCache() ) {
+     decoded = true;
+     contentGeneration = ++nextContentGeneration;
+     return true;
+  }
+
+  FILE *fp = fopen(fileName, "rb");
+  if( fp == NULL ) {
+     setError(BMP_ERROR_OPEN);
+     width = height = 0;
+     return false;
+  }
+
+  if( verbose ) printf("\n\nCarregando arquivo %s", fileName);
+
+  int result = qoi ? loadQoi(fp) : loadBmp(fp);
+  fclose(fp);
+
+  if( result != BMP_OK ) {
+     setError(result);
+     releaseBuffers();
+     width = height = 0;
+     return false;
+  }
+  decoded = true;
+  contentGeneration = ++nextContentGeneration;
+
+  if( cacheEnabled ) {
+     buildMips();
+     if( !BmpCache::write(fileName, data, width, height, bytesPerLine, &stats, mipData, mips, mipCount) ) {
+        printf("\nAviso: nao foi possivel gravar o cache de %s", fileName);
+     }
+  }
+  return decoded;
+}
+
+//mapeia o cache da imagem, se existir e corresponder ao arquivo atual. Nenhum pixel e processado.
+bool Bmp::loadCache() {
+  const CACHEHEADER *cache;
+  MappedFile *file = BmpCache::open(fileName, &cache);
+  if( file == NULL ) return false;
+
+  if( cache->width != width || cache->height != height || cache->mips[0].stride != bytesPerLine ) {
+     delete file;
+     return false;
+  }
+
+  if( verbose ) printf("\n\nCarregando arquivo %s do cache", fileName);
+  cacheFile = file;
+  data = (unsigned char*)file->getData() + cache->mips[0].offset; //somente leitura
+  stats = cache->stats;
+  mipCount = cache->mipCount;
+  mipBase = file->getData();
+  memcpy(mips, cache->mips, sizeof(MIPLEVEL)*mipCount);
+  return true;
+}
+
+//gera os niveis de mipmap em memoria a partir da imagem decodificada
+void Bmp::buildMips() {
+  if( mipCount > 0 || data == NULL ) return;
+
+  long long bytes;
+  mips[0].width = width;
+  mips[0].height = height;
+  mips[0].stride = bytesPerLine;
+  mips[0].offset = 0;
+  int count = BmpCache::layoutMips(mips, &bytes);
+
+  if( count > 1 ) {
+     mipData = PixelAllocator::allocateArray<unsigned char>(bytes);
+     if( mipData == NULL ) return;
+     for(int i=1; i<count; i++) {
+        const unsigned char *src = i == 1 ? data : mipData + mips[i-1].offset;
+        BmpCache::downsample(src, &mips[i-1], mipData + mips[i].offset, &mips[i]);
+     }
+  }
+  mipBase = mipData;
+  mipCount = count;
+}
+
+//calcula o layout das linhas na memoria: RGB, 3 bytes por pixel, linhas alinhadas em 4 bytes, de baixo para cima.
+void Bmp::setupLayout() {
+  bytesPerLine =(3 * (width + 1) / 4) * 4;
+  imagesize    = bytesPerLine*height;
+  rowPadding = (4 - (width * 3) % 4) % 4; // Calcula o preenchimento necessário para garantir múltiplos de 4 bytes por linha
+}
 
+//le o HEADER e o INFOHEADER e verifica se o formato e suportado. Retorna BMP_OK ou o codigo do erro.
+int Bmp::readBmpHeader(FILE *fp) {
   //le o HEADER componente a componente devido ao problema de alinhamento de bytes. Usando
   //o comando fread(header, sizeof(HEADER),1,fp) sao lidos 16 bytes ao inves de 14
   fread(&header.type,      sizeof(unsigned short int), 1, fp);
@@ -75,81 +466,437 @@ void Bmp::load(const char *fileName) {
   fread(&info.xresolution, sizeof(int),                1, fp);
   fread(&info.yresolution, sizeof(int),                1, fp);
   fread(&info.ncolours,    sizeof(unsigned int),       1, fp);
-  fread(&info.impcolours,  sizeof(unsigned int),       1, fp);
+  if( fread(&info.impcolours,  sizeof(unsigned int),  1, fp) != 1 ) return BMP_ERROR_HEADER;
+  if( header.type != 19778 || info.height < -0x7fffffff ) return BMP_ERROR_HEADER;
 
+  //altura negativa: linhas gravadas de cima para baixo
+  topDown = info.height < 0;
   width  = info.width;
-  height = info.height;
+  height = topDown ? -info.height : info.height;
   bits   = info.bits;
-  bytesPerLine =(3 * (width + 1) / 4) * 4;
-  imagesize    = bytesPerLine*height;
-  int delta    = bytesPerLine - (3 * width);
-  rowPadding = (4 - (width * 3) % 4) % 4; // Calcula o preenchimento necessrio para garantir mltiplos de 4 bytes por linha
+  if( !validDimensions(width, height) ) return BMP_ERROR_HEADER;
+
+  //cabecalhos menores (OS/2) tem outro layout; os maiores (V4, V5) comecam com os mesmos campos
+  if( info.size < INFOHEADER_SIZE || info.planes != 1 ) return BMP_ERROR_UNSUPPORTED;
 
-  //realiza diversas verificacoes de erro e compatibilidade
-  if( header.type != 19778 ){
-     printf("\nError: Arquivo BMP invalido");
-     getchar();
-     exit(0);
+  bool supported;
+  switch( info.compression ) {
+  case BMP_RGB:       supported = bits == 1 || bits == 4 || bits == 8 || bits == 24 || bits == 32; break;
+  case BMP_RLE8:      supported = bits == 8 && !topDown; break;
+  case BMP_RLE4:      supported = bits == 4 && !topDown; break;
+  case BMP_BITFIELDS: supported = bits == 32; break;
+  default:            supported = false;
   }
+  return supported ? BMP_OK : BMP_ERROR_UNSUPPORTED;
+}
 
-  /*if( width*height*3 != imagesize ){
-     printf("\nWarning: Arquivo BMP nao tem largura multipla de 4");
-     getchar();
-  }*/
+//Carrega os pixels de um BMP para o layout em memoria (RGB, linhas de baixo para cima, alinhadas em 4 bytes).
+//24 bits de baixo para cima sao convertidos no proprio buffer; os demais formatos passam por um BmpRowFormat.
+int Bmp::loadBmp(FILE *fp) {
+  int result = readBmpHeader(fp); //o arquivo pode ter mudado desde probe()
+  if( result != BMP_OK ) return result;
+  setupLayout();
 
-  if( info.compression != 0 ) {
-     printf("\nError: Formato BMP comprimido nao suportado");
-     getchar();
-     return;
+  BmpRowFormat format;
+  bool rle = info.compression == BMP_RLE8 || info.compression == BMP_RLE4;
+  if( bits <= 8 ) {
+     int entries = 1 << bits;
+     if( info.ncolours > 0 && info.ncolours < (unsigned int)entries ) entries = info.ncolours;
+     unsigned char palette[256][3];
+     readPalette(fp, HEADER_SIZE + info.size, entries, palette);
+     //o RLE e expandido para um indice por byte antes de passar pela paleta
+     setupPaletteFormat(&format, palette, rle ? 8 : bits);
+  } else if( bits == 32 ) {
+     unsigned int mask[3] = {0xFF0000, 0xFF00, 0xFF};
+     if( info.compression == BMP_BITFIELDS ) {
+        //mascaras R, G, B logo apos os 40 bytes do INFOHEADER (dentro do cabecalho nas versoes V4 e V5)
+        fseek(fp, HEADER_SIZE + INFOHEADER_SIZE, SEEK_SET);
+        if( fread(mask, sizeof(unsigned int), 3, fp) != 3 ) return BMP_ERROR_HEADER;
+     }
+     if( !setupMaskFormat(&format, mask) ) return BMP_ERROR_HEADER;
+  } else {
+     format.bits = 24;
   }
 
-  if( bits != 24 ) {
-     printf("\nError: Formato BMP com %d bits/pixel nao suportado", bits);
-     getchar();
-     return;
+  //um arquivo sem compressao truncado no fim ainda e carregado (as linhas que faltam ficam pretas), mas dimensoes que o arquivo
+  //esta longe de conter sao rejeitadas antes de alocar a imagem: um cabecalho corrompido nao aloca centenas de MB para um arquivo de 1 KB
+  long long fileStride = ((long long)width*bits + 31)/32*4;
+  if( !rle ) {
+     fseek(fp, 0, SEEK_END);
+     long long available = (long long)ftell(fp) - header.offset;
+     if( available < fileStride*height/2 ) return BMP_ERROR_DATA;
   }
 
-  if( info.planes != 1 ) {
-     printf("\nError: Numero de Planes nao suportado: %d", info.planes);
-     getchar();
-     return;
+  if( !allocateBuffers() ) return BMP_ERROR_MEMORY;
+
+  //imagens grandes: o arquivo e mapeado e as faixas de linhas sao convertidas em paralelo diretamente do mapeamento.
+  //Arquivos incompletos seguem pela leitura sequencial, que completa as linhas que faltam.
+  if( !rle && imagesize >= PARALLEL_DECODE_MIN_BYTES && getDecodePool() != NULL ) {
+     MappedFile source;
+     if( source.open(fileName) && header.offset + fileStride*height <= source.getSize() ) {
+        convertRows(source.getData() + header.offset, fileStride, &format, topDown);
+        return BMP_OK;
+     }
   }
 
-  data = new unsigned char[imagesize];
   fseek(fp, header.offset, SEEK_SET);
-  fread(data, sizeof(unsigned char), imagesize, fp);
-  fclose(fp);
+  if( rle ) return decodeRle(fp, &format);
+  decodeRows(fp, bits == 24 && !topDown ? NULL : &format);
+  return BMP_OK;
+}
+
+/**
+* Carrega um arquivo QOI para o mesmo formato em memória do BMP (RGB, linhas de baixo para cima, alinhadas em 4 bytes).
+* O arquivo comprimido é lido de uma vez; cada linha é decodificada e processada (conversão e estatísticas) logo em seguida.
+* @return BMP_OK ou o código do erro.
+*/
+int Bmp::loadQoi(FILE *fp) {
+  fseek(fp, 0, SEEK_END);
+  long fileSize = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if( fileSize < QOI_HEADER_SIZE + QOI_END_SIZE ) return BMP_ERROR_HEADER;
+
+  unsigned char *bytes = new unsigned char[fileSize];
+  QOIHEADER qoiHeader;
+  if( (long)fread(bytes, sizeof(unsigned char), fileSize, fp) != fileSize || !Qoi::readHeader(bytes, &qoiHeader) ||
+      !validDimensions(qoiHeader.width, qoiHeader.height) ) {
+     delete[] bytes;
+     return BMP_ERROR_HEADER;
+  }
+
+  width  = qoiHeader.width;
+  height = qoiHeader.height;
+  bits   = 24;
+  setupLayout();
+
+  if( !allocateBuffers() ) {
+     delete[] bytes;
+     return BMP_ERROR_MEMORY;
+  }
+
+  long long sum[3] = {0, 0, 0};
+  beginStats();
+  QoiDecoder decoder(bytes + QOI_HEADER_SIZE, fileSize - QOI_HEADER_SIZE);
+  bool complete = true;
+  for(int row=height-1; row>=0; row--) {
+     unsigned char *line = data + row*bytesPerLine;
+     complete = decoder.decodePixels(line, width, 3) && complete;
+     memset(line + width*3, 0, rowPadding);
+     processRows(row, row+1, sum, false, &stats);
+  }
+  endStats(sum);
+  if( !complete ) printf("\nWarning: Arquivo QOI incompleto");
+
+  delete[] bytes;
+  return BMP_OK;
+}
+
+/**
+* Lê o bloco de pixels em faixas de linhas e processa cada faixa logo após a leitura, enquanto ainda está na cache.
+* Cada pixel é visitado uma única vez para: converter de BGR para RGB, montar os histogramas de R, G, B e luminância
+* e calcular mínimo, máximo e média por canal.
+* @param format NULL para BGR 24 bits de baixo para cima, lido e convertido no próprio buffer. Nos demais formatos, cada faixa
+*        é lida para um buffer temporário e convertida para a posição final da linha (invertida se o arquivo for de cima para baixo).
+*/
+void Bmp::decodeRows(FILE *fp, const BmpRowFormat *format) {
+    long long sum[3] = {0, 0, 0};
+    beginStats();
+
+    if(format == NULL) {
+        int bandRows = DECODE_BAND_BYTES / bytesPerLine;
+        if(bandRows < 1) bandRows = 1;
+        for(int row=0; row<height; row+=bandRows) {
+            int lastRow = row + bandRows < height ? row + bandRows : height;
+            int bandBytes = (lastRow - row)*bytesPerLine;
+            int read = (int)fread(data + row*bytesPerLine, sizeof(unsigned char), bandBytes, fp);
+            if(read < bandBytes) {
+                printf("\nWarning: Arquivo BMP incompleto");
+                memset(data + row*bytesPerLine + read, 0, imagesize - row*bytesPerLine - read);
+                processRows(row, height, sum, true, &stats);
+                break;
+            }
+            processRows(row, lastRow, sum, true, &stats);
+        }
+        endStats(sum);
+        return;
+    }
 
-  preProcessData();
+    long long fileStride = ((long long)width*format->bits + 31)/32*4;
+    int bandRows = (int)(DECODE_BAND_BYTES / fileStride);
+    if(bandRows < 1) bandRows = 1;
+    unsigned char *band = new unsigned char[bandRows*fileStride];
+
+    for(int row=0; row<height; row+=bandRows) {
+        int rows = row + bandRows < height ? bandRows : height - row;
+        int read = (int)fread(band, fileStride, rows, fp);
+        for(int i=0; i<read; i++) {
+            unsigned char *line = data + (topDown ? height - 1 - (row + i) : row + i)*bytesPerLine;
+            convertRow(format, band + i*fileStride, line, width);
+            memset(line + width*3, 0, rowPadding);
+        }
+        bool truncated = read < rows;
+        if(truncated) {
+            //linhas que faltam no arquivo ficam pretas
+            printf("\nWarning: Arquivo BMP incompleto");
+            for(int i=row + read; i<height; i++) {
+                memset(data + (topDown ? height - 1 - i : i)*bytesPerLine, 0, bytesPerLine);
+            }
+            read = height - row;
+        }
+        //linhas convertidas nesta faixa, na ordem da memoria
+        int first = topDown ? height - row - read : row;
+        processRows(first, first + read, sum, false, &stats);
+        if(truncated) break; //todas as linhas restantes ja foram zeradas e processadas
+    }
+    endStats(sum);
+    delete[] band;
 }
 
 /**
-* Pr-processa os dados da bitmap, realizando a diviso por 255 para a canvas renderizar e evitar realizar esse clculo a cada frame.
+* Decodifica um bloco RLE8 ou RLE4: o arquivo comprimido é lido de uma vez e expandido para um índice por pixel
+* (sequências com memset), depois cada linha passa pela paleta.
+* @return BMP_OK ou BMP_ERROR_MEMORY. Dados que terminam antes do fim da imagem geram apenas um aviso.
 */
-void Bmp::preProcessData() {
-    convertBGRtoRGB();
-    normalizedData = new float[imagesize];
-    for(int i=0; i<imagesize; i++) {
-        normalizedData[i] = data[i]/255.0;
+int Bmp::decodeRle(FILE *fp, const BmpRowFormat *format) {
+    long start = ftell(fp);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp) - start;
+    fseek(fp, start, SEEK_SET);
+    if(size < 0) size = 0;
+
+    unsigned char *bytes = new unsigned char[size + 1];
+    unsigned char *indices = PixelAllocator::allocateArray<unsigned char>((long long)width*height);
+    if(indices == NULL) {
+        delete[] bytes;
+        return BMP_ERROR_MEMORY;
     }
+    size = (long)fread(bytes, sizeof(unsigned char), size, fp);
+    memset(indices, 0, (size_t)width*height);
+    if(!expandRle(bytes, size, indices, width, height, info.compression == BMP_RLE4)) {
+        printf("\nWarning: Arquivo BMP incompleto");
+    }
+    delete[] bytes;
+
+    convertRows(indices, width, format, false);
+    PixelAllocator::release(indices);
+    return BMP_OK;
 }
 
 /**
-* Pr-processa os dados da bitmap, realizando a diviso por 255 para a canvas renderizar e evitar realizar esse clculo a cada frame.
-* @return Ponteiro para o array com os dados normalizados.
+* Converte para data todas as linhas de um bloco de pixels já em memória (arquivo mapeado ou índices do RLE) e calcula as estatísticas.
+* Imagens com pelo menos PARALLEL_DECODE_MIN_BYTES são divididas em faixas de linhas processadas pelo ThreadPool de decodificação;
+* cada thread acumula histogramas e somas próprios, somados no final.
+* @param stride Bytes por linha em pixels.
+* @param flip Se true, a primeira linha de pixels é a de cima da imagem.
 */
-float* Bmp::getProcessedData() {
-    return normalizedData;
+void Bmp::convertRows(const unsigned char *pixels, long long stride, const BmpRowFormat *format, bool flip) {
+    ThreadPool *pool = imagesize >= PARALLEL_DECODE_MIN_BYTES ? getDecodePool() : NULL;
+    int threads = pool != NULL ? pool->getThreadCount() : 1;
+    int bandRows = PARALLEL_DECODE_BAND_BYTES / bytesPerLine;
+    if(bandRows < 1) bandRows = 1;
+
+    beginStats();
+    std::vector<IMAGESTATS> partial(threads, stats);
+    std::vector<long long> sums(threads*3, 0);
+
+    std::function<void(int, int, int)> band = [&](int first, int last, int thread) {
+        for(int row=first; row<last; row++) {
+            unsigned char *line = data + (flip ? height - 1 - row : row)*bytesPerLine;
+            convertRow(format, pixels + row*stride, line, width);
+            memset(line + width*3, 0, rowPadding);
+        }
+        //soma local: as somas das threads ficam lado a lado e seriam disputadas na mesma linha de cache
+        long long bandSum[3] = {0, 0, 0};
+        int firstLine = flip ? height - last : first;
+        processRows(firstLine, firstLine + last - first, bandSum, false, &partial[thread]);
+        for(int c=0; c<3; c++) sums[thread*3 + c] += bandSum[c];
+    };
+
+    if(pool != NULL) {
+        pool->parallelFor(height, bandRows, band);
+    } else {
+        for(int row=0; row<height; row+=bandRows) band(row, row + bandRows < height ? row + bandRows : height, 0);
+    }
+
+    long long sum[3] = {0, 0, 0};
+    for(int t=0; t<threads; t++) {
+        for(int channel=0; channel<4; channel++) {
+            for(int i=0; i<HISTOGRAM_SIZE; i++) stats.histogram[channel][i] += partial[t].histogram[channel][i];
+        }
+        for(int c=0; c<3; c++) {
+            if(partial[t].min[c] < stats.min[c]) stats.min[c] = partial[t].min[c];
+            if(partial[t].max[c] > stats.max[c]) stats.max[c] = partial[t].max[c];
+            sum[c] += sums[t*3 + c];
+        }
+    }
+    endStats(sum);
+}
+
+/**
+* Conjunto de threads da decodificação, criado no primeiro uso com setDecodeThreads threads.
+* @return NULL se a decodificação paralela estiver desabilitada ou houver apenas um núcleo.
+*/
+ThreadPool* Bmp::getDecodePool() {
+    if(decodeThreads == 1) return NULL;
+    static ThreadPool pool(decodeThreads);
+    return pool.getThreadCount() > 1 ? &pool : NULL;
+}
+
+/**
+* Zera os histogramas e estatísticas antes de uma nova decodificação.
+*/
+void Bmp::beginStats() {
+    memset(&stats, 0, sizeof(stats));
+    for(int c=0; c<3; c++) stats.min[c] = 255;
+}
+
+/**
+* Calcula as médias por canal a partir das somas acumuladas em processRows.
+*/
+void Bmp::endStats(long long sum[3]) {
+    int pixels = width*height;
+    for(int c=0; c<3; c++) {
+        stats.mean[c] = pixels > 0 ? (float)sum[c]/pixels : 0;
+    }
+}
+
+/**
+* Processa as linhas [firstRow, lastRow) já lidas para data.
+* A luminância usa a mesma fórmula de Image::getLuminance e é agrupada em valores inteiros.
+* @param sum Acumuladores da soma de cada canal, para o cálculo da média.
+* @param bgr Se true, as linhas estão em BGR (como no arquivo BMP) e são convertidas para RGB.
+* @param target Histogramas e mínimos/máximos a atualizar (parciais de uma thread, na decodificação paralela).
+*/
+void Bmp::processRows(int firstRow, int lastRow, long long sum[3], bool bgr, IMAGESTATS *target) {
+    for(int row=firstRow; row<lastRow; row++) {
+        unsigned char *pixel = data + row*bytesPerLine;
+
+        for(int x=0; x<width; x++, pixel+=3) {
+            unsigned char r, g = pixel[1], b;
+            if(bgr) {
+                r = pixel[2];
+                b = pixel[0];
+                pixel[0] = r;
+                pixel[2] = b;
+            } else {
+                r = pixel[0];
+                b = pixel[2];
+            }
+
+            target->histogram[CHANNEL_R][r]++;
+            target->histogram[CHANNEL_G][g]++;
+            target->histogram[CHANNEL_B][b]++;
+            target->histogram[CHANNEL_L][(int)(r*0.229 + g*0.587 + b*0.114)]++;
+
+            if(r < target->min[CHANNEL_R]) target->min[CHANNEL_R] = r;
+            if(r > target->max[CHANNEL_R]) target->max[CHANNEL_R] = r;
+            if(g < target->min[CHANNEL_G]) target->min[CHANNEL_G] = g;
+            if(g > target->max[CHANNEL_G]) target->max[CHANNEL_G] = g;
+            if(b < target->min[CHANNEL_B]) target->min[CHANNEL_B] = b;
+            if(b > target->max[CHANNEL_B]) target->max[CHANNEL_B] = b;
+            sum[CHANNEL_R] += r;
+            sum[CHANNEL_G] += g;
+            sum[CHANNEL_B] += b;
+        }
+    }
+}
+
+/**
+* Tabela com a divisão por 255 de cada valor de canal, para a canvas renderizar sem refazer esse cálculo a cada frame.
+* Substitui a cópia normalizada da imagem (4 bytes por canal), que não pode ser mapeada do cache.
+* @return Ponteiro para a tabela de 256 valores.
+*/
+const float* Bmp::getNormalizationTable() {
+    return normalizationTable.value;
 }
 
 /**
  * Retorna o preenchimento de linha (padding) da imagem BMP carregada.
  *
- * O preenchimento de linha refere-se ao nmero de bytes adicionais adicionados ao final de cada linha de dados de pixel
- * para garantir que o comprimento de cada linha seja um mltiplo de 4 bytes.
+ * O preenchimento de linha refere-se ao número de bytes adicionais adicionados ao final de cada linha de dados de pixel
+ * para garantir que o comprimento de cada linha seja um múltiplo de 4 bytes.
  *
  * @return O valor do preenchimento de linha (padding) em bytes.
  */
 int Bmp::getRowPadding() {
     return rowPadding;
 }
+
+/**
+ * Retorna os histogramas e as estatísticas por canal calculados no carregamento.
+ * Os histogramas são da imagem original, sem efeitos (canais, brilho) aplicados.
+ *
+ * @return Ponteiro para as estatísticas da imagem.
+ */
+const IMAGESTATS* Bmp::getStats() {
+    decode();
+    return &stats;
+}
+
+bool Bmp::isCached() {
+    return cacheFile != NULL;
+}
+
+const uchar* Bmp::getMipLevel(int level, int *mipWidth, int *mipHeight, int *stride) {
+    if( !decode() ) return NULL;
+    buildMips();
+    if( level < 0 || level >= mipCount ) return NULL;
+
+    *mipWidth = mips[level].width;
+    *mipHeight = mips[level].height;
+    *stride = mips[level].stride;
+    return level == 0 ? data : mipBase + mips[level].offset;
+}
+
+int Bmp::getMipCount() {
+    buildMips();
+    return mipCount;
+}
+
+void Bmp::setCacheEnabled(bool enable) {
+    cacheEnabled = enable;
+}
+
+void Bmp::setDecodeThreads(int threads) {
+    decodeThreads = threads;
+}
+
+const char* Bmp::getFileName() {
+    return fileName;
+}
+
+/**
+ * Troca o conteúdo decodificado com outro Bmp. Quem referencia este objeto passa a ver a nova imagem, sem cópia dos pixels.
+ * @param other Bmp com o novo conteúdo; recebe o conteúdo antigo.
+ */
+void Bmp::swapContents(Bmp *other) {
+    std::swap(width, other->width);
+    std::swap(height, other->height);
+    std::swap(imagesize, other->imagesize);
+    std::swap(bytesPerLine, other->bytesPerLine);
+    std::swap(bits, other->bits);
+    std::swap(rowPadding, other->rowPadding);
+    std::swap(data, other->data);
+    std::swap(cacheFile, other->cacheFile);
+    std::swap(mipData, other->mipData);
+    std::swap(mipBase, other->mipBase);
+    std::swap(mips, other->mips);
+    std::swap(mipCount, other->mipCount);
+    std::swap(header, other->header);
+    std::swap(info, other->info);
+    std::swap(stats, other->stats);
+    std::swap(qoi, other->qoi);
+    std::swap(decoded, other->decoded);
+    std::swap(error, other->error);
+    std::swap(topDown, other->topDown);
+    other->contentGeneration = contentGeneration;
+    contentGeneration = ++nextContentGeneration;
+}
+
+/**
+ * Habilita ou desabilita as mensagens de carregamento de arquivo (útil em ferramentas de linha de comando e benchmarks).
+ * @param enable true para exibir as mensagens.
+ */
+void Bmp::setVerbose(bool enable) {
+    verbose = enable;
+}
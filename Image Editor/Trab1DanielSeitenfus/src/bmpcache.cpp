@@ -0,0 +1,302 @@
+//*********************************************************
+//
+// cache em disco das imagens decodificadas (ver BmpCache.h)
+//
+//**********************************************************
+
+#include "BmpCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define HASH_SAMPLES       64     //blocos espalhados pelo arquivo
+#define HASH_SAMPLE_BYTES  256
+#define HASH_EDGE_BYTES    4096   //inicio e fim do arquivo (cabecalho e ultimas linhas)
+
+static const char cacheMagic[4] = {'P', 'X', 'C', '1'};
+
+static long long alignUp(long long value, long long alignment) {
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+//FNV-1a de 64 bits
+static unsigned long long hashBytes(unsigned long long hash, const unsigned char *bytes, size_t count) {
+   for(size_t i=0; i<count; i++) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+
+//posiciona com offset de 64 bits: long tem 32 bits no Windows, mesmo em 64 bits
+static int seekTo(FILE *fp, long long offset) {
+#ifdef _WIN32
+   return _fseeki64(fp, offset, SEEK_SET);
+#else
+   return fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+}
+
+//tamanho e data de modificacao com resolucao abaixo do segundo (ns no POSIX, unidades de 100 ns do FILETIME no Windows),
+//para que o arquivo salvo de novo no mesmo segundo e com o mesmo tamanho nao valide o cache antigo
+static bool readFileTime(const char *source, long long *size, long long *modified) {
+#ifdef _WIN32
+   WIN32_FILE_ATTRIBUTE_DATA info;
+   if( !GetFileAttributesExA(source, GetFileExInfoStandard, &info) ) return false;
+   *size = ((long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+   *modified = ((long long)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+#else
+   struct stat info;
+   if( stat(source, &info) != 0 ) return false;
+   *size = (long long)info.st_size;
+#ifdef __APPLE__
+   *modified = (long long)info.st_mtimespec.tv_sec*1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+   *modified = (long long)info.st_mtim.tv_sec*1000000000LL + info.st_mtim.tv_nsec;
+#endif
+#endif
+   return true;
+}
+
+
+MappedFile::MappedFile() {
+   data = NULL;
+   size = 0;
+#ifdef _WIN32
+   file = mapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile() {
+   close();
+}
+
+bool MappedFile::open(const char *fileName) {
+   close();
+#ifdef _WIN32
+   HANDLE handle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if( handle == INVALID_HANDLE_VALUE ) return false;
+   LARGE_INTEGER fileSize;
+   if( !GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0 ) {
+      CloseHandle(handle);
+      return false;
+   }
+   HANDLE map = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+   void *view = map != NULL ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : NULL;
+   if( view == NULL ) {
+      if( map != NULL ) CloseHandle(map);
+      CloseHandle(handle);
+      return false;
+   }
+   file = handle;
+   mapping = map;
+   data = (unsigned char*)view;
+   size = fileSize.QuadPart;
+#else
+   int fd = ::open(fileName, O_RDONLY);
+   if( fd < 0 ) return false;
+   struct stat info;
+   if( fstat(fd, &info) != 0 || info.st_size == 0 ) {
+      ::close(fd);
+      return false;
+   }
+   void *view = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   ::close(fd); //o mapeamento continua valido sem o descritor
+   if( view == MAP_FAILED ) return false;
+   data = (unsigned char*)view;
+   size = info.st_size;
+#endif
+   return true;
+}
+
+void MappedFile::close() {
+   if( data == NULL ) return;
+#ifdef _WIN32
+   UnmapViewOfFile(data);
+   CloseHandle((HANDLE)mapping);
+   CloseHandle((HANDLE)file);
+   file = mapping = NULL;
+#else
+   munmap(data, size);
+#endif
+   data = NULL;
+   size = 0;
+}
+
+const unsigned char* MappedFile::getData() {
+   return data;
+}
+
+long long MappedFile::getSize() {
+   return size;
+}
+
+
+std::string BmpCache::cacheName(const char *source) {
+   return std::string(source) + BMPCACHE_EXTENSION;
+}
+
+bool BmpCache::readSourceSignature(const char *source, long long *size, long long *modified, unsigned long long *hash) {
+   if( !readFileTime(source, size, modified) ) return false;
+
+   FILE *fp = fopen(source, "rb");
+   if( fp == NULL ) return false;
+
+   unsigned char buffer[HASH_EDGE_BYTES];
+   unsigned long long h = 14695981039346656037ULL;
+   size_t read = fread(buffer, 1, HASH_EDGE_BYTES, fp);
+   h = hashBytes(h, buffer, read);
+
+   if( *size > 2*HASH_EDGE_BYTES ) {
+      long long step = (*size - 2*HASH_EDGE_BYTES) / HASH_SAMPLES;
+      for(int i=0; i<HASH_SAMPLES && step >= HASH_SAMPLE_BYTES; i++) {
+         seekTo(fp, HASH_EDGE_BYTES + i*step);
+         read = fread(buffer, 1, HASH_SAMPLE_BYTES, fp);
+         h = hashBytes(h, buffer, read);
+      }
+      seekTo(fp, *size - HASH_EDGE_BYTES);
+      read = fread(buffer, 1, HASH_EDGE_BYTES, fp);
+      h = hashBytes(h, buffer, read);
+   }
+   fclose(fp);
+
+   *hash = h;
+   return true;
+}
+
+MappedFile* BmpCache::open(const char *source, const CACHEHEADER **header) {
+   long long size, modified;
+   unsigned long long hash;
+   if( !readSourceSignature(source, &size, &modified, &hash) ) return NULL;
+
+   MappedFile *file = new MappedFile();
+   if( !file->open(cacheName(source).c_str()) ) {
+      delete file;
+      return NULL;
+   }
+
+   const CACHEHEADER *h = (const CACHEHEADER*)file->getData();
+   bool valid = file->getSize() >= (long long)sizeof(CACHEHEADER) &&
+                memcmp(h->magic, cacheMagic, 4) == 0 &&
+                h->version == BMPCACHE_VERSION &&
+                h->headerSize == sizeof(CACHEHEADER) &&
+                h->channels == 3 &&
+                h->fileSize == file->getSize() &&
+                h->sourceSize == size && h->sourceModified == modified && h->sourceHash == hash &&
+                h->mipCount >= 1 && h->mipCount <= MAX_MIP_LEVELS;
+
+   for(int i=0; valid && i<h->mipCount; i++) {
+      const MIPLEVEL *level = &h->mips[i];
+      valid = level->offset >= 0 && level->stride >= level->width*3 &&
+              level->offset + (long long)level->stride*level->height <= h->fileSize;
+   }
+
+   if( !valid ) {
+      delete file;
+      return NULL;
+   }
+   *header = h;
+   return file;
+}
+
+bool BmpCache::write(const char *source, const unsigned char *pixels, int width, int height, int stride,
+                     const IMAGESTATS *stats, const unsigned char *mipData, const MIPLEVEL *mips, int mipCount) {
+   CACHEHEADER *header = new CACHEHEADER;
+   memset(header, 0, sizeof(CACHEHEADER));
+   memcpy(header->magic, cacheMagic, 4);
+   header->version = BMPCACHE_VERSION;
+   header->headerSize = sizeof(CACHEHEADER);
+   header->channels = 3;
+   header->width = width;
+   header->height = height;
+   header->stats = *stats;
+   if( mipCount > MAX_MIP_LEVELS ) mipCount = MAX_MIP_LEVELS;
+   header->mipCount = mipCount;
+
+   if( !readSourceSignature(source, &header->sourceSize, &header->sourceModified, &header->sourceHash) ) {
+      delete header;
+      return false;
+   }
+
+   //nivel 0 na primeira pagina apos o cabecalho; os demais niveis em seguida, alinhados
+   long long offset = alignUp(sizeof(CACHEHEADER), BMPCACHE_PAGE_SIZE);
+   for(int i=0; i<mipCount; i++) {
+      header->mips[i] = mips[i];
+      header->mips[i].offset = offset;
+      offset = alignUp(offset + (long long)mips[i].stride*mips[i].height, BMPCACHE_ALIGNMENT);
+   }
+   header->fileSize = offset;
+
+   //grava em um arquivo temporario e renomeia, para que um cache parcial nunca seja mapeado
+   std::string name = cacheName(source);
+   std::string temporary = name + ".tmp";
+   FILE *fp = fopen(temporary.c_str(), "wb");
+   if( fp == NULL ) {
+      delete header;
+      return false;
+   }
+
+   static const unsigned char zeros[BMPCACHE_PAGE_SIZE] = {0};
+   bool ok = fwrite(header, sizeof(CACHEHEADER), 1, fp) == 1;
+   long long written = sizeof(CACHEHEADER);
+   for(int i=0; ok && i<mipCount; i++) {
+      ok = fwrite(zeros, 1, header->mips[i].offset - written, fp) == (size_t)(header->mips[i].offset - written);
+      const unsigned char *levelData = i == 0 ? pixels : mipData + mips[i].offset;
+      size_t levelBytes = (size_t)mips[i].stride*mips[i].height;
+      ok = ok && fwrite(levelData, 1, levelBytes, fp) == levelBytes;
+      written = header->mips[i].offset + levelBytes;
+   }
+   ok = ok && fwrite(zeros, 1, header->fileSize - written, fp) == (size_t)(header->fileSize - written);
+   ok = (fclose(fp) == 0) && ok;
+   delete header;
+
+   if( ok ) {
+      remove(name.c_str()); //no Windows, rename nao substitui um arquivo existente
+      ok = rename(temporary.c_str(), name.c_str()) == 0;
+   }
+   if( !ok ) remove(temporary.c_str());
+   return ok;
+}
+
+int BmpCache::layoutMips(MIPLEVEL *mips, long long *bytes) {
+   int count = 1;
+   long long offset = 0;
+   while( count < MAX_MIP_LEVELS && (mips[count-1].width > 1 || mips[count-1].height > 1) ) {
+      MIPLEVEL *level = &mips[count];
+      level->width  = mips[count-1].width  > 1 ? mips[count-1].width/2  : 1;
+      level->height = mips[count-1].height > 1 ? mips[count-1].height/2 : 1;
+      level->stride = (level->width*3 + 3) & ~3;
+      level->offset = offset;
+      offset = alignUp(offset + (long long)level->stride*level->height, BMPCACHE_ALIGNMENT);
+      count++;
+   }
+   *bytes = offset;
+   return count;
+}
+
+void BmpCache::downsample(const unsigned char *src, const MIPLEVEL *srcLevel, unsigned char *dst, const MIPLEVEL *dstLevel) {
+   for(int y=0; y<dstLevel->height; y++) {
+      int y0 = y*2;
+      int y1 = y0 + 1 < srcLevel->height ? y0 + 1 : y0;
+      const unsigned char *row0 = src + y0*srcLevel->stride;
+      const unsigned char *row1 = src + y1*srcLevel->stride;
+      unsigned char *out = dst + y*dstLevel->stride;
+
+      for(int x=0; x<dstLevel->width; x++) {
+         int x0 = x*2*3;
+         int x1 = x*2 + 1 < srcLevel->width ? x0 + 3 : x0;
+         for(int c=0; c<3; c++) {
+            out[x*3 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+         }
+      }
+      memset(out + dstLevel->width*3, 0, dstLevel->stride - dstLevel->width*3);
+   }
+}
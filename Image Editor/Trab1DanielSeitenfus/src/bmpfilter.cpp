@@ -0,0 +1,308 @@
+//*********************************************************
+//
+// classe para aplicar filtros de convolucao separaveis aos pixels do Bmp
+//
+//**********************************************************
+
+#include "BmpFilter.h"
+#include "ThreadPool.h"
+#include <math.h>
+#include <string.h>
+#include <new>
+#include <vector>
+#include <functional>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//valores processados por instrucao; as linhas sao processadas em grupos inteiros, com folga nos buffers
+#define FILTER_LANES 8
+
+//buffers de trabalho de uma thread
+struct FilterScratch {
+   std::vector<unsigned short> padded;  //linha com a borda repetida, em Q8
+   std::vector<unsigned short> strip;   //faixa filtrada pela primeira passada, antes de ser transposta
+   std::vector<unsigned char> narrow;   //faixa filtrada pela segunda passada, arredondada para 8 bits
+   std::vector<unsigned char> line;     //pedaco de uma linha da saida
+};
+
+static int roundToLanes(int count) {
+   return (count + FILTER_LANES - 1) / FILTER_LANES * FILTER_LANES;
+}
+
+//repete radius vezes o pixel nas pontas de uma linha ja copiada para padded + radius*3
+static void padEdges(unsigned short *padded, int width, int radius) {
+   unsigned short *first = padded + radius*3, *last = first + (width - 1)*3;
+   for( int i = 0; i < radius; i++ ) {
+      memcpy(padded + i*3, first, 3*sizeof(unsigned short));
+      memcpy(last + (i + 1)*3, last, 3*sizeof(unsigned short));
+   }
+}
+
+//copia uma linha de 8 bits para padded, em Q8, com a borda repetida
+static void padRow(const unsigned char *row, int width, int radius, unsigned short *padded) {
+   unsigned short *out = padded + radius*3;
+   int count = width*3, i = 0;
+#ifdef __SSE2__
+   __m128i zero = _mm_setzero_si128();
+   for( ; i + 16 <= count; i += 16 ) {
+      __m128i value = _mm_loadu_si128((const __m128i*)(row + i));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi8(zero, value));     //o byte alto recebe o pixel: value << 8
+      _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpackhi_epi8(zero, value));
+   }
+#endif
+   for( ; i < count; i++ ) out[i] = row[i] << 8;
+   padEdges(padded, width, radius);
+}
+
+//arredonda count valores em Q8 para 8 bits
+static void narrowRow(const unsigned short *in, unsigned char *out, int count) {
+   int i = 0;
+#ifdef __SSE2__
+   __m128i half = _mm_set1_epi16(128);
+   for( ; i + 16 <= count; i += 16 ) {
+      __m128i low = _mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(in + i)), half), 8);
+      __m128i high = _mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(in + i + 8)), half), 8);
+      _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+   }
+#endif
+   for( ; i < count; i++ ) out[i] = (in[i] + 128) >> 8;
+}
+
+//convolucao de uma linha com o nucleo, para count valores (arredondado para FILTER_LANES); in comeca radius pixels antes da saida.
+//O nucleo e simetrico: os pixels a mesma distancia do centro sao somados pela media arredondada ((a + b + 1) >> 1, que nao
+//estoura 16 bits) e multiplicados uma unica vez pelo dobro do peso, (media*peso) >> 16. Os produtos truncados perdem em media meia
+//unidade cada, entao a soma comeca com metade do numero de produtos. A soma nao passa de 16 bits: os pesos somam 65536
+//e cada valor de entrada e no maximo 255 << 8.
+static void convolveRow(const unsigned short *in, unsigned short *out, int count, const FILTERKERNEL *kernel) {
+   int radius = kernel->radius;
+   const unsigned short *center = in + radius*3;
+   unsigned short bias = (radius + 1)/2;
+#ifdef __SSE2__
+   __m128i start = _mm_set1_epi16(bias);
+   __m128i weights[FILTER_MAX_RADIUS + 1];
+   weights[0] = _mm_set1_epi16(kernel->weights[radius]);
+   for( int k = 1; k <= radius; k++ ) weights[k] = _mm_set1_epi16(2*kernel->weights[radius + k]);
+   for( int i = 0; i < count; i += FILTER_LANES ) {
+      __m128i acc = _mm_add_epi16(start, _mm_mulhi_epu16(_mm_loadu_si128((const __m128i*)(center + i)), weights[0]));
+      for( int k = 1; k <= radius; k++ ) {
+         __m128i before = _mm_loadu_si128((const __m128i*)(center + i - 3*k));
+         __m128i after = _mm_loadu_si128((const __m128i*)(center + i + 3*k));
+         acc = _mm_add_epi16(acc, _mm_mulhi_epu16(_mm_avg_epu16(before, after), weights[k]));
+      }
+      _mm_storeu_si128((__m128i*)(out + i), acc);
+   }
+#else
+   for( int i = 0; i < count; i += FILTER_LANES ) {
+      unsigned int acc[FILTER_LANES];
+      for( int j = 0; j < FILTER_LANES; j++ ) acc[j] = bias + ((center[i + j]*kernel->weights[radius]) >> 16);
+      for( int k = 1; k <= radius; k++ ) {
+         unsigned int weight = 2*kernel->weights[radius + k];
+         const unsigned short *before = center + i - 3*k, *after = center + i + 3*k;
+         for( int j = 0; j < FILTER_LANES; j++ ) acc[j] += (((before[j] + after[j] + 1) >> 1)*weight) >> 16;
+      }
+      for( int j = 0; j < FILTER_LANES; j++ ) out[i + j] = (unsigned short)acc[j];
+   }
+#endif
+}
+
+//grava as rows linhas da faixa (cada uma com width pixels) como colunas de dst, a partir da coluna 0.
+//A faixa e percorrida em blocos de FILTER_TILE pixels, que cabem na cache de dados enquanto sao transpostos.
+static void transposeStrip(const unsigned short *strip, int stripStride, int rows, int width, unsigned short *dst, long long dstStride) {
+   for( int tile = 0; tile < width; tile += FILTER_TILE ) {
+      int end = tile + FILTER_TILE < width ? tile + FILTER_TILE : width;
+      for( int x = tile; x < end; x++ ) {
+         unsigned short *column = dst + x*dstStride;
+         const unsigned short *source = strip + x*3;
+         for( int s = 0; s < rows; s++, source += stripStride, column += 3 ) {
+            memcpy(column, source, 3*sizeof(unsigned short));
+         }
+      }
+   }
+}
+
+static unsigned char clampToByte(int value) {
+   return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+//mascara de nitidez sobre count valores: out = original + amount*(original - blurred), amount em Q8.
+//original e lido antes de out ser escrito, entao podem ser o mesmo buffer
+static void sharpenRow(const unsigned char *original, const unsigned char *blurred, unsigned char *out, int count, int amount) {
+   int i = 0;
+#ifdef __SSE2__
+   //a diferenca vezes amount passa de 16 bits: os produtos sao montados em 32 bits a partir das metades baixa e alta
+   __m128i zero = _mm_setzero_si128(), half = _mm_set1_epi32(128), weight = _mm_set1_epi16(amount);
+   for( ; i + 8 <= count; i += 8 ) {
+      __m128i value = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(original + i)), zero);
+      __m128i difference = _mm_sub_epi16(value, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(blurred + i)), zero));
+      __m128i low = _mm_mullo_epi16(difference, weight), high = _mm_mulhi_epi16(difference, weight);
+      __m128i first = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(low, high), half), 8);
+      __m128i second = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(low, high), half), 8);
+      __m128i result = _mm_adds_epi16(value, _mm_packs_epi32(first, second));
+      _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(result, result));
+   }
+#endif
+   for( ; i < count; i++ ) {
+      int value = original[i];
+      out[i] = clampToByte(value + (((value - blurred[i])*amount + 128) >> 8));
+   }
+}
+
+BmpFilter::BmpFilter() {
+   amount = 0;
+   transposed = NULL;
+   transposedSize = 0;
+   setGaussian(1);
+}
+
+BmpFilter::~BmpFilter() {
+   delete[] transposed;
+}
+
+BmpFilter::BmpFilter(const BmpFilter &other) {
+   kernel = other.kernel;
+   amount = other.amount;
+   transposed = NULL;
+   transposedSize = 0;
+}
+
+BmpFilter& BmpFilter::operator=(const BmpFilter &other) {
+   kernel = other.kernel;
+   amount = other.amount;
+   return *this;
+}
+
+//pesos gaussianos normalizados para somar exatamente 65536; o arredondamento e compensado no peso central
+void BmpFilter::setGaussian(int radius) {
+   if( radius < 1 ) radius = 1;
+   if( radius > FILTER_MAX_RADIUS ) radius = FILTER_MAX_RADIUS;
+   kernel.radius = radius;
+
+   double sigma = (radius + 1)/3.0;
+   double values[2*FILTER_MAX_RADIUS + 1], sum = 0;
+   for( int k = -radius; k <= radius; k++ ) {
+      values[k + radius] = exp(-k*k/(2*sigma*sigma));
+      sum += values[k + radius];
+   }
+   int total = 0;
+   for( int k = 0; k <= 2*radius; k++ ) {
+      kernel.weights[k] = (unsigned short)(values[k]/sum*65536 + 0.5);
+      total += kernel.weights[k];
+   }
+   int center = kernel.weights[radius] + 65536 - total;
+   kernel.weights[radius] = center > 65535 ? 65535 : center;
+}
+
+void BmpFilter::setBoxBlur(int radius) {
+   if( radius < 1 ) radius = 1;
+   if( radius > FILTER_MAX_RADIUS ) radius = FILTER_MAX_RADIUS;
+   kernel.radius = radius;
+   int taps = 2*radius + 1;
+   for( int k = 0; k < taps; k++ ) {
+      kernel.weights[k] = 65536/taps + (k < 65536 % taps ? 1 : 0);
+   }
+   amount = 0;
+}
+
+void BmpFilter::setGaussianBlur(int radius) {
+   setGaussian(radius);
+   amount = 0;
+}
+
+void BmpFilter::setUnsharpMask(int radius, float _amount) {
+   setGaussian(radius);
+   if( _amount < 0 ) _amount = 0;
+   if( _amount > FILTER_MAX_AMOUNT ) _amount = FILTER_MAX_AMOUNT;
+   amount = (int)(_amount*256 + 0.5);
+}
+
+void BmpFilter::setSharpen(float _amount) {
+   setUnsharpMask(1, _amount);
+}
+
+int BmpFilter::getRadius() {
+   return kernel.radius;
+}
+
+const char* BmpFilter::getImplementation() {
+#ifdef __SSE2__
+   return "SSE2";
+#else
+   return "escalar";
+#endif
+}
+
+bool BmpFilter::apply(const unsigned char *src, int srcStride, unsigned char *dst, int dstStride, int width, int height, ThreadPool *pool) {
+   if( width <= 0 || height <= 0 ) return true;
+
+   //imagem transposta entre as passadas: a linha x tem os height pixels da coluna x, em Q8, com espaco para a borda e folga
+   //para o ultimo grupo de FILTER_LANES valores. E reaproveitada nas chamadas seguintes, para nao pagar a alocacao e o
+   //mapeamento das paginas a cada imagem
+   int radius = kernel.radius;
+   long long transposedStride = roundToLanes((height + 2*radius)*3) + FILTER_LANES;
+   if( transposedSize < transposedStride*width ) {
+      delete[] transposed;
+      transposedSize = 0;
+      transposed = new (std::nothrow) unsigned short[transposedStride*width];
+      if( transposed == NULL ) return false;
+      transposedSize = transposedStride*width;
+   }
+
+   int sharpen = amount;
+   int longest = width > height ? width : height;
+   int stripStride = roundToLanes(longest*3);
+   int threads = pool != NULL ? pool->getThreadCount() : 1;
+   std::vector<FilterScratch> scratch(threads);
+   for( int t = 0; t < threads; t++ ) {
+      scratch[t].padded.resize(roundToLanes((width + 2*radius)*3) + FILTER_LANES);
+      scratch[t].strip.resize((size_t)stripStride*FILTER_STRIP_ROWS);
+      scratch[t].narrow.resize((size_t)height*3*FILTER_STRIP_ROWS);
+      scratch[t].line.resize(FILTER_STRIP_ROWS*3);
+   }
+
+   //primeira passada: filtra as linhas de uma faixa e grava a faixa como colunas da imagem transposta
+   std::function<void(int, int, int)> rows = [&](int first, int last, int thread) {
+      FilterScratch &work = scratch[thread];
+      for( int y = first; y < last; y++ ) {
+         padRow(src + (long long)y*srcStride, width, radius, &work.padded[0]);
+         convolveRow(&work.padded[0], &work.strip[(y - first)*stripStride], width*3, &kernel);
+      }
+      transposeStrip(&work.strip[0], stripStride, last - first, width, transposed + (radius + first)*3, transposedStride);
+   };
+
+   //segunda passada: filtra as linhas da imagem transposta (colunas da original) e grava a faixa de volta na orientacao original
+   std::function<void(int, int, int)> columns = [&](int first, int last, int thread) {
+      FilterScratch &work = scratch[thread];
+      int columnCount = last - first, narrowStride = height*3;
+      for( int x = first; x < last; x++ ) {
+         unsigned short *column = transposed + x*transposedStride;
+         padEdges(column, height, radius);
+         convolveRow(column, &work.strip[0], height*3, &kernel);
+         narrowRow(&work.strip[0], &work.narrow[(x - first)*narrowStride], height*3);
+      }
+      //cada linha da saida recebe columnCount pixels, um de cada linha da faixa; a faixa e lida em blocos de FILTER_TILE linhas da saida
+      for( int tile = 0; tile < height; tile += FILTER_TILE ) {
+         int end = tile + FILTER_TILE < height ? tile + FILTER_TILE : height;
+         for( int y = tile; y < end; y++ ) {
+            unsigned char *out = dst + (long long)y*dstStride + first*3;
+            unsigned char *line = sharpen != 0 ? &work.line[0] : out;
+            const unsigned char *blurred = &work.narrow[y*3];
+            for( int s = 0; s < columnCount; s++, blurred += narrowStride ) {
+               memcpy(line + s*3, blurred, 3);
+            }
+            if( sharpen != 0 ) sharpenRow(src + (long long)y*srcStride + first*3, line, out, columnCount*3, sharpen);
+         }
+      }
+   };
+
+   if( pool != NULL ) {
+      pool->parallelFor(height, FILTER_STRIP_ROWS, rows);
+      pool->parallelFor(width, FILTER_STRIP_ROWS, columns);
+   } else {
+      for( int y = 0; y < height; y += FILTER_STRIP_ROWS ) rows(y, y + FILTER_STRIP_ROWS < height ? y + FILTER_STRIP_ROWS : height, 0);
+      for( int x = 0; x < width; x += FILTER_STRIP_ROWS ) columns(x, x + FILTER_STRIP_ROWS < width ? x + FILTER_STRIP_ROWS : width, 0);
+   }
+
+   return true;
+}
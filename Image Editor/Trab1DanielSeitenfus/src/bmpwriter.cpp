@@ -0,0 +1,120 @@
+//*********************************************************
+//
+// classe para gravar arquivos BMP de 24 bits linha a linha
+//
+//  Referencia:  http://astronomy.swin.edu.au/~pbourke/dataformats/bmp/
+//
+//**********************************************************
+
+#include "BmpWriter.h"
+#include "Bmp.h"
+#include <string.h>
+
+//os campos sao gravados um a um, em little endian, pois sizeof(HEADER) inclui bytes de alinhamento
+static void putShort(unsigned char *p, unsigned short v) {
+   p[0] = v & 0xff;
+   p[1] = (v >> 8) & 0xff;
+}
+
+static void putInt(unsigned char *p, unsigned int v) {
+   p[0] = v & 0xff;
+   p[1] = (v >> 8) & 0xff;
+   p[2] = (v >> 16) & 0xff;
+   p[3] = (v >> 24) & 0xff;
+}
+
+BmpWriter::BmpWriter() {
+   fp = NULL;
+   width = height = bytesPerLine = 0;
+   rowsWritten = 0;
+   rowBuffer = NULL;
+}
+
+BmpWriter::~BmpWriter() {
+   if( fp != NULL ) fclose(fp);
+   delete[] rowBuffer;
+}
+
+bool BmpWriter::open(const char *fileName, int _width, int _height) {
+   if( fp != NULL ) close();
+
+   long long imageSize = (long long)((_width*3 + 3) & ~3) * _height;
+   if( _width <= 0 || _height <= 0 || imageSize > 0x7fffffff - HEADER_SIZE - INFOHEADER_SIZE ) {
+      printf("\nErro: dimensoes invalidas para gravar BMP (%d x %d)", _width, _height);
+      return false;
+   }
+
+   fp = fopen(fileName, "wb");
+   if( fp == NULL ) {
+      printf("\nErro ao abrir arquivo %s para escrita", fileName);
+      return false;
+   }
+
+   width  = _width;
+   height = _height;
+   bytesPerLine = (width*3 + 3) & ~3;
+   rowsWritten  = 0;
+
+   delete[] rowBuffer;
+   rowBuffer = new unsigned char[bytesPerLine];
+   memset(rowBuffer, 0, bytesPerLine); //o preenchimento nunca e sobrescrito
+
+   if( !writeHeader() ) {
+      fclose(fp);
+      fp = NULL;
+      return false;
+   }
+   return true;
+}
+
+bool BmpWriter::writeHeader() {
+   unsigned char bytes[HEADER_SIZE + INFOHEADER_SIZE];
+   unsigned int imageSize = bytesPerLine * height;
+   memset(bytes, 0, sizeof(bytes));
+
+   //HEADER
+   bytes[0] = 'B';
+   bytes[1] = 'M';
+   putInt(bytes + 2, HEADER_SIZE + INFOHEADER_SIZE + imageSize);
+   putInt(bytes + 10, HEADER_SIZE + INFOHEADER_SIZE);
+
+   //INFOHEADER
+   unsigned char *info = bytes + HEADER_SIZE;
+   putInt(info, INFOHEADER_SIZE);
+   putInt(info + 4, width);
+   putInt(info + 8, height);
+   putShort(info + 12, 1);   //planes
+   putShort(info + 14, 24);  //bits
+   putInt(info + 16, 0);     //sem compressao
+   putInt(info + 20, imageSize);
+   putInt(info + 24, 2835);  //72 dpi
+   putInt(info + 28, 2835);
+
+   return fwrite(bytes, 1, sizeof(bytes), fp) == sizeof(bytes);
+}
+
+unsigned char* BmpWriter::getRowBuffer() {
+   return rowBuffer;
+}
+
+bool BmpWriter::writeRow() {
+   if( fp == NULL || rowsWritten >= height ) return false;
+   if( (int)fwrite(rowBuffer, 1, bytesPerLine, fp) != bytesPerLine ) {
+      printf("\nErro de escrita no arquivo BMP");
+      return false;
+   }
+   rowsWritten++;
+   return true;
+}
+
+bool BmpWriter::close() {
+   if( fp == NULL ) return false;
+   bool ok = rowsWritten == height;
+   if( fclose(fp) != 0 ) ok = false;
+   fp = NULL;
+   return ok;
+}
+
+int BmpWriter::getRowsWritten() {
+   return rowsWritten;
+}
@@ -15,6 +15,18 @@
 
 #include "gl_canvas2d.h"
 #include <GL/glut.h>
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "TripleBuffer.h"
+
+#ifndef GL_MULTISAMPLE
+#define GL_MULTISAMPLE 0x809D //OpenGL 1.3; o gl.h do Windows declara apenas a versao 1.1
+#endif
 
 //conjunto de cores predefinidas. Pode-se adicionar mais cores.
 float Colors[14][3]=
@@ -46,31 +58,209 @@ void mouseWheelCB(int wheel, int direction, int x, int y);
 void render();
 
 
+//estado atual do OpenGL conhecido pela CV, para descartar alteracoes redundantes
+static struct {
+   bool   open;               //ha um glBegin sem glEnd
+   GLenum mode;               //primitiva do glBegin em aberto
+   bool   colorKnown;
+   float  r, g, b, a;
+   bool   translateKnown;
+   float  tx, ty;
+} state = {false, GL_POINTS, false, 0, 0, 0, 0, false, 0, 0};
+
+static CVSTATS stats;
+
+//operacoes da CV gravadas em um quadro
+enum
+{
+   OP_COLOR, OP_POINT, OP_LINE, OP_RECT, OP_RECT_FILL, OP_POLYGON, OP_POLYGON_FILL,
+   OP_CIRCLE, OP_CIRCLE_FILL, OP_TEXT, OP_TRANSLATE, OP_CLEAR, OP_COMMAND
+};
+
+typedef struct {
+   int   type;
+   float v[4];
+   int   index, count;  //posicao e tamanho dos dados da operacao em vertices, texts ou commands
+} CVOP;
+
+//quadro gravado pela thread do GLUT e desenhado pela thread de renderizacao. Os vetores sao reaproveitados de um quadro para o outro.
+struct CVFrame
+{
+   long long number;
+   std::vector<CVOP> ops;
+   std::vector<float> vertices;
+   std::vector<char> texts;
+   std::vector<CVCommand*> commands;
+
+   CVFrame() : number(0) {}
+
+   ~CVFrame()
+   {
+      clear();
+   }
+
+   void clear()
+   {
+      for(size_t i=0; i < commands.size(); i++) delete commands[i];
+      commands.clear();
+      ops.clear();
+      vertices.clear();
+      texts.clear();
+   }
+
+   void add(int type, float v0 = 0, float v1 = 0, float v2 = 0, float v3 = 0, int index = 0, int count = 0)
+   {
+      CVOP op = {type, {v0, v1, v2, v3}, index, count};
+      ops.push_back(op);
+   }
+
+   void addPolygon(int type, float vx[], float vy[], int elems)
+   {
+      add(type, 0, 0, 0, 0, (int)vertices.size(), elems);
+      vertices.insert(vertices.end(), vx, vx + elems);
+      vertices.insert(vertices.end(), vy, vy + elems);
+   }
+
+   void addText(float x, float y, const char *t)
+   {
+      add(OP_TEXT, x, y, 0, 0, (int)texts.size());
+      texts.insert(texts.end(), t, t + strlen(t) + 1);
+   }
+
+   void addCommand(CVCommand *command)
+   {
+      add(OP_COMMAND, 0, 0, 0, 0, (int)commands.size());
+      commands.push_back(command);
+   }
+
+   //executa as operacoes gravadas. Chamada na thread de renderizacao, onde a CV desenha em vez de gravar.
+   void replay()
+   {
+      for(size_t i=0; i < ops.size(); i++)
+      {
+         const CVOP &op = ops[i];
+         switch( op.type )
+         {
+            case OP_COLOR:        CV::color(op.v[0], op.v[1], op.v[2], op.v[3]); break;
+            case OP_POINT:        CV::point(op.v[0], op.v[1]); break;
+            case OP_LINE:         CV::line(op.v[0], op.v[1], op.v[2], op.v[3]); break;
+            case OP_RECT:         CV::rect(op.v[0], op.v[1], op.v[2], op.v[3]); break;
+            case OP_RECT_FILL:    CV::rectFill(op.v[0], op.v[1], op.v[2], op.v[3]); break;
+            case OP_POLYGON:      CV::polygon(&vertices[op.index], &vertices[op.index + op.count], op.count); break;
+            case OP_POLYGON_FILL: CV::polygonFill(&vertices[op.index], &vertices[op.index + op.count], op.count); break;
+            case OP_CIRCLE:       CV::circle(op.v[0], op.v[1], op.v[2], (int)op.v[3]); break;
+            case OP_CIRCLE_FILL:  CV::circleFill(op.v[0], op.v[1], op.v[2], (int)op.v[3]); break;
+            case OP_TEXT:         CV::text(op.v[0], op.v[1], &texts[op.index]); break;
+            case OP_TRANSLATE:    CV::translate(op.v[0], op.v[1]); break;
+            case OP_CLEAR:        CV::clear(op.v[0], op.v[1], op.v[2]); break;
+            default:
+               CV::flush();
+               commands[op.index]->execute();
+         }
+      }
+   }
+};
+
+//quadro sendo gravado pela thread atual; NULL fora da gravacao e sempre NULL na thread de renderizacao
+static thread_local CVFrame *recording = NULL;
+
+static bool renderThreadEnabled = false;
+static TripleBuffer<CVFrame> snapshots;
+static std::thread renderThread;
+static std::atomic<bool> renderStopping(false);
+static std::atomic<long long> publishedFrame(0), renderingFrame(0);
+static std::atomic<long long> viewportSize(0); //largura nos 32 bits altos e altura nos baixos, alterada pelo reshape
+static std::atomic<bool> multisampleRequested(true);
+static bool multisampleApplied = true; //estado do contexto que desenha; o MSAA vem habilitado em janelas com GLUT_MULTISAMPLE
+
+//pontos, linhas e quadrilateros sao primitivas independentes: varios desenhos consecutivos do mesmo tipo
+//podem compartilhar o mesmo glBegin. glColor pode ser chamado entre os vertices.
+static void beginBatch(GLenum mode)
+{
+   stats.primitives++;
+   if( state.open && state.mode == mode ) return;
+   if( state.open ) glEnd();
+   glBegin(mode);
+   state.open = true;
+   state.mode = mode;
+   stats.primitiveBatches++;
+}
+
+//primitivas que nao podem ser agrupadas (GL_LINE_LOOP, GL_POLYGON) encerram o grupo em aberto
+static void beginSingle(GLenum mode)
+{
+   CV::flush();
+   glBegin(mode);
+   stats.primitives++;
+   stats.primitiveBatches++;
+}
+
+static void setColor(float r, float g, float b, float a)
+{
+   if( recording ) { recording->add(OP_COLOR, r, g, b, a); return; }
+   stats.colorCalls++;
+   if( state.colorKnown && state.r == r && state.g == g && state.b == b && state.a == a )
+   {
+      stats.colorsSkipped++;
+      return;
+   }
+   glColor4f(r, g, b, a);
+   state.colorKnown = true;
+   state.r = r; state.g = g; state.b = b; state.a = a;
+}
+
+void CV::flush()
+{
+   if( recording ) return; //o estado pertence a thread que desenha
+   if( state.open )
+   {
+      glEnd();
+      state.open = false;
+   }
+}
+
+void CV::resetState()
+{
+   if( recording ) return;
+   flush();
+   state.colorKnown = false;
+   state.translateKnown = false;
+}
+
+const CVSTATS& CV::getStats()
+{
+   return stats;
+}
+
+void CV::resetStats()
+{
+   memset(&stats, 0, sizeof(stats));
+}
+
 void CV::point(float x, float y)
 {
-   glBegin(GL_POINTS);
+   if( recording ) { recording->add(OP_POINT, x, y); return; }
+   beginBatch(GL_POINTS);
       glVertex2d(x, y);
-   glEnd();
 }
 
 void CV::point(Vector2 p)
 {
-   glBegin(GL_POINTS);
-      glVertex2d(p.x, p.y);
-   glEnd();
+   point(p.x, p.y);
 }
 
 void CV::line( float x1, float y1, float x2, float y2 )
 {
-   glBegin(GL_LINES);
+   if( recording ) { recording->add(OP_LINE, x1, y1, x2, y2); return; }
+   beginBatch(GL_LINES);
       glVertex2d(x1, y1);
       glVertex2d(x2, y2);
-   glEnd();
 }
 
 void CV::rect( float x1, float y1, float x2, float y2 )
 {
-   glBegin(GL_LINE_LOOP);
+   if( recording ) { recording->add(OP_RECT, x1, y1, x2, y2); return; }
+   beginSingle(GL_LINE_LOOP);
       glVertex2d(x1, y1);
       glVertex2d(x1, y2);
       glVertex2d(x2, y2);
@@ -80,27 +270,23 @@ void CV::rect( float x1, float y1, float x2, float y2 )
 
 void CV::rectFill( float x1, float y1, float x2, float y2 )
 {
-   glBegin(GL_QUADS);
+   if( recording ) { recording->add(OP_RECT_FILL, x1, y1, x2, y2); return; }
+   beginBatch(GL_QUADS);
       glVertex2d(x1, y1);
       glVertex2d(x1, y2);
       glVertex2d(x2, y2);
       glVertex2d(x2, y1);
-   glEnd();
 }
 void CV::rectFill( Vector2 p1, Vector2 p2 )
 {
-   glBegin(GL_QUADS);
-      glVertex2d(p1.x, p1.y);
-      glVertex2d(p1.x, p2.y);
-      glVertex2d(p2.x, p2.y);
-      glVertex2d(p2.x, p1.y);
-   glEnd();
+   rectFill(p1.x, p1.y, p2.x, p2.y);
 }
 
 void CV::polygon(float vx[], float vy[], int elems)
 {
+   if( recording ) { recording->addPolygon(OP_POLYGON, vx, vy, elems); return; }
    int cont;
-   glBegin(GL_LINE_LOOP);
+   beginSingle(GL_LINE_LOOP);
       for(cont=0; cont<elems; cont++)
       {
          glVertex2d(vx[cont], vy[cont]);
@@ -110,8 +296,9 @@ void CV::polygon(float vx[], float vy[], int elems)
 
 void CV::polygonFill(float vx[], float vy[], int elems)
 {
+   if( recording ) { recording->addPolygon(OP_POLYGON_FILL, vx, vy, elems); return; }
    int cont;
-   glBegin(GL_POLYGON);
+   beginSingle(GL_POLYGON);
       for(cont=0; cont<elems; cont++)
       {
          glVertex2d(vx[cont], vy[cont]);
@@ -130,6 +317,8 @@ void CV::polygonFill(float vx[], float vy[], int elems)
 //  http://ftgl.sourceforge.net/docs/html/ftgl-tutorial.html
 void CV::text(float x, float y, const char *t)
 {
+    if( recording ) { recording->addText(x, y, t); return; }
+    flush(); //glRasterPos nao pode ser chamado entre glBegin e glEnd
     int tam = (int)strlen(t);
     for(int c=0; c < tam; c++)
     {
@@ -140,14 +329,16 @@ void CV::text(float x, float y, const char *t)
 
 void CV::clear(float r, float g, float b)
 {
+   if( recording ) { recording->add(OP_CLEAR, r, g, b); return; }
    glClearColor( r, g, b, 1 );
 }
 
 void CV::circle( float x, float y, float radius, int div )
 {
+   if( recording ) { recording->add(OP_CIRCLE, x, y, radius, div); return; }
    float ang = 0, x1, y1;
    float inc = PI_2/div;
-   glBegin(GL_LINE_LOOP);
+   beginSingle(GL_LINE_LOOP);
       for(int lado = 1; lado <= div; lado++) //GL_LINE_LOOP desenha um poligono fechado. Liga automaticamente o primeiro e ultimio vertices.
       {
          x1 = (cos(ang)*radius);
@@ -160,9 +351,10 @@ void CV::circle( float x, float y, float radius, int div )
 
 void CV::circleFill( float x, float y, float radius, int div )
 {
+   if( recording ) { recording->add(OP_CIRCLE_FILL, x, y, radius, div); return; }
    float ang = 0, x1, y1;
    float inc = PI_2/div;
-   glBegin(GL_POLYGON);
+   beginSingle(GL_POLYGON);
       for(int lado = 1; lado <= div; lado++) //GL_POLYGON desenha um poligono CONVEXO preenchido.
       {
          x1 = (cos(ang)*radius);
@@ -177,31 +369,40 @@ void CV::circleFill( float x, float y, float radius, int div )
 //nao armazena translacoes cumulativas.
 void CV::translate(float offsetX, float offsetY)
 {
+   if( recording ) { recording->add(OP_TRANSLATE, offsetX, offsetY); return; }
+   stats.translateCalls++;
+   if( state.translateKnown && state.tx == offsetX && state.ty == offsetY )
+   {
+      stats.translatesSkipped++;
+      return;
+   }
+   flush(); //a matriz nao pode ser alterada entre glBegin e glEnd
    glMatrixMode(GL_MODELVIEW);
    glLoadIdentity();
    glTranslated(offsetX, offsetY, 0);
+   state.translateKnown = true;
+   state.tx = offsetX;
+   state.ty = offsetY;
 }
 
 void CV::translate(Vector2 offset)
 {
-   glMatrixMode(GL_MODELVIEW);
-   glLoadIdentity();
-   glTranslated(offset.x, offset.y, 0);
+   translate(offset.x, offset.y);
 }
 
 void CV::color(float r, float g, float b)
 {
-   glColor3d(r, g, b);
+   setColor(r, g, b, 1);
 }
 
 void CV::color(int idx)
 {
-    glColor3fv(Colors[idx]);
+   setColor(Colors[idx][0], Colors[idx][1], Colors[idx][2], 1);
 }
 
 void CV::color(float r, float g, float b, float alpha)
 {
-   glColor4d(r, g, b, alpha);
+   setColor(r, g, b, alpha);
 }
 
 void special(int key, int , int )
@@ -250,12 +451,9 @@ void ConvertMouseCoord(int button, int state, int wheel, int direction, int x, i
 }
 
 
-//funcao chamada sempre que a tela for redimensionada.
-void reshape (int w, int h)
+//projecao da canvas para uma janela de w x h pixels
+static void setupProjection(int w, int h)
 {
-   screenHeight = h; //atualiza as variaveis da main() com a nova dimensao da tela.
-   screenWidth = w;
-
    glViewport (0, 0, (GLsizei) w, (GLsizei) h);
    glMatrixMode (GL_PROJECTION);
    glLoadIdentity ();
@@ -273,6 +471,20 @@ void reshape (int w, int h)
    glLoadIdentity ();
 }
 
+//funcao chamada sempre que a tela for redimensionada.
+void reshape (int w, int h)
+{
+   screenHeight = h; //atualiza as variaveis da main() com a nova dimensao da tela.
+   screenWidth = w;
+
+   if( renderThreadEnabled )
+   {
+      viewportSize.store(((long long)w << 32) | (unsigned int)h); //aplicada pela thread de renderizacao no proximo quadro
+      return;
+   }
+   setupProjection(w, h);
+}
+
 //definicao de valores para limpar buffers
 void inicializa()
 {
@@ -280,16 +492,230 @@ void inicializa()
    glPolygonMode(GL_FRONT, GL_FILL);
 }
 
-void display (void)
+static void beginFrame()
 {
+   bool multisample = multisampleRequested.load();
+   if( multisample != multisampleApplied )
+   {
+      if( multisample ) glEnable(GL_MULTISAMPLE);
+      else glDisable(GL_MULTISAMPLE);
+      multisampleApplied = multisample;
+   }
    glClear(GL_COLOR_BUFFER_BIT );
 
    glMatrixMode(GL_MODELVIEW);
    glLoadIdentity();
+   CV::resetState();
+   state.translateKnown = true; //identidade
+   state.tx = state.ty = 0;
+}
 
+static void endFrame()
+{
+   CV::flush();
+   glFlush();
+   stats.frames++;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+//  thread de renderizacao
+////////////////////////////////////////////////////////////////////////////////////////
+
+//segundo contexto OpenGL, para a mesma janela e com o mesmo formato de pixels do contexto do GLUT.
+//O GLUT torna o seu contexto atual na thread dele antes de cada callback, por isso a thread de renderizacao nao pode usa-lo.
+#ifdef _WIN32
+static HDC   windowDC;
+static HGLRC renderContext;
+#else
+static Display    *renderDisplay;
+static GLXDrawable windowDrawable;
+static GLXContext  renderContext;
+#endif
+
+//cria o contexto da thread de renderizacao. Chamada na thread do GLUT, com o contexto da janela atual.
+static bool createRenderContext()
+{
+#ifdef _WIN32
+   windowDC = wglGetCurrentDC();
+   renderContext = wglCreateContext(windowDC);
+   return renderContext != NULL;
+#else
+   Display *glutDisplay = glXGetCurrentDisplay();
+   GLXContext glutContext = glXGetCurrentContext();
+   windowDrawable = glXGetCurrentDrawable();
+   int configId = 0, screen = 0;
+   glXQueryContext(glutDisplay, glutContext, GLX_FBCONFIG_ID, &configId);
+   glXQueryContext(glutDisplay, glutContext, GLX_SCREEN, &screen);
+
+   //conexao propria com o servidor X: a do GLUT nao pode ser usada por duas threads sem XInitThreads
+   renderDisplay = XOpenDisplay(DisplayString(glutDisplay));
+   if( renderDisplay == NULL ) return false;
+
+   int attributes[] = {GLX_FBCONFIG_ID, configId, None};
+   int count = 0;
+   GLXFBConfig *configs = glXChooseFBConfig(renderDisplay, screen, attributes, &count);
+   renderContext = count > 0 ? glXCreateNewContext(renderDisplay, configs[0], GLX_RGBA_TYPE, NULL, True) : NULL;
+   if( configs != NULL ) XFree(configs);
+   if( renderContext == NULL )
+   {
+      XCloseDisplay(renderDisplay);
+      return false;
+   }
+   return true;
+#endif
+}
+
+static void makeRenderContextCurrent()
+{
+#ifdef _WIN32
+   wglMakeCurrent(windowDC, renderContext);
+#else
+   glXMakeCurrent(renderDisplay, windowDrawable, renderContext);
+#endif
+}
+
+static void swapRenderBuffers()
+{
+#ifdef _WIN32
+   SwapBuffers(windowDC);
+#else
+   glXSwapBuffers(renderDisplay, windowDrawable);
+#endif
+}
+
+static void destroyRenderContext()
+{
+#ifdef _WIN32
+   wglMakeCurrent(NULL, NULL);
+   wglDeleteContext(renderContext);
+#else
+   glXMakeCurrent(renderDisplay, None, NULL);
+   glXDestroyContext(renderDisplay, renderContext);
+   XCloseDisplay(renderDisplay);
+#endif
+}
+
+//laco da thread de renderizacao: desenha cada quadro novo publicado pela thread do GLUT. Quadros publicados enquanto um quadro
+//e desenhado sao substituidos pelos seguintes; apenas o ultimo e desenhado.
+static void renderLoop()
+{
+   makeRenderContextCurrent();
+   inicializa();
+   long long appliedViewport = -1;
+   while( true )
+   {
+      if( !snapshots.acquire() )
+      {
+         if( renderStopping ) break; //o ultimo quadro publicado ja foi desenhado
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         continue;
+      }
+      CVFrame &frame = snapshots.getFront();
+      renderingFrame.store(frame.number);
+
+      long long viewport = viewportSize.load();
+      if( viewport != appliedViewport )
+      {
+         setupProjection((int)(viewport >> 32), (int)(viewport & 0xffffffff));
+         appliedViewport = viewport;
+      }
+
+      beginFrame();
+      frame.replay();
+      endFrame();
+      swapRenderBuffers();
+   }
+   destroyRenderContext();
+}
+
+//grava um quadro na thread do GLUT. Enquanto a thread de renderizacao nao pegar o quadro anterior, outro quadro apenas o substituiria:
+//a thread do GLUT aguarda um pouco e volta a tratar os eventos.
+static void recordFrame()
+{
+   if( snapshots.isPending() )
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return;
+   }
+   CVFrame &frame = snapshots.getBack();
+   frame.clear();
+   frame.number = publishedFrame.load() + 1;
+
+   recording = &frame;
    render();
+   recording = NULL;
 
-   glFlush();
+   publishedFrame.store(frame.number);
+   snapshots.publish();
+}
+
+void CV::setRenderThread(bool enable)
+{
+   renderThreadEnabled = enable;
+}
+
+bool CV::isRenderThreadEnabled()
+{
+   return renderThreadEnabled;
+}
+
+void CV::setMultisample(bool enable)
+{
+   multisampleRequested.store(enable);
+}
+
+bool CV::isMultisampleEnabled()
+{
+   return multisampleRequested.load();
+}
+
+bool CV::isRecording()
+{
+   return recording != NULL;
+}
+
+void CV::record(CVCommand *command)
+{
+   if( recording )
+   {
+      recording->addCommand(command);
+      return;
+   }
+   flush();
+   command->execute();
+   delete command;
+}
+
+long long CV::getPublishedFrame()
+{
+   return publishedFrame.load();
+}
+
+long long CV::getRenderingFrame()
+{
+   return renderingFrame.load();
+}
+
+void CV::stopRenderThread()
+{
+   if( !renderThread.joinable() ) return;
+   renderStopping = true;
+   renderThread.join();
+}
+
+void display (void)
+{
+   if( renderThreadEnabled )
+   {
+      recordFrame();
+      return;
+   }
+
+   beginFrame();
+   render();
+   endFrame();
+   publishedFrame.store(publishedFrame.load() + 1);
+   renderingFrame.store(publishedFrame.load());
    glutSwapBuffers();
 }
 
@@ -329,10 +755,25 @@ void CV::init(int w, int h, const char *title)
    glutMouseWheelFunc(mouseWheelCB);
 
    printf("GL Version: %s", glGetString(GL_VERSION));
+
+   if( renderThreadEnabled )
+   {
+      if( createRenderContext() )
+      {
+         viewportSize.store(((long long)w << 32) | (unsigned int)h);
+         renderThread = std::thread(renderLoop);
+         glutCloseFunc(CV::stopRenderThread); //a janela e destruida depois desta chamada
+         atexit(CV::stopRenderThread);
+      }
+      else
+      {
+         printf("\nAviso: nao foi possivel criar o contexto da thread de renderizacao; desenhando na thread do GLUT");
+         renderThreadEnabled = false;
+      }
+   }
 }
 
 void CV::run()
 {
    glutMainLoop();
 }
-
@@ -18,6 +18,25 @@
 
 extern int screenWidth, screenHeight;
 
+//contadores de chamadas de estado. A CV guarda a cor, a translacao e a primitiva em aberto (glBegin) atuais e
+//descarta as alteracoes redundantes; desenhos consecutivos de pontos, linhas e retangulos preenchidos sao agrupados
+//em um unico glBegin/glEnd.
+typedef struct {
+   long long colorCalls, colorsSkipped;          //chamadas a color() e quantas nao mudavam a cor atual
+   long long primitives, primitiveBatches;       //desenhos e quantos glBegin foram emitidos para eles
+   long long translateCalls, translatesSkipped;
+   long long frames;                             //quadros desenhados
+} CVSTATS;
+
+//desenho gravado que nao se resume as primitivas da CV (os pixels de uma imagem, um lote de icones com textura).
+//Guarda uma copia de tudo o que le, pois e executado depois, na thread de renderizacao, enquanto a cena continua mudando.
+class CVCommand
+{
+public:
+    virtual ~CVCommand() {}
+    virtual void execute() = 0;
+};
+
 class CV //classe Canvas2D
 {
 public:
@@ -63,6 +82,41 @@ public:
     static void translate(float x, float y);
     static void translate(Vector2 pos);
 
+    //encerra a primitiva em aberto. Deve ser chamada antes de usar o OpenGL diretamente (glRasterPos, glNewList, texturas, etc).
+    static void flush();
+
+    //encerra a primitiva em aberto e esquece a cor e a translacao atuais, que serao emitidas na proxima alteracao.
+    //Deve ser chamada antes e depois de compilar display lists, depois de executa-las e ao alterar o estado diretamente.
+    static void resetState();
+
+    static const CVSTATS& getStats();
+    static void resetStats();
+
+    //ativa ou desativa o MSAA (a janela e sempre criada com GLUT_MULTISAMPLE). Aplicado no inicio do proximo quadro desenhado,
+    //na thread que desenha; pode ser chamada a qualquer momento pela thread do GLUT.
+    static void setMultisample(bool enable);
+    static bool isMultisampleEnabled();
+
+    //modo com thread de renderizacao (deve ser ativado antes de init). A thread do GLUT apenas trata os eventos e grava cada quadro
+    //(as chamadas da CV feitas por render()) em um quadro imutavel, passado sem travas para a thread de renderizacao, que desenha sempre
+    //o ultimo quadro gravado em um contexto OpenGL proprio. render() nao deve chamar o OpenGL diretamente nesse modo.
+    static void setRenderThread(bool enable);
+    static bool isRenderThreadEnabled();
+
+    //indica se as chamadas da thread atual estao sendo gravadas (thread do GLUT, durante render() no modo com thread de renderizacao)
+    static bool isRecording();
+
+    //grava um desenho no quadro atual; a CV passa a ser dona do comando. Fora da gravacao, o comando e executado imediatamente.
+    static void record(CVCommand *command);
+
+    //numero do ultimo quadro gravado (ou desenhado, sem a thread de renderizacao) e do quadro que esta sendo desenhado.
+    //Dados lidos pelos quadros a partir de N podem ser liberados quando getRenderingFrame() >= N.
+    static long long getPublishedFrame();
+    static long long getRenderingFrame();
+
+    //desenha o ultimo quadro gravado e encerra a thread de renderizacao.
+    static void stopRenderThread();
+
     //funcao de inicializacao da Canvas2D. Recebe a largura, altura, e um titulo para a janela
     static void init(int w, int h, const char *title);
 
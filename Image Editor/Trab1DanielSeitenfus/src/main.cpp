@@ -1,26 +1,50 @@
 /**
-* Trabalho 1 - Editor de Imagens - Computao Grfica
+* Trabalho 1 - Editor de Imagens - Computação Gráfica
 *  Autor: Daniel Brenner Seitenfus
 *         04/2024
 *
 * Features:
-*   - Exibio de Bitmaps (24 bits) de qualquer resoluo;
+*   - Exibição de Bitmaps (24 bits) de qualquer resolução;
 *   - Drag and drop de imagens dentro do painel;
-*   - Alterao das cores da imagem, inclusive podendo combinar entre uma ou mais;
-*   - Rotao (inverso) da imagem horizontal e verticalmente;
-*   - Histograma dos canais R, G, B e Luminncia, com dois estilos de visualizao, alterado em tempo real;
-*   - Alterao de brilho (escurer e clarear) da imagem por meio de um slider.
-*   - Botes com cones com fundo removido.
+*   - Alteração das cores da imagem, inclusive podendo combinar entre uma ou mais;
+*   - Rotação (inversão) da imagem horizontal e verticalmente;
+*   - Histograma dos canais R, G, B e Luminância, com dois estilos de visualização, alterado em tempo real;
+*   - Alteração de brilho (escurer e clarear) da imagem por meio de um slider.
+*   - Botões com ícones com fundo removido.
 *
-*  Instrues:
-*    - O programa possui suporte para carregar N imagens. Por padro, ele exibe 3, chamadas "a.bmp", "b.bmp" e "c.bmp". Para alterar as imagens, basta seguir esse padro no diretrio ./Imagens.
-*	 - Para alterar as cores de uma imagem selecionada, clique nos botes R (vermelho), G (verde), B (azul) e L (escala de cinza).
-*       Os botes R, G e B podem ser combinados.
-*    - A cores da imagem tambm podem ser alteradas pressionando as teclas R, G, B e L do teclado.
-*    - Para alterar o brilho da imagem, deslize o boto do slider para esquerda, para escurecer; para direita, para clarear.
-*    - O histograma exibe os canais de cores de acordo com a seleo. Por default, R,G e B vm selecionados.
-*    - Para exibir o histograma de luminncia da imagem basta clicar no boto L.
-*    - O histograma possui dos modos de visualizao, com os grficos preenchidos ou "vazados". Isso pode ser alterado no boto "Preenchido" abaixo do histograma.
+*  Instruções:
+*    - O programa possui suporte para carregar N imagens. Por padrão, ele exibe 3, chamadas "a.bmp", "b.bmp" e "c.bmp". Para alterar as imagens, basta seguir esse padrão no diretório ./Imagens.
+*	 - Para alterar as cores de uma imagem selecionada, clique nos botões R (vermelho), G (verde), B (azul) e L (escala de cinza).
+*       Os botões R, G e B podem ser combinados.
+*    - A cores da imagem também podem ser alteradas pressionando as teclas R, G, B e L do teclado.
+*    - Para alterar o brilho da imagem, deslize o botão do slider para esquerda, para escurecer; para direita, para clarear.
+*       Durante o arraste, a imagem é exibida em resolução reduzida; a imagem completa é processada em segundo plano quando o arraste termina ou pausa.
+*    - O histograma exibe os canais de cores de acordo com a seleção. Por default, R,G e B vêm selecionados.
+*    - Para exibir o histograma de luminância da imagem basta clicar no botão L.
+*    - Para salvar a imagem selecionada com as cores, o brilho e as inversões aplicados, pressione a tecla S. O arquivo é gravado em .\Trab1DanielSeitenfus\images\exportada.bmp,
+*       em segundo plano, e o progresso é exibido abaixo do histograma.
+*    - Imagens alteradas em outros programas enquanto o editor está aberto são recarregadas automaticamente, mantendo posição e efeitos.
+*    - Na primeira abertura, cada imagem é gravada já decodificada em um arquivo ao lado do original (nome + ".pxc"), com histogramas e mipmaps.
+*       Nas aberturas seguintes esse arquivo é apenas mapeado em memória. Ele é refeito se o original mudar; use --no-cache para desabilitar.
+*    - O histograma possui dos modos de visualização, com os gráficos preenchidos ou "vazados". Isso pode ser alterado no botão "Preenchido" abaixo do histograma.
+*
+*  Gravação e reprodução de eventos (para medir latência de interação):
+*    - canvas2d --record arquivo.txt            grava os eventos de mouse e teclado da sessão.
+*    - canvas2d --replay arquivo.txt            reproduz os eventos na janela e imprime os percentis de tempo ao final.
+*    - canvas2d --replay arquivo.txt --headless reproduz sem abrir janela (apenas tratamento de eventos e atualização da cena).
+*    Na reprodução com janela, o relatório final inclui as chamadas de estado (cor, translação e glBegin) enviadas e descartadas pela CV.
+*    - --sort-draws envia os pixels das imagens agrupados por cor, para comparar as trocas de estado com o envio em ordem.
+*    - --render-thread desenha em uma thread separada: a thread do GLUT trata os eventos, atualiza a cena e apenas grava os quadros,
+*       que a thread de renderização desenha. Um quadro lento não atrasa o tratamento dos eventos. Na reprodução, a latência vai até a gravação do quadro.
+*    - Os eventos de entrada são despachados uma vez por frame, com os movimentos do mouse agrupados na posição mais recente.
+*       O relatório da reprodução inclui os eventos recebidos e despachados; --no-coalesce despacha todos os movimentos, para comparação.
+*    - As imagens do painel desenham apenas as partes não cobertas pelas imagens à frente. O relatório da reprodução inclui a sobreposição
+*       (área desenhada sobre a área visível); --no-occlusion desenha as imagens inteiras, para comparação.
+*    - Ao arrastar uma imagem, as imagens abaixo dela são copiadas para uma textura no primeiro quadro; nos seguintes, apenas a textura
+*       e a imagem arrastada são desenhadas.
+*    - Durante a interação, o tempo de cada quadro é mantido em até 16 ms reduzindo a qualidade (imagens do painel em um mipmap mais grosso,
+*       histograma atualizado com menos frequência, MSAA desligado); a qualidade volta quando a cena fica parada. As decisões são impressas
+*       na saída padrão. --frame-budget ms altera o orçamento; --frame-budget 0 mantém sempre a qualidade máxima.
 */
 
 #include <GL/glut.h>
@@ -28,6 +52,9 @@
 #include "gl_canvas2d.h"
 #include "ImagePanel.h"
 #include "ImageSelectedSection.h"
+#include "InputReplay.h"
+#include "InputQueue.h"
+#include "FrameGovernor.h"
 
 //largura e altura inicial da tela . Alteram com o redimensionamento de tela.
 int screenWidth = 1100, screenHeight = 700;
@@ -36,51 +63,206 @@ ImagePanel *imagePanel;
 ImageSelectedSection *imageSelectedSection;
 int imagePanelX=350, imagePanelY=40, imagePanelHeight=600, imagePanelWidth=650;
 
+InputRecorder *inputRecorder = NULL;
+InputReplayer *inputReplayer = NULL;
+InputQueue inputQueue;
+
+bool headlessMode = false;
+long long replacedAtFrame = 0; /**< Primeiro quadro que não lê mais os pixels substituídos pela última recarga. */
+
 /**
- * Funo principal para renderizar o contedo do programa.
+ * Trata um evento de mouse da fila de entrada: repassa aos gerenciadores.
  */
-void render() {
-    imagePanel->render();
+void dispatchMouse(int button, int state, int wheel, int direction, int x, int y) {
+    imagePanel->onMouseUpdated(x, y, state);
+    imageSelectedSection->onMouseUpdated(x, y, state);
+}
+
+/**
+ * Trata uma tecla pressionada da fila de entrada.
+ */
+void dispatchKeyDown(int key) {
+    imageSelectedSection->onKeyboardUpdated(key);
+}
+
+/**
+ * Trata uma tecla liberada da fila de entrada.
+ */
+void dispatchKeyUp(int key) {
+
+}
+
+/**
+ * Despacha os eventos de entrada recebidos desde o último frame e atualiza o estado da cena que depende da imagem selecionada.
+ * Não faz chamadas de desenho, podendo ser usada sem janela.
+ */
+void update() {
+    frameArena.reset();
+    inputQueue.dispatch(dispatchMouse, dispatchKeyDown, dispatchKeyUp);
+    if(imagePanel->applyReloadedImages()) replacedAtFrame = CV::getPublishedFrame() + 1;
+    //os quadros anteriores à recarga podem estar sendo desenhados pela thread de renderização
+    bool rendererDone = headlessMode || CV::getRenderingFrame() >= replacedAtFrame;
+    if(rendererDone && !imageSelectedSection->isReadingPixels()) imagePanel->releaseReplacedImages();
     imageSelectedSection->setImageSelected(imagePanel->getSelectedImage());
+}
+
+/**
+ * Imprime as estatísticas dos alocadores de pixels e de quadro.
+ */
+void printMemoryReport() {
+    const FrameArenaStats &arena = frameArena.getStats();
+    PixelAllocator::printStats("Buffers de pixels");
+    printf("\nAlocador de quadro: %lld quadros, pico de %lld bytes por quadro, %lld blocos extras\n", arena.frames, arena.peakBytes, arena.overflowBlocks);
+}
+
+/**
+ * Imprime as chamadas de estado feitas pela CV e quantas foram evitadas.
+ */
+void printDrawReport() {
+    const CVSTATS &stats = CV::getStats();
+    long long frames = stats.frames;
+    if(frames < 1) frames = 1;
+    if(CV::isRenderThreadEnabled()) printf("\nQuadros desenhados: %lld de %lld gravados", stats.frames, CV::getPublishedFrame());
+    printf("\nEstado de desenho por quadro: %.0f cores (%.0f redundantes descartadas), %.0f primitivas em %.0f glBegin, %.0f translacoes (%.0f descartadas)\n",
+           (double)stats.colorCalls/frames, (double)stats.colorsSkipped/frames, (double)stats.primitives/frames, (double)stats.primitiveBatches/frames,
+           (double)stats.translateCalls/frames, (double)stats.translatesSkipped/frames);
+}
+
+/**
+ * Função principal para renderizar o conteúdo do programa.
+ */
+void render() {
+    if(inputReplayer != NULL) inputReplayer->dispatchDue();
+
+    frameGovernor.beginFrame();
+    long long inputFrames = inputQueue.getStats().frames;
+    update();
+    frameGovernor.enter(SUBSYSTEM_UI);
+    imagePanel->render(frameGovernor.getQuality().imageLevel);
     imageSelectedSection->render();
+    frameGovernor.leave();
+
+    if(inputRecorder != NULL) inputRecorder->recordFrame();
+    if(inputReplayer != NULL) {
+        if(!CV::isRenderThreadEnabled()) {
+            CV::flush();
+            glFinish(); //a latência inclui o tempo de execução dos comandos de desenho
+        }
+    }
+    frameGovernor.endFrame(inputQueue.getStats().frames != inputFrames);
+
+    if(inputReplayer != NULL) {
+        inputReplayer->onFrameEnd();
+        if(inputReplayer->isFinished()) {
+            CV::stopRenderThread(); //desenha o último quadro antes de ler as estatísticas
+            inputReplayer->printReport();
+            printMemoryReport();
+            inputQueue.printStats();
+            imageSelectedSection->printPreviewStats();
+            imagePanel->printImageStats();
+            frameGovernor.printStats();
+            printDrawReport();
+            exit(0);
+        }
+    }
 }
 
 /**
- * Funo chamada quando uma tecla  pressionada.
- * @param key Cdigo da tecla pressionada.
+ * Função chamada quando uma tecla é pressionada.
+ * @param key Código da tecla pressionada.
  */
 void keyboard(int key) {
-    imageSelectedSection->onKeyboardUpdated(key);
+    if(inputRecorder != NULL) inputRecorder->recordKey(INPUT_KEY_DOWN, key);
+    inputQueue.pushKey(INPUT_KEY_DOWN, key);
 }
 
 /**
- * Funo chamada quando uma tecla  liberada.
- * @param key Cdigo da tecla liberada.
+ * Função chamada quando uma tecla é liberada.
+ * @param key Código da tecla liberada.
  */
 void keyboardUp(int key) {
-
+    if(inputRecorder != NULL) inputRecorder->recordKey(INPUT_KEY_UP, key);
+    inputQueue.pushKey(INPUT_KEY_UP, key);
 }
 
 /**
- * Funo para tratar eventos do mouse: cliques, movimentos e rolagem.
- * @param button Boto do mouse pressionado.
+ * Função para tratar eventos do mouse: cliques, movimentos e rolagem. O evento é enfileirado e despachado no próximo frame.
+ * @param button Botão do mouse pressionado.
  * @param state Estado de clique do mouse.
- * @param wheel Informao sobre rolagem.
- * @param direction Direo da roda do mouse.
+ * @param wheel Informação sobre rolagem.
+ * @param direction Direção da roda do mouse.
  * @param x Coordenada x do mouse.
  * @param y Coordenada y do mouse.
  */
 void mouse(int button, int state, int wheel, int direction, int x, int y) {
-    imagePanel->onMouseUpdated(x, y, state);
-    imageSelectedSection->onMouseUpdated(x, y, state);
+    if(inputRecorder != NULL) inputRecorder->recordMouse(button, state, wheel, direction, x, y);
+    inputQueue.pushMouse(button, state, wheel, direction, x, y);
+}
+
+/**
+* Reproduz os eventos gravados sem abrir janela, atualizando a cena a cada marcador de frame.
+*/
+void runHeadlessReplay() {
+    while(inputReplayer->dispatchNextFrame()) {
+        update();
+        inputReplayer->onFrameEnd();
+    }
+    inputReplayer->printReport();
+    printMemoryReport();
+    inputQueue.printStats();
+    imageSelectedSection->printPreviewStats();
 }
 
 /**
-* Funo principal do programa.
+* Função principal do programa.
 */
-int main(void) {
+int main(int argc, char **argv) {
+   const char *recordFile = NULL, *replayFile = NULL;
+   bool useCache = true;
+   for(int i=1; i<argc; i++) {
+      if(strcmp(argv[i], "--record") == 0 && i+1 < argc) {
+         recordFile = argv[++i];
+      } else if(strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+         replayFile = argv[++i];
+      } else if(strcmp(argv[i], "--headless") == 0) {
+         headlessMode = true;
+      } else if(strcmp(argv[i], "--no-cache") == 0) {
+         useCache = false;
+      } else if(strcmp(argv[i], "--sort-draws") == 0) {
+         Image::setSortedDrawing(true);
+      } else if(strcmp(argv[i], "--no-coalesce") == 0) {
+         inputQueue.setCoalescing(false);
+      } else if(strcmp(argv[i], "--render-thread") == 0) {
+         CV::setRenderThread(true);
+      } else if(strcmp(argv[i], "--no-occlusion") == 0) {
+         ImageManager::setOcclusionCulling(false);
+      } else if(strcmp(argv[i], "--frame-budget") == 0 && i+1 < argc) {
+         frameGovernor.setBudget(atof(argv[++i]));
+      }
+   }
+   Bmp::setCacheEnabled(useCache);
+
+   if(replayFile != NULL) {
+      inputReplayer = new InputReplayer(replayFile, mouse, keyboard, keyboardUp);
+      if(!inputReplayer->isLoaded()) return 1;
+      screenWidth = inputReplayer->getWidth();
+      screenHeight = inputReplayer->getHeight();
+   } else if(headlessMode) {
+      printf("\nError: --headless requer --replay <arquivo>");
+      return 1;
+   } else if(recordFile != NULL) {
+      inputRecorder = new InputRecorder(recordFile, screenWidth, screenHeight);
+      if(!inputRecorder->isOpen()) return 1;
+   }
+
    imagePanel = new ImagePanel(imagePanelX,imagePanelY,screenWidth - 5,screenHeight - 5);
    imageSelectedSection = new ImageSelectedSection(20, 5, imagePanel->getX1() - 20, screenHeight - 5, imagePanel->getSelectedImage());
+
+   if(headlessMode) {
+      runHeadlessReplay();
+      return 0;
+   }
+
    CV::init(screenWidth, screenHeight, "Trabalho 1");
    CV::run();
 }
@@ -0,0 +1,121 @@
+//*********************************************************
+//
+// alocador de buffers de pixels alinhados
+//
+// Cada bloco tem um cabecalho de PIXEL_ALIGNMENT bytes antes do ponteiro retornado,
+// com o tamanho solicitado, para manter as estatisticas na liberacao.
+//
+//**********************************************************
+
+#include "PixelAllocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+typedef struct {
+   size_t bytes;
+   bool   hugePages;
+} BLOCKHEADER;
+
+static std::atomic<long long> allocations(0);
+static std::atomic<long long> releases(0);
+static std::atomic<long long> bytesAllocated(0);
+static std::atomic<long long> bytesInUse(0);
+static std::atomic<long long> peakBytesInUse(0);
+static std::atomic<long long> hugePageBlocks(0);
+static std::atomic<bool> hugePagesEnabled(true);
+
+static void* alignedAlloc(size_t bytes, size_t alignment) {
+#ifdef _WIN32
+   return _aligned_malloc(bytes, alignment);
+#else
+   void *block = NULL;
+   if( posix_memalign(&block, alignment, bytes) != 0 ) return NULL;
+   return block;
+#endif
+}
+
+static void alignedFree(void *block) {
+#ifdef _WIN32
+   _aligned_free(block);
+#else
+   free(block);
+#endif
+}
+
+void* PixelAllocator::allocate(size_t bytes) {
+   size_t total = bytes + PIXEL_ALIGNMENT;
+   bool huge = false;
+   size_t alignment = PIXEL_ALIGNMENT;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+   //blocos grandes sao alinhados ao tamanho da huge page para que o kernel possa usa-las desde o inicio
+   if( hugePagesEnabled && total >= HUGE_PAGE_SIZE ) {
+      alignment = HUGE_PAGE_SIZE;
+      huge = true;
+   }
+#endif
+
+   unsigned char *block = (unsigned char*)alignedAlloc(total, alignment);
+   if( block == NULL ) {
+      printf("\nErro: memoria insuficiente para alocar %lu bytes", (unsigned long)bytes);
+      return NULL;
+   }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+   if( huge ) {
+      huge = madvise(block, total, MADV_HUGEPAGE) == 0;
+   }
+#endif
+
+   BLOCKHEADER *header = (BLOCKHEADER*)block;
+   header->bytes = bytes;
+   header->hugePages = huge;
+
+   allocations++;
+   bytesAllocated += bytes;
+   if( huge ) hugePageBlocks++;
+   long long inUse = (bytesInUse += bytes);
+   long long peak = peakBytesInUse;
+   while( inUse > peak && !peakBytesInUse.compare_exchange_weak(peak, inUse) );
+
+   return block + PIXEL_ALIGNMENT;
+}
+
+void PixelAllocator::release(void *pointer) {
+   if( pointer == NULL ) return;
+   unsigned char *block = (unsigned char*)pointer - PIXEL_ALIGNMENT;
+   BLOCKHEADER *header = (BLOCKHEADER*)block;
+
+   releases++;
+   bytesInUse -= header->bytes;
+   alignedFree(block);
+}
+
+void PixelAllocator::setHugePages(bool enable) {
+   hugePagesEnabled = enable;
+}
+
+ALLOCATORSTATS PixelAllocator::getStats() {
+   ALLOCATORSTATS stats;
+   stats.allocations    = allocations;
+   stats.releases       = releases;
+   stats.bytesAllocated = bytesAllocated;
+   stats.bytesInUse     = bytesInUse;
+   stats.peakBytesInUse = peakBytesInUse;
+   stats.hugePageBlocks = hugePageBlocks;
+   return stats;
+}
+
+void PixelAllocator::printStats(const char *title) {
+   ALLOCATORSTATS stats = getStats();
+   printf("\n%s: %lld alocacoes, %lld liberacoes, %.1f MB alocados, %.1f MB em uso (pico %.1f MB), %lld blocos em huge pages",
+          title, stats.allocations, stats.releases, stats.bytesAllocated/(1024.0*1024.0),
+          stats.bytesInUse/(1024.0*1024.0), stats.peakBytesInUse/(1024.0*1024.0), stats.hugePageBlocks);
+}
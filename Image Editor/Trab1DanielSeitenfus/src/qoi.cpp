@@ -0,0 +1,231 @@
+//*********************************************************
+//
+// codificador e decodificador do formato QOI ("Quite OK Image")
+//
+//  Referencia:  https://qoiformat.org/qoi-specification.pdf
+//
+//**********************************************************
+
+#include "Qoi.h"
+#include <string.h>
+
+#define QOI_OP_INDEX  0x00 /* 00xxxxxx */
+#define QOI_OP_DIFF   0x40 /* 01xxxxxx */
+#define QOI_OP_LUMA   0x80 /* 10xxxxxx */
+#define QOI_OP_RUN    0xc0 /* 11xxxxxx */
+#define QOI_OP_RGB    0xfe /* 11111110 */
+#define QOI_OP_RGBA   0xff /* 11111111 */
+#define QOI_MASK_2    0xc0 /* 11000000 */
+
+#define QOI_HASH(p) ((p[0]*3 + p[1]*5 + p[2]*7 + p[3]*11) % 64)
+#define QOI_MAX_PIXELS 400000000 //limite de seguranca contra cabecalhos corrompidos
+
+static const unsigned char qoiEnd[QOI_END_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static unsigned int readBigEndian(const unsigned char *p) {
+   return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void writeBigEndian(unsigned char *p, unsigned int v) {
+   p[0] = (v >> 24) & 0xff;
+   p[1] = (v >> 16) & 0xff;
+   p[2] = (v >> 8) & 0xff;
+   p[3] = v & 0xff;
+}
+
+QoiDecoder::QoiDecoder(const unsigned char *data, int size) {
+   bytes = data;
+   end = data + size;
+   memset(index, 0, sizeof(index));
+   px[0] = px[1] = px[2] = 0;
+   px[3] = 255;
+   run = 0;
+}
+
+bool QoiDecoder::decodePixels(unsigned char *out, int count, int outChannels) {
+   int i;
+   for(i=0; i<count; i++, out+=outChannels) {
+      if( run > 0 ) {
+         run--;
+      } else {
+         if( bytes >= end ) break;
+
+         int b1 = *bytes++;
+         if( b1 == QOI_OP_RGB ) {
+            if( end - bytes < 3 ) break;
+            px[0] = bytes[0];
+            px[1] = bytes[1];
+            px[2] = bytes[2];
+            bytes += 3;
+         } else if( b1 == QOI_OP_RGBA ) {
+            if( end - bytes < 4 ) break;
+            px[0] = bytes[0];
+            px[1] = bytes[1];
+            px[2] = bytes[2];
+            px[3] = bytes[3];
+            bytes += 4;
+         } else if( (b1 & QOI_MASK_2) == QOI_OP_INDEX ) {
+            memcpy(px, index[b1], 4);
+         } else if( (b1 & QOI_MASK_2) == QOI_OP_DIFF ) {
+            px[0] += ((b1 >> 4) & 0x03) - 2;
+            px[1] += ((b1 >> 2) & 0x03) - 2;
+            px[2] += ( b1       & 0x03) - 2;
+         } else if( (b1 & QOI_MASK_2) == QOI_OP_LUMA ) {
+            if( bytes >= end ) break;
+            int b2 = *bytes++;
+            int vg = (b1 & 0x3f) - 32;
+            px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+            px[1] += vg;
+            px[2] += vg - 8 +  (b2       & 0x0f);
+         } else if( (b1 & QOI_MASK_2) == QOI_OP_RUN ) {
+            run = (b1 & 0x3f);
+         }
+
+         memcpy(index[QOI_HASH(px)], px, 4);
+      }
+
+      out[0] = px[0];
+      out[1] = px[1];
+      out[2] = px[2];
+      if( outChannels == 4 ) out[3] = px[3];
+   }
+
+   if( i < count ) {
+      bytes = end;
+      memset(out, 0, (count - i)*outChannels);
+      return false;
+   }
+   return true;
+}
+
+bool Qoi::isQoi(const unsigned char magic[4]) {
+   return magic[0] == 'q' && magic[1] == 'o' && magic[2] == 'i' && magic[3] == 'f';
+}
+
+bool Qoi::readHeader(const unsigned char *bytes, QOIHEADER *header) {
+   if( !isQoi(bytes) ) return false;
+
+   header->width      = readBigEndian(bytes + 4);
+   header->height     = readBigEndian(bytes + 8);
+   header->channels   = bytes[12];
+   header->colorspace = bytes[13];
+
+   if( header->width == 0 || header->height == 0 ||
+       header->height >= QOI_MAX_PIXELS / header->width ||
+       header->channels < 3 || header->channels > 4 || header->colorspace > 1 ) {
+      return false;
+   }
+   return true;
+}
+
+unsigned char* Qoi::encode(const unsigned char *pixels, int width, int height, int channels, int stride, bool bottomUp, int *outSize) {
+   //pior caso: 1 byte de tag + channels bytes por pixel
+   long long maxSize = QOI_HEADER_SIZE + (long long)width*height*(channels + 1) + QOI_END_SIZE;
+   if( maxSize > 0x7fffffff ) {
+      printf("\nError: Imagem muito grande para codificar em QOI");
+      *outSize = 0;
+      return NULL;
+   }
+   unsigned char *bytes = new unsigned char[maxSize];
+   unsigned char *p = bytes;
+
+   p[0] = 'q'; p[1] = 'o'; p[2] = 'i'; p[3] = 'f';
+   writeBigEndian(p + 4, width);
+   writeBigEndian(p + 8, height);
+   p[12] = channels;
+   p[13] = QOI_SRGB;
+   p += QOI_HEADER_SIZE;
+
+   unsigned char index[64][4];
+   unsigned char px[4]     = {0, 0, 0, 255};
+   unsigned char prev[4]   = {0, 0, 0, 255};
+   int run = 0;
+   memset(index, 0, sizeof(index));
+
+   for(int y=0; y<height; y++) {
+      const unsigned char *row = pixels + (bottomUp ? (height - 1 - y) : y)*stride;
+      for(int x=0; x<width; x++, row+=channels) {
+         px[0] = row[0];
+         px[1] = row[1];
+         px[2] = row[2];
+         if( channels == 4 ) px[3] = row[3];
+
+         if( memcmp(px, prev, 4) == 0 ) {
+            run++;
+            if( run == 62 ) {
+               *p++ = QOI_OP_RUN | (run - 1);
+               run = 0;
+            }
+            continue;
+         }
+
+         if( run > 0 ) {
+            *p++ = QOI_OP_RUN | (run - 1);
+            run = 0;
+         }
+
+         int hash = QOI_HASH(px);
+         if( memcmp(index[hash], px, 4) == 0 ) {
+            *p++ = QOI_OP_INDEX | hash;
+         } else {
+            memcpy(index[hash], px, 4);
+
+            if( px[3] == prev[3] ) {
+               signed char vr = px[0] - prev[0];
+               signed char vg = px[1] - prev[1];
+               signed char vb = px[2] - prev[2];
+               signed char vgr = vr - vg;
+               signed char vgb = vb - vg;
+
+               if( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 ) {
+                  *p++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+               } else if( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 ) {
+                  *p++ = QOI_OP_LUMA | (vg + 32);
+                  *p++ = (vgr + 8) << 4 | (vgb + 8);
+               } else {
+                  *p++ = QOI_OP_RGB;
+                  *p++ = px[0];
+                  *p++ = px[1];
+                  *p++ = px[2];
+               }
+            } else {
+               *p++ = QOI_OP_RGBA;
+               *p++ = px[0];
+               *p++ = px[1];
+               *p++ = px[2];
+               *p++ = px[3];
+            }
+         }
+         memcpy(prev, px, 4);
+      }
+   }
+
+   if( run > 0 ) {
+      *p++ = QOI_OP_RUN | (run - 1);
+   }
+
+   memcpy(p, qoiEnd, QOI_END_SIZE);
+   p += QOI_END_SIZE;
+
+   *outSize = (int)(p - bytes);
+   return bytes;
+}
+
+bool Qoi::write(const char *fileName, const unsigned char *pixels, int width, int height, int channels, int stride, bool bottomUp) {
+   FILE *fp = fopen(fileName, "wb");
+   if( fp == NULL ) {
+      printf("\nErro ao abrir arquivo %s para escrita", fileName);
+      return false;
+   }
+
+   int size = 0;
+   unsigned char *bytes = encode(pixels, width, height, channels, stride, bottomUp, &size);
+   if( bytes == NULL ) {
+      fclose(fp);
+      return false;
+   }
+   bool ok = (int)fwrite(bytes, 1, size, fp) == size;
+   delete[] bytes;
+   fclose(fp);
+   return ok;
+}
@@ -0,0 +1,177 @@
+/**
+* qoiconv - Conversor em lote de imagens para o formato QOI e benchmark de carregamento BMP x QOI.
+*
+*  Uso:
+*    qoiconv [-o diretorio] arquivo1.bmp [arquivo2.bmp ...]
+*       Converte cada arquivo (BMP ou QOI) para QOI. A saída tem o mesmo nome com extensão .qoi, no mesmo diretório
+*       do arquivo de entrada ou no diretório indicado por -o.
+*
+*    qoiconv --bench [-n repetições] arquivo1.bmp [arquivo2.bmp ...]
+*       Para cada BMP, gera um QOI temporário e mede o tempo médio de carregamento (Bmp) dos dois formatos,
+*       com o arquivo já no cache de páginas do sistema (quente) e fora dele (frio).
+*       O cache frio usa posix_fadvise(POSIX_FADV_DONTNEED) e só está disponível em sistemas POSIX.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include "Bmp.h"
+#include "Qoi.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define HAS_FADVISE 1
+#endif
+
+/**
+ * Monta o nome do arquivo de saída, trocando a extensão por .qoi e, se informado, o diretório.
+ */
+std::string outputName(const char *fileName, const char *outputDir) {
+    std::string name(fileName);
+    size_t slash = name.find_last_of("/\\");
+    size_t dot = name.find_last_of('.');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        name = name.substr(0, dot);
+    }
+    name += ".qoi";
+
+    if(outputDir != NULL) {
+        std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+        std::string dir(outputDir);
+        if(!dir.empty() && dir[dir.size()-1] != '/' && dir[dir.size()-1] != '\\') dir += "/";
+        name = dir + base;
+    }
+    return name;
+}
+
+/**
+ * Converte um arquivo para QOI.
+ * @return true se a conversão foi bem sucedida.
+ */
+bool convert(const char *fileName, const std::string &output) {
+    Bmp bmp(fileName);
+    if(bmp.getImage() == NULL) {
+        printf("\nErro: nao foi possivel carregar %s (%s)", fileName, Bmp::getErrorMessage(bmp.getError()));
+        return false;
+    }
+    int stride = bmp.getWidth()*3 + bmp.getRowPadding();
+    return Qoi::write(output.c_str(), bmp.getImage(), bmp.getWidth(), bmp.getHeight(), 3, stride, true);
+}
+
+long fileSize(const char *fileName) {
+    FILE *fp = fopen(fileName, "rb");
+    if(fp == NULL) return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+/**
+ * Remove as páginas do arquivo do cache do sistema operacional.
+ * @return false se não for suportado nesta plataforma.
+ */
+bool evictFromPageCache(const char *fileName) {
+#ifdef HAS_FADVISE
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) return false;
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Mede o tempo médio, em milissegundos, de carregar o arquivo com a classe Bmp.
+ * @param cold Se true, retira o arquivo do cache de páginas antes de cada carregamento.
+ * @return Tempo médio, ou -1 se o modo não for suportado.
+ */
+double timeLoad(const char *fileName, int repetitions, bool cold) {
+    double total = 0;
+    for(int i=0; i<repetitions; i++) {
+        if(cold && !evictFromPageCache(fileName)) return -1;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Bmp *bmp = new Bmp(fileName);
+        bmp->decode();
+        total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        delete bmp;
+    }
+    return total/repetitions;
+}
+
+void printTime(double ms, double megabytes) {
+    if(ms < 0) printf(" %9s %9s", "n/d", "");
+    else printf(" %9.3f %9.1f", ms, megabytes/(ms/1000));
+}
+
+int bench(char **files, int count, int repetitions) {
+    printf("%-28s %-4s %10s %9s %9s %9s %9s\n", "arquivo", "fmt", "bytes", "quente ms", "MB/s", "frio ms", "MB/s");
+    for(int i=0; i<count; i++) {
+        std::string qoiName = std::string(files[i]) + ".bench.qoi";
+        if(!convert(files[i], qoiName)) return 1;
+
+        Bmp probe(files[i]);
+        double megabytes = (double)probe.getWidth()*probe.getHeight()*3/(1024*1024);
+        const char *names[2] = {files[i], qoiName.c_str()};
+        const char *formats[2] = {"bmp", "qoi"};
+
+        for(int f=0; f<2; f++) {
+            timeLoad(names[f], 1, false); //aquece o cache
+            printf("%-28s %-4s %10ld", files[i], formats[f], fileSize(names[f]));
+            printTime(timeLoad(names[f], repetitions, false), megabytes);
+            printTime(timeLoad(names[f], repetitions, true), megabytes);
+            printf("\n");
+        }
+        remove(qoiName.c_str());
+    }
+    printf("(MB/s em relacao ao tamanho decodificado, %d repeticoes)\n", repetitions);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *outputDir = NULL;
+    bool benchMode = false;
+    int repetitions = 20;
+    int first = 1;
+
+    for(; first<argc && argv[first][0] == '-'; first++) {
+        if(strcmp(argv[first], "-o") == 0 && first+1 < argc) {
+            outputDir = argv[++first];
+        } else if(strcmp(argv[first], "--bench") == 0) {
+            benchMode = true;
+        } else if(strcmp(argv[first], "-n") == 0 && first+1 < argc) {
+            repetitions = atoi(argv[++first]);
+            if(repetitions < 1) repetitions = 1;
+        } else {
+            break;
+        }
+    }
+
+    if(first >= argc) {
+        printf("Uso: qoiconv [-o diretorio] arquivo1.bmp [arquivo2.bmp ...]\n");
+        printf("     qoiconv --bench [-n repeticoes] arquivo1.bmp [arquivo2.bmp ...]\n");
+        return 1;
+    }
+
+    Bmp::setVerbose(false);
+    if(benchMode) {
+        return bench(argv + first, argc - first, repetitions);
+    }
+
+    int failures = 0;
+    for(int i=first; i<argc; i++) {
+        std::string output = outputName(argv[i], outputDir);
+        if(convert(argv[i], output)) {
+            printf("%s -> %s (%ld -> %ld bytes)\n", argv[i], output.c_str(), fileSize(argv[i]), fileSize(output.c_str()));
+        } else {
+            printf("\nErro ao converter %s\n", argv[i]);
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -19,11 +19,14 @@ public:
     }
 
     void render() {
+        CV::pushMatrix();
+        CV::loadIdentity();
         CV::translate(screenWidth/2, screenHeight/2);
         pointer.x = r*cos(angle);
         pointer.y = r*sin(angle);
         CV::color(0,0,0);
         CV::line(origin, pointer);
+        CV::popMatrix();
         angle -= 0.001;
     }
 
@@ -2,39 +2,99 @@
 #define SPIRAL_H_INCLUDED
 
 #include "Vector2.h"
+#include "Vector2Batch.h"
 
+/**
+ * Espiral de Arquimedes r = growth * theta.
+ * Os vertices sao gerados uma unica vez (com moveAngle = 0) e guardados em cache. A cada frame a espiral
+ * inteira e girada por moveAngle com uma unica transformacao (CV::rotate) e desenhada como uma polyline.
+ */
 class Spiral {
 
 public:
 
     int numLaps = 10;
     float moveAngle = 0;
+    float growth = 1;         //pixels de raio por radiano
+    float tolerance = 0.1;    //distancia maxima, em pixels, entre a curva e cada segmento
+    float maxStep = 0.5;      //passo angular maximo, usado perto do centro
 
     Spiral() {
 
     }
 
     void render() {
+        if(isCacheInvalid()) {
+            build();
+        }
 
-        float radius = 0;
         CV::color(0,0,0);
-        int x = radius*cos(0);
-        int y = radius*sin(0);
-        for(float i=0; i<2*PI*numLaps; i+=0.1) {
-            int x1 = radius*cos(i + moveAngle);
-            int y1 = radius*sin(i + moveAngle);
-            CV::line(x,y, x1, y1);
-            x = x1;
-            y = y1;
-            radius += 0.1;
+        CV::pushMatrix();
+        CV::rotate(moveAngle);
+        CV::polyline(vertices.x.data(), vertices.y.data(), vertices.size());
+        CV::popMatrix();
+
+        moveAngle += 0.005;
+    }
+
+    /**
+     * Gera os vertices da espiral sem chamar cos/sin a cada passo: a direcao (cos theta, sin theta) avanca
+     * por multiplicacao complexa com um rotor (cos step, sin step).
+     * O passo e escolhido pelo raio local: a flecha de uma corda de angulo step em um arco de raio r e
+     * aproximadamente r*step^2/8, entao o passo e reduzido pela metade sempre que essa flecha passa da
+     * tolerancia. O rotor so e recalculado nessas trocas (poucas vezes por espiral).
+     */
+    void build() {
+        const float thetaEnd = 2*PI*numLaps;
+        float step = maxStep;
+        float cs = cos(step), sn = sin(step);
+        float ux = 1, uy = 0;
+        float theta = 0;
+
+        vertices.clear();
+        vertices.push(0, 0);
+        while(theta < thetaEnd) {
+            float rEnd = growth*(theta + step);
+            if(rEnd*step*step > 8*tolerance) {
+                step *= 0.5;
+                cs = cos(step);
+                sn = sin(step);
+                renormalize(ux, uy);
+                continue;
+            }
 
+            float nx = ux*cs - uy*sn;
+            uy = ux*sn + uy*cs;
+            ux = nx;
+            theta += step;
+            vertices.push(rEnd*ux, rEnd*uy);
         }
 
-        moveAngle += 0.005;
+        builtLaps = numLaps;
+        builtGrowth = growth;
+        builtTolerance = tolerance;
+        builtMaxStep = maxStep;
+    }
 
+    int getVertexCount() {
+        return vertices.size();
     }
 
+private:
+    Vector2Batch vertices;
+    int builtLaps = -1;
+    float builtGrowth = 0, builtTolerance = 0, builtMaxStep = 0;
 
+    bool isCacheInvalid() {
+        return builtLaps != numLaps || builtGrowth != growth || builtTolerance != tolerance || builtMaxStep != maxStep;
+    }
+
+    //corrige o acumulo de erro de arredondamento da recorrencia, mantendo a direcao unitaria.
+    void renormalize(float &ux, float &uy) {
+        float norm = sqrt(ux*ux + uy*uy);
+        ux /= norm;
+        uy /= norm;
+    }
 };
 
 
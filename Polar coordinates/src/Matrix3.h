@@ -0,0 +1,90 @@
+#ifndef __MATRIX_3_H__
+#define __MATRIX_3_H__
+
+#include <cmath>
+#include "Vector2.h"
+
+/**
+ * Matriz 3x3 de transformacao afim 2D, em coordenadas homogeneas:
+ *   | m[0][0]  m[0][1]  m[0][2] |     | a  b  tx |
+ *   | m[1][0]  m[1][1]  m[1][2] |  =  | c  d  ty |
+ *   |    0        0        1    |     | 0  0  1  |
+ * A composicao e feita na CPU; o seno e o cosseno sao calculados uma unica vez na construcao da rotacao.
+ */
+class Matrix3 {
+public:
+    float m[3][3];
+
+    Matrix3() {
+        setIdentity();
+    }
+
+    void setIdentity() {
+        for(int i=0; i<3; i++)
+            for(int j=0; j<3; j++)
+                m[i][j] = (i == j) ? 1 : 0;
+    }
+
+    static Matrix3 identity() {
+        return Matrix3();
+    }
+
+    static Matrix3 rotation(float angle) {
+        Matrix3 r;
+        float cs = std::cos(angle);
+        float sn = std::sin(angle);
+        r.m[0][0] = cs; r.m[0][1] = -sn;
+        r.m[1][0] = sn; r.m[1][1] = cs;
+        return r;
+    }
+
+    static Matrix3 scale(float sx, float sy) {
+        Matrix3 r;
+        r.m[0][0] = sx;
+        r.m[1][1] = sy;
+        return r;
+    }
+
+    static Matrix3 translation(float dx, float dy) {
+        Matrix3 r;
+        r.m[0][2] = dx;
+        r.m[1][2] = dy;
+        return r;
+    }
+
+    // espelha em relacao ao eixo y (x = -x)
+    static Matrix3 reflection() {
+        return scale(-1, 1);
+    }
+
+    // composicao: (A * B) aplica B primeiro e depois A
+    Matrix3 operator * (const Matrix3& o) const {
+        Matrix3 r;
+        for(int i=0; i<3; i++)
+            for(int j=0; j<3; j++)
+                r.m[i][j] = m[i][0]*o.m[0][j] + m[i][1]*o.m[1][j] + m[i][2]*o.m[2][j];
+        return r;
+    }
+
+    Matrix3& operator *= (const Matrix3& o) {
+        *this = *this * o;
+        return *this;
+    }
+
+    Vector2 apply(const Vector2& p) const {
+        return Vector2(m[0][0]*p.x + m[0][1]*p.y + m[0][2],
+                       m[1][0]*p.x + m[1][1]*p.y + m[1][2]);
+    }
+
+    /**
+     * Converte para o formato 4x4 column-major usado por glLoadMatrixf.
+     */
+    void toGL(float out[16]) const {
+        out[0] = m[0][0]; out[4] = m[0][1]; out[8]  = 0; out[12] = m[0][2];
+        out[1] = m[1][0]; out[5] = m[1][1]; out[9]  = 0; out[13] = m[1][2];
+        out[2] = 0;       out[6] = 0;       out[10] = 1; out[14] = 0;
+        out[3] = 0;       out[7] = 0;       out[11] = 0; out[15] = 1;
+    }
+};
+
+#endif
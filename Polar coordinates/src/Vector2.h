@@ -46,18 +46,18 @@ public:
    }
 
    // Adicionem os demais overloads de operadores aqui.
-    Vector2 operator * (float scalar) const { // multiplicao por escalar
+    Vector2 operator * (float scalar) const { // multiplicação por escalar
         Vector2 aux(x * scalar, y * scalar);
         return ( aux );
     }
 
-    Vector2& operator += (const Vector2& v) { // soma e atribuio
+    Vector2& operator += (const Vector2& v) { // soma e atribuição
         x += v.x;
         y += v.y;
         return *this;
     }
 
-    bool operator == (const Vector2& v) { // soma e atribuio
+    bool operator == (const Vector2& v) { // soma e atribuição
         return x == v.x && y == v.y;
     }
 
@@ -0,0 +1,111 @@
+#ifndef __VECTOR_2_BATCH_H__
+#define __VECTOR_2_BATCH_H__
+
+#include <cmath>
+#include <vector>
+#include "Vector2.h"
+#include "Matrix3.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/**
+ * Lote de pontos 2D armazenado como estrutura de arrays (x[] e y[] separados).
+ * Os arrays podem ser enviados direto para CV::polygon(), desenhando o lote inteiro em uma unica chamada.
+ * Para transformar na CPU um objeto inteiro de uma vez, use transform() com a matriz composta (ex: CV::getMatrix()).
+ */
+class Vector2Batch {
+public:
+    std::vector<float> x, y;
+
+    Vector2Batch() {}
+
+    Vector2Batch(int n) : x(n), y(n) {}
+
+    int size() const {
+        return (int)x.size();
+    }
+
+    void resize(int n) {
+        x.resize(n);
+        y.resize(n);
+    }
+
+    void reserve(int n) {
+        x.reserve(n);
+        y.reserve(n);
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+    }
+
+    void push(const Vector2& p) {
+        x.push_back(p.x);
+        y.push_back(p.y);
+    }
+
+    void push(float _x, float _y) {
+        x.push_back(_x);
+        y.push_back(_y);
+    }
+
+    void set(int i, const Vector2& p) {
+        x[i] = p.x;
+        y[i] = p.y;
+    }
+
+    Vector2 get(int i) const {
+        return Vector2(x[i], y[i]);
+    }
+
+    /**
+     * Aplica a transformacao mat a todos os pontos do lote, escrevendo em out.
+     * out pode ser o proprio lote (transformacao in-place).
+     */
+    void transform(const Matrix3& mat, Vector2Batch& out) const {
+        int n = size();
+        out.resize(n);
+        const float *px = x.data(), *py = y.data();
+        float *ox = out.x.data(), *oy = out.y.data();
+        const float ma = mat.m[0][0], mb = mat.m[0][1], mtx = mat.m[0][2];
+        const float mc = mat.m[1][0], md = mat.m[1][1], mty = mat.m[1][2];
+        int i = 0;
+
+#if defined(__AVX__)
+        const __m256 a8 = _mm256_set1_ps(ma), b8 = _mm256_set1_ps(mb), tx8 = _mm256_set1_ps(mtx);
+        const __m256 c8 = _mm256_set1_ps(mc), d8 = _mm256_set1_ps(md), ty8 = _mm256_set1_ps(mty);
+        for(; i + 8 <= n; i += 8) {
+            __m256 vx = _mm256_loadu_ps(px + i);
+            __m256 vy = _mm256_loadu_ps(py + i);
+            _mm256_storeu_ps(ox + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a8, vx), _mm256_mul_ps(b8, vy)), tx8));
+            _mm256_storeu_ps(oy + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c8, vx), _mm256_mul_ps(d8, vy)), ty8));
+        }
+#endif
+#if defined(__SSE__)
+        const __m128 a4 = _mm_set1_ps(ma), b4 = _mm_set1_ps(mb), tx4 = _mm_set1_ps(mtx);
+        const __m128 c4 = _mm_set1_ps(mc), d4 = _mm_set1_ps(md), ty4 = _mm_set1_ps(mty);
+        for(; i + 4 <= n; i += 4) {
+            __m128 vx = _mm_loadu_ps(px + i);
+            __m128 vy = _mm_loadu_ps(py + i);
+            _mm_storeu_ps(ox + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a4, vx), _mm_mul_ps(b4, vy)), tx4));
+            _mm_storeu_ps(oy + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c4, vx), _mm_mul_ps(d4, vy)), ty4));
+        }
+#endif
+        for(; i < n; i++) {
+            float vx = px[i], vy = py[i];
+            ox[i] = ma*vx + mb*vy + mtx;
+            oy[i] = mc*vx + md*vy + mty;
+        }
+    }
+
+    void transform(const Matrix3& mat) {
+        transform(mat, *this);
+    }
+};
+
+#endif
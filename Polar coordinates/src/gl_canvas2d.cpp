@@ -15,6 +15,11 @@
 
 #include "gl_canvas2d.h"
 #include <GL/glut.h>
+#include <vector>
+
+//matriz corrente e pilha de matrizes da Canvas2D. A composicao e feita na CPU.
+static Matrix3 currentMatrix;
+static std::vector<Matrix3> matrixStack;
 
 //conjunto de cores predefinidas. Pode-se adicionar mais cores.
 float Colors[14][3]=
@@ -129,6 +134,17 @@ void CV::polygonFill(float vx[], float vy[], int elems)
 
 }
 
+void CV::polyline(float vx[], float vy[], int elems)
+{
+   int cont;
+   glBegin(GL_LINE_STRIP);
+      for(cont=0; cont<elems; cont++)
+      {
+         glVertex2d(vx[cont], vy[cont]);
+      }
+   glEnd();
+}
+
 //existem outras fontes de texto que podem ser usadas
 //  GLUT_BITMAP_9_BY_15
 //  GLUT_BITMAP_TIMES_ROMAN_10
@@ -205,20 +221,69 @@ void CV::circleFill(Vector2 pos, float radius, int div) {
     glEnd();
 }
 
+//envia a matriz corrente para o OpenGL.
+static void uploadMatrix()
+{
+   float glMatrix[16];
+   currentMatrix.toGL(glMatrix);
+   glMatrixMode(GL_MODELVIEW);
+   glLoadMatrixf(glMatrix);
+}
+
 //coordenada de offset para desenho de objetos.
-//nao armazena translacoes cumulativas.
+//acumula com as transformacoes anteriores. Use pushMatrix/popMatrix para isolar objetos.
 void CV::translate(float offsetX, float offsetY)
 {
-   glMatrixMode(GL_MODELVIEW);
-   glLoadIdentity();
-   glTranslated(offsetX, offsetY, 0);
+   multMatrix(Matrix3::translation(offsetX, offsetY));
 }
 
 void CV::translate(Vector2 offset)
 {
-   glMatrixMode(GL_MODELVIEW);
-   glLoadIdentity();
-   glTranslated(offset.x, offset.y, 0);
+   multMatrix(Matrix3::translation(offset.x, offset.y));
+}
+
+void CV::rotate(float angle)
+{
+   multMatrix(Matrix3::rotation(angle));
+}
+
+void CV::scale(float sx, float sy)
+{
+   multMatrix(Matrix3::scale(sx, sy));
+}
+
+void CV::multMatrix(const Matrix3 &m)
+{
+   currentMatrix *= m;
+   uploadMatrix();
+}
+
+void CV::loadIdentity()
+{
+   currentMatrix.setIdentity();
+   uploadMatrix();
+}
+
+void CV::pushMatrix()
+{
+   matrixStack.push_back(currentMatrix);
+}
+
+void CV::popMatrix()
+{
+   if( matrixStack.empty() )
+   {
+      printf("\nCV::popMatrix: pilha de matrizes vazia");
+      return;
+   }
+   currentMatrix = matrixStack.back();
+   matrixStack.pop_back();
+   uploadMatrix();
+}
+
+const Matrix3& CV::getMatrix()
+{
+   return currentMatrix;
 }
 
 void CV::color(float r, float g, float b)
@@ -316,8 +381,8 @@ void display (void)
 {
    glClear(GL_COLOR_BUFFER_BIT );
 
-   glMatrixMode(GL_MODELVIEW);
-   glLoadIdentity();
+   matrixStack.clear();
+   CV::loadIdentity();
 
    render();
 
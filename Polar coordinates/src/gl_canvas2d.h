@@ -10,6 +10,7 @@
 #include <GL/freeglut_ext.h> //callback da wheel do mouse.
 
 #include "Vector2.h"
+#include "Matrix3.h"
 
 #define PI_2 6.28318530717
 #define PI   3.14159265359
@@ -39,6 +40,9 @@ public:
     static void polygon(float vx[], float vy[], int n_elems);
     static void polygonFill(float vx[], float vy[], int n_elems);
 
+    //desenha uma linha poligonal ABERTA ligando os n_elems vertices em ordem, em uma unica chamada.
+    static void polyline(float vx[], float vy[], int n_elems);
+
     //centro e raio do circulo
     static void circle( float x, float y, float radius, int div );
     static void circle( Vector2 pos, float radius, int div );
@@ -60,9 +64,21 @@ public:
     static void text(Vector2 pos, float valor);    //varias funcoes ainda nao tem implementacao. Faca como exercicio
     static void text(float x, float y, const char *t, int spacing);
 
-    //coordenada de offset para desenho de objetos.
+    //transformacoes acumulativas sobre a matriz corrente, compostas na CPU e enviadas ao GL uma vez por chamada.
+    //a matriz e reiniciada para a identidade no inicio de cada frame.
     static void translate(float x, float y);
     static void translate(Vector2 pos);
+    static void rotate(float angle); //angulo em radianos
+    static void scale(float sx, float sy);
+    static void multMatrix(const Matrix3 &m);
+    static void loadIdentity();
+
+    //pilha de matrizes, para aninhar transformacoes de objetos.
+    static void pushMatrix();
+    static void popMatrix();
+
+    //matriz corrente, para transformar lotes de vertices na CPU (ver Vector2Batch::transform)
+    static const Matrix3& getMatrix();
 
     //funcao de inicializacao da Canvas2D. Recebe a largura, altura, e um titulo para a janela
     static void init(int w, int h, const char *title);
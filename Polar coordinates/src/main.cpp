@@ -3,6 +3,7 @@
 #include <GL/freeglut_ext.h> //callback da wheel do mouse.
 #include "gl_canvas2d.h"
 #include "Vector2.h"
+#include "Vector2Batch.h"
 #include "Pointer.h"
 #include "Circle.h"
 #include "Spiral.h"
@@ -18,71 +19,29 @@ Circle *circle;
 
 Spiral spiral;
 RotaryHacksaw rotaryHacksaw;
-Vector2 in[4];
-Vector2 out[4];
+Vector2Batch square;
+Vector2Batch out;
 
-Vector2 translate(Vector2 point, float value) {
-    point.x += value;
-    point.y += value;
-    return point;
-}
-
-Vector2 scale(Vector2 point, float value) {
-    point.x *= value;
-    point.y *= value;
-    return point;
-}
-
-Vector2 reflect(Vector2 point) {
-    point.x *= -1;
-    return point;
-}
-
-Vector2 rotate(Vector2 point, float angle) {
-    int x = point.x;
-    int y = point.y;
-
-    point.x = x*cos(angle) - y*sin(angle);
-    point.y = x*sin(angle) + y*cos(angle);
-    return point;
-}
-
-void draw(Vector2 out[4]) {
-    for(int i=0; i<4; i++) {
-        Vector2 p0 = out[i];
-        Vector2 p1 = out[(i+1)%4];
-        CV::line(p0, p1);
-    }
+//desenha o contorno do lote inteiro em uma unica chamada.
+void draw(Vector2Batch &batch) {
+    CV::polygon(batch.x.data(), batch.y.data(), batch.size());
 }
 
 void renderSquare() {
+    //seno e cosseno sao calculados uma vez por transformacao, e nao por ponto.
     CV::color(0,0,0);
-    for(int i=0; i<4; i++) {
-        //out[i] = in[i];
-        //out[i] = scale(in[i],2);
-
-        out[i] = rotate(in[i], 1);
-
-        //out[i] = translate(out[i], 100);
-    }
-
+    //square.transform(Matrix3::identity(), out);
+    //square.transform(Matrix3::scale(2, 2), out);
+    //square.transform(Matrix3::translation(100, 100) * Matrix3::rotation(1), out);
+    square.transform(Matrix3::rotation(1), out);
     draw(out);
 
     CV::color(0,0,1);
-    for(int i=0; i<4; i++) {
-        out[i] = rotate(in[i], 2);
-        out[i] = translate(out[i], 300);
-    }
-
+    square.transform(Matrix3::translation(300, 300) * Matrix3::rotation(2), out);
     draw(out);
 
     CV::color(0,1,0);
-    for(int i=0; i<4; i++) {
-        out[i] = rotate(in[i], 3);
-        out[i] = translate(out[i], 300);
-
-    }
-
+    square.transform(Matrix3::translation(300, 300) * Matrix3::rotation(3), out);
     draw(out);
 }
 
@@ -122,15 +81,10 @@ void mouse(int button, int state, int wheel, int direction, int x, int y) {
 
 int main(void) {
     int squareSize = 50;
-    Vector2 p0, p1, p2, p3;
-    p0.set(0,0);
-    p1.set(0, squareSize);
-    p2.set(squareSize,squareSize);
-    p3.set(squareSize, 0);
-    in[0] = p0;
-    in[1] = p1;
-    in[2] = p2;
-    in[3] = p3;
+    square.push(0, 0);
+    square.push(0, squareSize);
+    square.push(squareSize, squareSize);
+    square.push(squareSize, 0);
     pointer = new Pointer();
     circle = new Circle();
    CV::init(screenWidth, screenHeight, "T3 - Daniel Seitenfus");